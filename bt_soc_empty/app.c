@@ -27,6 +27,7 @@
  * 3. This notice may not be removed or altered from any source distribution.
  *
  ******************************************************************************/
+#include <stdio.h>
 #include <stdlib.h>
 #include <errno.h>
 
@@ -39,13 +40,63 @@
 #include "sl_sleeptimer.h"
 #include "sl_i2cspm.h"
 #include "sl_i2cspm_instances.h"
+#include "sl_i2cspm_da7280_config.h"
 #include "da7280_driver.h"
+#include "da7280_i2c_async.h"
+#include "da7280_nirq.h"
+#include "da7280_pwm_config.h"
+#if DA7280_PWM_BACKEND
+#include "em_cmu.h"
+#include "em_gpio.h"
+#include "da7280_pwm.h"
+#endif
 
 #define MSG_MAX_LEN 128
 // The advertising set handle allocated from Bluetooth stack.
 static uint8_t advertising_set_handle = 0xff;
 static uint8_t _conn_handle = 0xff;
 
+// Advances the queued DA7280 transfers.
+#if SL_I2CSPM_DA7280_PERIPHERAL_NO == 0
+#define DA7280_I2C_IRQn I2C0_IRQn
+void I2C0_IRQHandler(void)
+#else
+#define DA7280_I2C_IRQn I2C1_IRQn
+void I2C1_IRQHandler(void)
+#endif
+{
+    da7280_asyncIrqHandler();
+}
+
+#if DA7280_PWM_BACKEND
+// Feeds the duty cycle table of a PWM stream.
+void DA7280_PWM_IRQHandler(void)
+{
+    da7280_pwmIrqHandler();
+}
+
+// GPI0/PWM from compare channel 0 of the timer, the player switches to
+// PWM_MODE when a pass is written step by step.
+static bool _initPwmBackend(void)
+{
+    CMU_ClockEnable(DA7280_PWM_TIMER_CLOCK, true);
+    CMU_ClockEnable(cmuClock_GPIO, true);
+    GPIO_PinModeSet(DA7280_PWM_PORT, DA7280_PWM_PIN, gpioModePushPull, 0);
+    GPIO->TIMERROUTE[DA7280_PWM_TIMER_NUM].ROUTEEN = GPIO_TIMER_ROUTEEN_CC0PEN;
+    GPIO->TIMERROUTE[DA7280_PWM_TIMER_NUM].CC0ROUTE =
+        ((uint32_t)DA7280_PWM_PORT << _GPIO_TIMER_CC0ROUTE_PORT_SHIFT) |
+        ((uint32_t)DA7280_PWM_PIN << _GPIO_TIMER_CC0ROUTE_PIN_SHIFT);
+
+    if (!da7280_pwmInit(DA7280_PWM_TIMER, 0, CMU_ClockFreqGet(DA7280_PWM_TIMER_CLOCK), DA7280_PWM_HZ))
+    {
+        return false;
+    }
+    NVIC_ClearPendingIRQ(DA7280_PWM_TIMER_IRQn);
+    NVIC_EnableIRQ(DA7280_PWM_TIMER_IRQn);
+    return da7280_setPlaybackBackend(PLAYBACK_PWM);
+}
+#endif
+
 // Application Init.
 void app_init(void)
 {
@@ -70,10 +121,29 @@ void app_init(void)
         }
 
         da7280_setBootStatus(BOOT_COMPLETED);
-        da7280_enableFreqTrack(true);
-        da7280_enableAcceleration(true);
-        da7280_enableRapidStop(true);
+
+        // One write to TOP_CFG1 instead of a read-modify-write per field
+        const regFieldValue topCfg1[] = {
+            { FREQ_TRACK_EN, true },
+            { ACCELERATION_EN, true },
+            { RAPID_STOP_EN, true }
+        };
+        da7280_writeFields(topCfg1, sizeof(topCfg1) / sizeof(topCfg1[0]));
         da7280_setVibrate(0);
+
+        // Boot configuration above is checked synchronously, from here on
+        // register writes are queued and complete from the I2C interrupt.
+        NVIC_ClearPendingIRQ(DA7280_I2C_IRQn);
+        NVIC_EnableIRQ(DA7280_I2C_IRQn);
+        da7280_enableAsyncTransfers(true);
+
+        // Faults are serviced when nIRQ asserts instead of polling IRQ_EVENT1
+        da7280_nirqInit();
+
+#if DA7280_PWM_BACKEND
+        // Stays on DRO_MODE if the timer cannot make the PWM frequency
+        _initPwmBackend();
+#endif
     } while (0);
 }
 
@@ -82,6 +152,8 @@ void app_process_action(void)
 {
     if (app_is_process_required())
     {
+        da7280_nirqService();
+
         if (da7280_getActivityDone())
         {
             const char msg[] = "Activity time ended. Please enter the specifications again!";
@@ -92,6 +164,25 @@ void app_process_action(void)
                 (const uint8_t *)msg);
             app_assert_status(sc);
 
+            // How closely the steps kept to their schedule, for the session record
+            playbackTimingStats timing;
+            char stats[MSG_MAX_LEN];
+            da7280_getPlaybackTimingStats(&timing);
+            int len = snprintf(stats, sizeof(stats),
+                               "Timing: %lu deadlines, late max %lu us, mean %lu us, jitter %lu us, drift %ld us",
+                               (unsigned long)timing.deadlines, (unsigned long)timing.maxLatenessUs,
+                               (unsigned long)timing.meanLatenessUs, (unsigned long)timing.meanJitterUs,
+                               (long)timing.driftUs);
+            if (len > 0)
+            {
+                sc = sl_bt_gatt_server_send_notification(
+                    _conn_handle,
+                    gattdb_message_response,
+                    ((size_t)len < sizeof(stats)) ? (size_t)len : sizeof(stats) - 1,
+                    (const uint8_t *)stats);
+                app_assert_status(sc);
+            }
+
             da7280_setActivityDone(false);
         }
         /////////////////////////////////////////////////////////////////////////////
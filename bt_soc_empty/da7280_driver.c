@@ -1,17 +1,88 @@
 #include "da7280_driver.h"
+#include "da7280_i2c_async.h"
 #include "da7280_patterns.h"
+#include "da7280_wavemem.h"
+#include "da7280_ramp.h"
+#include "da7280_pwm.h"
 #include "gatt_db.h"
 #include "sl_sleeptimer.h"
+#include "sl_udelay.h"
+#include "sl_component_catalog.h"
+#if defined(SL_CATALOG_POWER_MANAGER_PRESENT)
+#include "sl_power_manager.h"
+#endif
 #include "app.h"
 // local includes
 #include "math.h"
 #include <stdio.h>
 
 #define ARR_MAX_LEN 128
-
-static uint8_t snpMemCopy[100] = {0};
-static sl_i2cspm_t* _i2cPort;
-static const uint8_t _address = DEF_ADDR;
+#define BURST_MAX_REGS 16
+#define READ_MAX_LEN 32     // longest single burst read of _readNonConsReg()
+#define READ_GAP_MAX 3      // unwanted registers a burst read may span instead of starting a new one
+#define MEM_WRITE_GAP_MAX 2 // unchanged bytes a waveform memory write may span instead of starting a new one
+#define PASS_PAUSE_MS 500   // silence between two passes of a pattern
+
+// Field updates collected between _beginBurst() and _commitBurst() for the
+// registers firstReg..firstReg+numRegs-1, written out as consecutive bursts.
+typedef struct
+{
+    bool     open;
+    uint8_t  firstReg;
+    uint8_t  numRegs;
+    uint16_t dirty;
+    uint8_t  values[BURST_MAX_REGS];
+} regBurst;
+
+// Everything the driver knows about one DA7280. Every da7280_* call acts on
+// the instance selected by da7280_select(), _devices[0] by default.
+struct da7280Device
+{
+    sl_i2cspm_t* port;
+    uint8_t  address;
+    uint8_t  muxChannel;                // DA7280_NO_MUX_CHANNEL if on the bus directly
+    uint8_t  snpMemCopy[TOTAL_MEM_REGISTERS];
+    // One bit per byte of snpMemCopy that the waveform memory may not hold yet.
+    // All of them after reset, a failed write leaves its bytes set.
+    uint8_t  snpMemDirty[(TOTAL_MEM_REGISTERS + 7) / 8];
+    // Shadow copy of the configuration registers (0x00..0x83), so read-modify-write
+    // updates do not have to read the register back over the bus first.
+    uint8_t  regShadow[SNP_MEM_X];
+    bool     regShadowValid[SNP_MEM_X];
+    // Largest TOP_CTL2 value for the current ACCELERATION_EN setting, 0 until
+    // resolved from TOP_CFG1. Kept in sync by da7280_enableAcceleration().
+    uint8_t  maxAmplitude;
+    // Sequence of each pattern in waveform memory, WAVEMEM_NOT_PACKED if it is
+    // not resident. Reset by da7280_begin().
+    uint8_t  residentSeq[PATTERN_MAP_SIZE];
+    // Last da7280_loadPattern() of each resident pattern, 0 for patterns that
+    // were only packed along. The least recently used are evicted first.
+    uint32_t residentUse[PATTERN_MAP_SIZE];
+    uint32_t useClock;
+    // Format the resident sequences were encoded in. After ACCELERATION_EN,
+    // the amplitude limit or WAV_MEM_BASE_ADDR change they are all re-encoded.
+    wavememFormat residentFormat;
+    patternCacheStats cacheStats;
+    // Pattern mapped to each GPI by da7280_mapGpiPattern(), PATTERN_MAP_SIZE if
+    // none. Mapped patterns are never evicted.
+    uint8_t  gpiPattern[DA7280_NUM_GPI];
+    // Pattern about to play while the next playlist entry is pre-loaded, not
+    // evicted either. PATTERN_MAP_SIZE if none.
+    uint8_t  pinnedPattern;
+};
+
+static da7280Device  _devices[DA7280_MAX_DEVICES];
+static size_t        _num_devices = 1;      // _devices[0] is da7280_begin()'s
+static da7280Device *_dev = &_devices[0];
+// I2C mux in front of the devices with a muxChannel and the channels it has
+// enabled, 0 while unknown
+static uint8_t _muxAddress = 0;
+static uint8_t _muxChannels = 0;
+// Channels of a group da7280_startGroup() writes to at once, 0 otherwise
+static uint8_t _muxGroup = 0;
+
+static regBurst _burst = {0};
+static bool     _asyncEnabled = false;
 
 static uint8_t _weight = 0;
 static uint8_t _available_patterns[ARR_MAX_LEN] = {0xFF};
@@ -20,13 +91,93 @@ static uint8_t _pattern_idx = 0xFF;
 static uint32_t _activity_time_ms = 0;
 static bool     _activity_done = false;
 
+// Where da7280_performActivity() is within a pass. The sleeptimer callback
+// only raises _play_due, the bus is driven from the super loop. Deadlines
+// are offsets from the activity write, so the time a step waits for the
+// loop or the bus is not carried into the next one.
+typedef enum
+{
+    PLAY_PASS,      // next pass starts, after the pause if there was one
+    PLAY_SEQUENCE,  // the pass plays from waveform memory
+    PLAY_STEPS      // the pass is written step by step, _play_step is next
+} playPhase;
+
+static playPhase _play_phase = PLAY_PASS;
+static uint8_t   _play_step = 0;
+static volatile bool _play_due = false;
+static sl_sleeptimer_timer_handle_t _play_timer;
+static uint64_t  _play_start_tick = 0;
+static uint64_t  _play_deadline_us = 0;    // of the boundary handled next
+static playbackTimingStats _timing_stats = {0};
+static uint64_t  _lateness_sum_us = 0;
+static uint64_t  _jitter_sum_us = 0;
+static uint32_t  _last_lateness_us = 0;
+// Ramp that opens each step when the shape is not RAMP_STEP, see
+// da7280_setStepRamp()
+static rampShape _ramp_shape = RAMP_STEP;
+static uint16_t  _ramp_ms = 0;
+static uint16_t  _ramp_rate_hz = RAMP_MAX_RATE_HZ;
+static rampState _play_ramp = {0};
+static uint8_t   _play_level = 0;       // last level written by the player
+static uint64_t  _step_end_us = 0;      // deadline of the end of the current step
+// Backend of the passes written step by step, see da7280_setPlaybackBackend().
+// _play_pwm is set while the device is in PWM_MODE for one of them.
+static playbackBackend _backend = PLAYBACK_DRO;
+static bool      _play_pwm = false;
+// Entries queued by da7280_queuePattern(), from _playlist_head on. While
+// any are left they choose the pattern of every pass instead of
+// _pattern_idx, and the session ends with them instead of the activity time.
+static playlistEntry _playlist[PLAYLIST_MAX_ENTRIES];
+static uint8_t   _playlist_head = 0;
+static uint8_t   _playlist_len = 0;
+
 static STATE_MACHINE _current_state = IDLE;
 static BOOT_STATUS _boot_sts = BOOT_IN_PROGRESS;
 
 static bool _writeRegister(uint8_t, uint8_t, uint8_t, uint8_t);
-static bool _writeWaveFormMemory(uint8_t waveFormArray[]);
+static bool _writeField(regField, uint8_t);
+static bool _writeConsReg(uint8_t regs[], size_t);
+static bool _setWriteMode(uint8_t);
+static uint8_t _cachedRegister(uint8_t);
+static void _beginBurst(uint8_t, uint8_t);
+static bool _commitBurst(void);
+static bool _writeWaveFormMemory(const uint8_t waveFormArray[], size_t, size_t);
+static void _stageWaveFormMemory(const uint8_t image[], size_t);
+static bool _commitWaveFormMemory(size_t);
+static bool _unlockWaveFormMemory(uint8_t *);
+static bool _restoreOperationMode(uint8_t);
+static bool _isWaveFormDirty(size_t);
+static void _markWaveFormDirty(size_t, size_t, bool);
 static uint8_t _readRegister(uint8_t);
+static bool _readRegisterChecked(uint8_t, uint8_t *);
+static bool _readConsReg(uint8_t regs[], size_t);
+static bool _readNonConsReg(uint8_t regs[], size_t);
+static bool _beginDevice(void);
+static bool _selectMuxChannels(void);
+static bool _transfer(I2C_TransferSeq_TypeDef *);
+static bool _transferWrite(I2C_TransferSeq_TypeDef *);
+static void _onWriteDone(I2C_TransferReturn_TypeDef, void *);
+static bool _isVolatileRegister(uint8_t);
+static void _loadRegisterShadow(void);
+static uint8_t _amplitudeLimit(void);
+static uint8_t _highestBit(uint8_t);
+static void _waitUntilTick(uint64_t);
 static void _resetStateMachine();
+static void _onPlayTimer(sl_sleeptimer_timer_handle_t *, void *);
+static void _armPlayTimer(uint32_t);
+static void _recordLateness(void);
+static void _stopPlayback(void);
+static void _startSession(uint32_t);
+static void _writeLevel(uint8_t);
+static void _leavePwm(void);
+static size_t _patternSteps(size_t, wavememStep[], size_t, void *);
+static void _clearResidents(void);
+static bool _isGpiPattern(uint8_t);
+static wavememFormat _currentFormat(void);
+static bool _residentsStale(const wavememFormat *);
+static bool _writeGpiControl(uint8_t, uint8_t, uint8_t, uint8_t);
+static bool _followGpiPatterns(void);
+static bool _dropGpiMappings(void);
 
 
 void da7280_setActivityDone(bool status)
@@ -46,7 +197,8 @@ void da7280_setBootStatus(BOOT_STATUS status)
 
 bool da7280_isActivityTimeSet()
 {
-  return 0 != _activity_time_ms;
+  // The step that uses up the activity time still has to be ended
+  return 0 != _activity_time_ms || PLAY_PASS != _play_phase || 0 != _playlist_len;
 }
 
 void da7280_performActivity()
@@ -54,6 +206,16 @@ void da7280_performActivity()
   if (_current_state != ACTIVE) {
     return;
   }
+  // Nothing to do until the timer of the current step or pause expires
+  if (!_play_due) {
+    return;
+  }
+  _play_due = false;
+
+  if (_play_phase == PLAY_PASS && _playlist_len > 0)
+    {
+      _pattern_idx = _playlist[_playlist_head].patternIdx;
+    }
   const PatternMapEntry *entry = &pattern_map[_pattern_idx];
   const PatternStep    *steps = entry->steps;
   size_t                count = entry->count;
@@ -61,41 +223,280 @@ void da7280_performActivity()
   if (count == 0) {
     // no steps? something happened, let's leave :D
     _current_state = IDLE;
+    _activity_time_ms = 0;
     return;
   }
 
-  if (_activity_time_ms == 0)
+  if (_play_phase == PLAY_PASS)
     {
-      da7280_setVibrate(0);
-      da7280_processUserInput(0xFF, 0xFF, NULL, 0);
+      // Playlist passes are played in full, whatever the activity time
+      bool queued = _playlist_len > 0;
+      if (!queued && _activity_time_ms == 0)
+        {
+          _leavePwm();
+          da7280_setVibrate(0);
+          da7280_processUserInput(0xFF, 0xFF, NULL, 0);
+          return;
+        }
+
+      // Waveform memory only plays the hard steps
+      // Only filled by da7280_loadPattern(), which ramped passes skip
+      wavememTiming timing = {0};
+      bool resident = (_ramp_shape == RAMP_STEP) && da7280_loadPattern(_pattern_idx, &timing);
+      if (resident && queued && _play_level == 0 && _playlist_len > 1 &&
+          _playlist[_playlist_head].repetitions == 1 && _playlist[_playlist_head].gapMs == 0)
+        {
+          // No gap ahead of the next entry to upload its pattern in, it
+          // has to be now while nothing plays. Only if both fit, the
+          // pattern about to play is pinned.
+          uint8_t next = _playlist[(_playlist_head + 1) % PLAYLIST_MAX_ENTRIES].patternIdx;
+          if (!da7280_isPatternResident(next))
+            {
+              wavememTiming nextTiming;
+              _dev->pinnedPattern = _pattern_idx;
+              da7280_loadPattern(next, &nextTiming);
+              _dev->pinnedPattern = PATTERN_MAP_SIZE;
+            }
+        }
+
+      // A pass from memory is accounted at the length the IC plays it
+      uint32_t played_ms = (timing.playedUs + 500) / 1000;
+      if (resident && (queued || played_ms <= _activity_time_ms))
+        {
+          // The whole pass plays from waveform memory, no bus traffic between steps
+          _leavePwm();
+          da7280_playPattern(_pattern_idx);
+          if (!queued)
+            {
+              _activity_time_ms -= played_ms;
+            }
+          // and ends in silence
+          _play_level = 0;
+          _play_phase = PLAY_SEQUENCE;
+          _recordLateness();
+          _armPlayTimer(timing.playedUs);
+          return;
+        }
+
+      // Last, cut short or ramped pass, or a pattern that does not fit the memory
+      if (_backend == PLAYBACK_PWM && !_play_pwm)
+        {
+          // The duty cycle is in place before the IC samples it
+          da7280_pwmSetAcceleration(_amplitudeLimit() == 0x7F);
+          da7280_pwmSetLevel(_play_level);
+          da7280_setOperationMode(PWM_MODE);
+#if defined(SL_CATALOG_POWER_MANAGER_PRESENT)
+          // The TIMER stops in EM2 and would freeze the duty cycle
+          sl_power_manager_add_em_requirement(SL_POWER_MANAGER_EM1);
+#endif
+          _play_pwm = true;
+        }
+      else if (_backend == PLAYBACK_DRO && _play_pwm)
+        {
+          _leavePwm();
+        }
+      else if (!_play_pwm)
+        {
+          // Whatever a pass from memory or a failed load left the IC in
+          da7280_setOperationMode(DRO_MODE);
+        }
+      _play_step = 0;
+      _play_phase = PLAY_STEPS;
+    }
+
+  if (_play_phase == PLAY_STEPS && !da7280_rampDone(&_play_ramp))
+    {
+      // Next sample of the ramp that opens the current step
+      uint8_t level = da7280_rampNext(&_play_ramp);
+      if (level != _play_level)
+        {
+          _writeLevel(level);
+          _play_level = level;
+        }
+      _recordLateness();
+      _armPlayTimer(da7280_rampDone(&_play_ramp) ? _step_end_us - _play_deadline_us
+                                                 : 1000000u / _ramp_rate_hz);
       return;
     }
 
-  for(uint8_t i = 0; i < count; i++)
+  if (_play_phase == PLAY_STEPS && _play_step < count)
     {
-      da7280_setVibrate(steps[i].force_pct);
-      sl_sleeptimer_delay_millisecond(steps[i].duration_ms);
+      uint16_t duration_ms = steps[_play_step].duration_ms;
+      uint16_t samples = 1;
 
-      if(steps[i].duration_ms > _activity_time_ms)
+      if (_ramp_shape != RAMP_STEP)
+        {
+          // The ramp ends one sample before the step at the latest
+          uint32_t fit = ((uint32_t)duration_ms * _ramp_rate_hz) / 1000u;
+          samples = da7280_rampSamples(_ramp_ms, _ramp_rate_hz);
+          if (samples > fit)
+            {
+              samples = (fit > 0) ? (uint16_t)fit : 1;
+            }
+        }
+      da7280_rampInit(&_play_ramp, _ramp_shape, _play_level, steps[_play_step].force_pct, samples);
+      if (_play_pwm && samples > 1 && samples <= DA7280_PWM_TABLE_LEN)
+        {
+          // Interrupts play the whole ramp, the super loop only wakes per step
+          uint8_t levels[DA7280_PWM_TABLE_LEN];
+          for (uint16_t i = 0; i < samples; i++)
+            {
+              levels[i] = da7280_rampNext(&_play_ramp);
+            }
+          da7280_pwmStream(levels, samples, 1000000u / _ramp_rate_hz);
+          _play_level = levels[samples - 1];
+        }
+      else
+        {
+          _play_level = da7280_rampNext(&_play_ramp);
+          _writeLevel(_play_level);
+        }
+      _step_end_us = _play_deadline_us + duration_ms * 1000u;
+      if (_playlist_len > 0)
+        {
+          _play_step++;
+        }
+      else if(duration_ms > _activity_time_ms)
         {
+          // Played out in full, the pass ends after it
           _activity_time_ms = 0;
-          break;
+          _play_step = count;
+        }
+      else
+        {
+          _activity_time_ms -= duration_ms;
+          _play_step++;
         }
-      _activity_time_ms -= steps[i].duration_ms;
+      _recordLateness();
+      _armPlayTimer(da7280_rampDone(&_play_ramp) ? duration_ms * 1000u : 1000000u / _ramp_rate_hz);
+      return;
+    }
+
+  // End of the pass, pause before the next one. A playlist pauses for the
+  // gap of the entry instead and holds the last level into a next pass
+  // without one.
+  bool     queued = _playlist_len > 0;
+  uint32_t pause_ms = queued ? _playlist[_playlist_head].gapMs : PASS_PAUSE_MS;
+  if (queued && --_playlist[_playlist_head].repetitions == 0)
+    {
+      _playlist_head = (_playlist_head + 1) % PLAYLIST_MAX_ENTRIES;
+      _playlist_len--;
     }
-  da7280_setVibrate(0);
-  if (500 > _activity_time_ms)
+  if (_play_phase == PLAY_STEPS && (pause_ms > 0 || _playlist_len == 0))
     {
+      _writeLevel(0);
+      _play_level = 0;
+    }
+  _play_phase = PLAY_PASS;
+  _recordLateness();
+  if (queued ? _playlist_len == 0 : pause_ms > _activity_time_ms)
+    {
+      _leavePwm();
       _activity_time_ms = 0;
       da7280_setActivityDone(true);
       da7280_processUserInput(0xFF, 0xFF, NULL, 0);
       app_proceed();
+      return;
     }
-  else
+  if (!queued)
+    {
+      _activity_time_ms -= pause_ms;
+    }
+  else if (pause_ms > 0 && _ramp_shape == RAMP_STEP &&
+           !da7280_isPatternResident(_playlist[_playlist_head].patternIdx))
+    {
+      // The gap hides the upload of the pattern of the next pass
+      wavememTiming timing;
+      da7280_loadPattern(_playlist[_playlist_head].patternIdx, &timing);
+    }
+  _armPlayTimer(pause_ms * 1000u);
+}
+
+bool da7280_queuePattern(uint8_t patternIdx, uint8_t repetitions, uint16_t gapMs)
+{
+  if (_playlist_len >= PLAYLIST_MAX_ENTRIES || patternIdx >= PATTERN_MAP_SIZE ||
+      pattern_map[patternIdx].count == 0 || repetitions == 0)
+    {
+      return false;
+    }
+  playlistEntry *tail = &_playlist[(_playlist_head + _playlist_len) % PLAYLIST_MAX_ENTRIES];
+  tail->patternIdx = patternIdx;
+  tail->repetitions = repetitions;
+  tail->gapMs = gapMs;
+  _playlist_len++;
+  return true;
+}
+
+bool da7280_startPlaylist(void)
+{
+  if (BOOT_COMPLETED != _boot_sts || _current_state == ACTIVE || _playlist_len == 0)
+    {
+      return false;
+    }
+  if (_ramp_shape == RAMP_STEP)
+    {
+      // Last entry first: the least recently loaded are evicted first, what
+      // does not fit is what is needed last
+      for (uint8_t i = _playlist_len; i > 0; i--)
+        {
+          wavememTiming timing;
+          da7280_loadPattern(_playlist[(_playlist_head + i - 1) % PLAYLIST_MAX_ENTRIES].patternIdx, &timing);
+        }
+    }
+  _pattern_idx = _playlist[_playlist_head].patternIdx;
+  _startSession(0);
+  return true;
+}
+
+void da7280_clearPlaylist(void)
+{
+  _playlist_head = 0;
+  _playlist_len = 0;
+}
+
+uint8_t da7280_getPlaylistLength(void)
+{
+  return _playlist_len;
+}
+
+bool da7280_setStepRamp(rampShape shape, uint16_t rampMs, uint16_t rateHz)
+{
+  if (shape >= RAMP_NUM_SHAPES || rateHz == 0 || rateHz > RAMP_MAX_RATE_HZ)
+    {
+      return false;
+    }
+  _ramp_shape = shape;
+  _ramp_ms = rampMs;
+  _ramp_rate_hz = rateHz;
+  return true;
+}
+
+bool da7280_setPlaybackBackend(playbackBackend backend)
+{
+  if (backend > PLAYBACK_PWM || (backend == PLAYBACK_PWM && !da7280_pwmIsReady()))
+    {
+      return false;
+    }
+  _backend = backend;
+  return true;
+}
+
+playbackBackend da7280_getPlaybackBackend(void)
+{
+  return _backend;
+}
+
+void da7280_getPlaybackTimingStats(playbackTimingStats *stats)
+{
+  *stats = _timing_stats;
+  if (stats->deadlines > 0)
     {
-      _activity_time_ms -= 500;
+      stats->meanLatenessUs = (uint32_t)(_lateness_sum_us / stats->deadlines);
+    }
+  if (stats->deadlines > 1)
+    {
+      stats->meanJitterUs = (uint32_t)(_jitter_sum_us / (stats->deadlines - 1));
     }
-  sl_sleeptimer_delay_millisecond(500);
 }
 
 uint8_t da7280_processUserInput(uint32_t event_value, uint16_t characteristic, char *out_buf, size_t out_buf_len)
@@ -206,8 +607,7 @@ uint8_t da7280_processUserInput(uint32_t event_value, uint16_t characteristic, c
     {
       if (gattdb_activity_value == characteristic)
         {
-          _activity_time_ms = (uint32_t)event_value*1000;
-          _current_state = ACTIVE;
+          _startSession((uint32_t)event_value*1000);
           snprintf(out_buf, out_buf_len,
                    "Activity started! It will last for %u seconds!",
                    (uint8_t)event_value);
@@ -224,6 +624,7 @@ uint8_t da7280_processUserInput(uint32_t event_value, uint16_t characteristic, c
     {
       if (0xFF == characteristic)
         {
+          _stopPlayback();
           _current_state = IDLE;
         }
       else
@@ -245,10 +646,113 @@ uint8_t da7280_processUserInput(uint32_t event_value, uint16_t characteristic, c
 
 bool da7280_begin(sl_i2cspm_t *i2cPort)
 {
-    _i2cPort = i2cPort;
-    uint8_t chipRev = _readRegister(CHIP_REV_REG);
+    _dev = &_devices[0];
+    _dev->port = i2cPort;
+    _dev->address = DEF_ADDR;
+    _dev->muxChannel = DA7280_NO_MUX_CHANNEL;
+    return _beginDevice();
+}
+
+da7280Device *da7280_addDevice(sl_i2cspm_t *i2cPort, uint8_t address, uint8_t muxChannel)
+{
+    if (_num_devices >= DA7280_MAX_DEVICES ||
+        (muxChannel != DA7280_NO_MUX_CHANNEL && (_muxAddress == 0 || muxChannel > 7)))
+    {
+        return NULL;
+    }
+
+    da7280Device *selected = _dev;
+    _dev = &_devices[_num_devices];
+    _dev->port = i2cPort;
+    _dev->address = address;
+    _dev->muxChannel = muxChannel;
+    if (!_beginDevice())
+    {
+        _dev = selected;
+        return NULL;
+    }
+    return &_devices[_num_devices++];
+}
+
+void da7280_select(da7280Device *dev)
+{
+    _dev = dev;
+}
+
+da7280Device *da7280_getSelected(void)
+{
+    return _dev;
+}
+
+void da7280_setMux(uint8_t address)
+{
+    _muxAddress = address;
+    _muxChannels = 0;
+}
+
+bool da7280_startGroup(da7280Device *const devs[], const uint8_t patterns[], size_t n)
+{
+    da7280Device *selected = _dev;
+    uint8_t start[DA7280_MAX_DEVICES] = {0};
+    uint8_t channels = 0;
+    bool    shared = (n > 1);
+    bool    ok = (n <= DA7280_MAX_DEVICES);
+
+    // Everything but the start is written ahead, each start is then a
+    // single register write
+    for (size_t i = 0; i < n && ok; i++)
+    {
+        wavememTiming timing;
+        _dev = devs[i];
+        ok = da7280_loadPattern(patterns[i], &timing) &&
+             (_cachedRegister(SEQ_CTL2) == _dev->residentSeq[patterns[i]] ||
+              da7280_setSeqControl(0, _dev->residentSeq[patterns[i]])) &&
+             _readRegisterChecked(TOP_CTL1, &start[i]);
+        start[i] = (uint8_t)(start[i] & ~(REG_FIELD_MASK(OPERATION_MODE) | REG_FIELD_MASK(SEQ_START))) |
+                   (uint8_t)(RTWM_MODE << OPERATION_MODE.shift) | REG_FIELD_MASK(SEQ_START);
+
+        // Behind the mux at one address, one write with all their channels
+        // enabled starts them together
+        shared = shared && _dev->muxChannel != DA7280_NO_MUX_CHANNEL && _dev->port == devs[0]->port &&
+                 _dev->address == devs[0]->address && start[i] == start[0];
+        channels |= (_dev->muxChannel != DA7280_NO_MUX_CHANNEL) ? (uint8_t)(1u << _dev->muxChannel) : 0;
+    }
+
+    if (ok && shared)
+    {
+        _dev = devs[0];
+        _muxGroup = channels;
+        ok = _writeRegister(TOP_CTL1, 0x00, start[0], 0);
+        _muxGroup = 0;
+    }
+    else
+    {
+        for (size_t i = 0; i < n && ok; i++)
+        {
+            _dev = devs[i];
+            ok = _writeRegister(TOP_CTL1, 0x00, start[i], 0);
+        }
+    }
+    _dev = selected;
+    return ok;
+}
+
+void da7280_enableAsyncTransfers(bool enable)
+{
+    if (enable == _asyncEnabled)
+    {
+        return;
+    }
 
-    return (chipRev == CHIP_REV);
+    if (enable)
+    {
+        da7280_asyncInit(_dev->port);
+    }
+    else
+    {
+        da7280_asyncFlush();
+    }
+    _asyncEnabled = enable;
 }
 
 bool da7280_setActuatorType(uint8_t type)
@@ -256,36 +760,89 @@ bool da7280_setActuatorType(uint8_t type)
     if (type != LRA_TYPE && type != ERM_TYPE)
         return false;
 
-    return _writeRegister(TOP_CFG1, 0xDF, type, 5);
+    return _writeField(ACTUATOR_TYPE, type);
+}
+
+bool da7280_writeFields(const regFieldValue updates[], size_t n)
+{
+    if (n == 0)
+    {
+        return true;
+    }
+
+    uint8_t firstReg = updates[0].field.reg;
+    uint8_t lastReg  = updates[0].field.reg;
+    for (size_t i = 1; i < n; i++)
+    {
+        firstReg = (updates[i].field.reg < firstReg) ? updates[i].field.reg : firstReg;
+        lastReg  = (updates[i].field.reg > lastReg) ? updates[i].field.reg : lastReg;
+    }
+
+    // Inside an open burst the updates are simply staged with the others
+    bool burst = !_burst.open && (lastReg - firstReg) < BURST_MAX_REGS;
+    if (burst)
+    {
+        _beginBurst(firstReg, lastReg);
+    }
+
+    bool ok = true;
+    for (size_t i = 0; i < n; i++)
+    {
+        ok = _writeField(updates[i].field, updates[i].value) && ok;
+        if (updates[i].field.reg == TOP_CFG1)
+        {
+            // ACCELERATION_EN may have changed, resolved again from the shadow
+            _dev->maxAmplitude = 0;
+        }
+    }
+
+    if (burst)
+    {
+        ok = _commitBurst() && ok;
+    }
+    return ok;
 }
 
 bool da7280_setMotorSettings(hapticSettings userSettings)
 {
-    return (da7280_setActuatorType(userSettings.motorType) && da7280_setActuatorABSVolt(userSettings.absVolt) &&
+    // FRQ_LRA_PER_H..TOP_CFG1 are staged and flushed together instead of one RMW per setter
+    _beginBurst(FRQ_LRA_PER_H, TOP_CFG1);
+    bool staged = (da7280_setActuatorType(userSettings.motorType) && da7280_setActuatorABSVolt(userSettings.absVolt) &&
         da7280_setActuatorNOMVolt(userSettings.nomVolt) && da7280_setActuatorIMAX(userSettings.currMax) &&
         da7280_setActuatorImpedance(userSettings.impedance) && da7280_setActuatorLRAfreq(userSettings.lraFreq));
+
+    return _commitBurst() && staged;
 }
 
 hapticSettings da7280_getMotorSettings()
 {
-    hapticSettings temp;
-    uint16_t v2i_factor;
-    temp.nomVolt = _readRegister(ACTUATOR1) * (23.4 * pow(10.0, -3.0));
-    temp.absVolt = _readRegister(ACTUATOR2) * (23.4 * pow(10.0, -3.0));
-    temp.currMax = (_readRegister(ACTUATOR3) * 7.2) + 28.6;
-    v2i_factor = (_readRegister(CALIB_V2I_H) << 8) | _readRegister(CALIB_IMP_L);
-    temp.impedance = (v2i_factor * 1.6104) / (_readRegister(ACTUATOR3) + 4);
+    hapticSettings temp = {0};
+
+    // ACTUATOR1 through CALIB_V2I_L in one read
+    uint8_t regs[1 + CALIB_V2I_L - ACTUATOR1 + 1] = { ACTUATOR1 };
+    if (!_readConsReg(regs, sizeof(regs)))
+    {
+        return temp;
+    }
+
+    uint8_t currVal = regs[1 + ACTUATOR3 - ACTUATOR1] & REG_FIELD_MASK(IMAX);
+    uint16_t v2i_factor = (regs[1 + CALIB_V2I_H - ACTUATOR1] << 8) | regs[1 + CALIB_V2I_L - ACTUATOR1];
+
+    temp.nomVolt = regs[1 + ACTUATOR1 - ACTUATOR1] * (23.4 * pow(10.0, -3.0));
+    temp.absVolt = regs[1 + ACTUATOR2 - ACTUATOR1] * (23.4 * pow(10.0, -3.0));
+    temp.currMax = (currVal * 7.2) + 28.6;
+    temp.impedance = (v2i_factor * 1.6104) / (currVal + 4);
     return temp;
 }
 
 bool da7280_setOperationMode(OPERATION_MODES mode)
 {
-    if (mode > RTWM_MODE)
+    if (mode > ETWM_MODE)
     {
         return false;
     }
 
-    return _writeRegister(TOP_CTL1, 0xF8, mode, 0);
+    return _writeField(OPERATION_MODE, mode);
 
 }
 
@@ -337,7 +894,7 @@ bool da7280_setActuatorIMAX(float maxCurr)
 
     maxCurr = (maxCurr - 28.6) / 7.2;
 
-    return _writeRegister(ACTUATOR3, 0xE0, (uint8_t)(maxCurr), 0);
+    return _writeField(IMAX, (uint8_t)(maxCurr));
 }
 
 uint16_t da7280_getActuatorIMAX()
@@ -357,7 +914,7 @@ bool da7280_setActuatorImpedance(float motorImpedance)
     uint8_t msbImpedance;
     uint8_t lsbImpedance;
     uint16_t v2iFactor;
-    uint8_t maxCurr = _readRegister(ACTUATOR3) | 0x1F;
+    uint8_t maxCurr = _cachedRegister(ACTUATOR3) | 0x1F;
 
     v2iFactor = (motorImpedance * (maxCurr + 4)) / 1.6104;
     msbImpedance = (v2iFactor - (v2iFactor & 0x00FF)) / 256;
@@ -369,21 +926,28 @@ bool da7280_setActuatorImpedance(float motorImpedance)
 uint16_t da7280_getActuatorImpedance()
 {
 
-    uint16_t regValMSB = _readRegister(CALIB_V2I_H);
-    uint8_t regValLSB = _readRegister(CALIB_V2I_L);
-    uint8_t currVal = _readRegister(ACTUATOR3) & 0x1F;
+    // ACTUATOR3, CALIB_V2I_H and CALIB_V2I_L in one read
+    uint8_t regs[4] = { ACTUATOR3 };
+    if (!_readConsReg(regs, sizeof(regs)))
+    {
+        return 0;
+    }
 
-    uint16_t v2iFactor = (regValMSB << 8) | regValLSB;
+    uint8_t currVal = regs[1] & REG_FIELD_MASK(IMAX);
+    uint16_t v2iFactor = (regs[2] << 8) | regs[3];
 
     return (v2iFactor * 1.6104) / (currVal + 4);
 }
 
 uint16_t da7280_readImpAdjus()
 {
-    uint8_t tempMSB = _readRegister(CALIB_IMP_H);
-    uint8_t tempLSB = _readRegister(CALIB_IMP_L);
+    uint8_t regs[3] = { CALIB_IMP_H };
+    if (!_readConsReg(regs, sizeof(regs)))
+    {
+        return 0;
+    }
 
-    uint16_t totalImp = (4 * 62.5 * pow(10.0, -3.0) * tempMSB) + (62.5 * pow(10.0, -3.0) * tempLSB);
+    uint16_t totalImp = (4 * 62.5 * pow(10.0, -3.0) * regs[1]) + (62.5 * pow(10.0, -3.0) * regs[2]);
     return totalImp;
 }
 
@@ -400,7 +964,7 @@ bool da7280_setActuatorLRAfreq(float frequency)
     msbFrequency = (lraPeriod - (lraPeriod & 0x007F)) / 128;
     lsbFrequency = (lraPeriod - 128 * (lraPeriod & 0xFF00));
 
-    return _writeRegister(FRQ_LRA_PER_H, 0x00, msbFrequency, 0) && _writeRegister(FRQ_LRA_PER_L, 0x80, lsbFrequency, 0);
+    return _writeRegister(FRQ_LRA_PER_H, 0x00, msbFrequency, 0) && _writeField(LRA_PER_L, lsbFrequency);
 }
 
 bool da7280_enableCoinERM()
@@ -415,53 +979,80 @@ bool da7280_enableCoinERM()
 
 bool da7280_enableAcceleration(bool enable)
 {
-    return _writeRegister(TOP_CFG1, 0xFB, enable, 2);
+    if (!_writeField(ACCELERATION_EN, enable))
+    {
+        return false;
+    }
+    _dev->maxAmplitude = enable ? 0x7F : 0xFF;
+    return true;
 }
 
 bool da7280_enableRapidStop(bool enable)
 {
-    return _writeRegister(TOP_CFG1, 0xFD, enable, 1);
+    return _writeField(RAPID_STOP_EN, enable);
 }
 
 bool da7280_enableAmpPid(bool enable)
 {
-    return _writeRegister(TOP_CFG1, 0xFE, enable, 0);
+    return _writeField(AMP_PID_EN, enable);
 }
 
 bool da7280_enableFreqTrack(bool enable)
 {
-    return _writeRegister(TOP_CFG1, 0xF7, enable, 3);
+    return _writeField(FREQ_TRACK_EN, enable);
 }
 
 bool da7280_setBemfFaultLimit(bool enable)
 {
-    return _writeRegister(TOP_CFG1, 0xEF, enable, 4);
+    return _writeField(BEMF_SENSE_EN, enable);
 }
 
 bool da7280_enableV2iFactorFreeze(bool enable)
 {
-    return _writeRegister(TOP_CFG4, 0x7F, enable, 7);
+    return _writeField(V2I_FACTOR_FREEZE, enable);
 }
 
 bool da7280_calibrateImpedanceDistance(bool enable)
 {
-    return _writeRegister(TOP_CFG4, 0xBF, enable, 6);
+    return _writeField(TST_CALIB_IMPEDANCE_DIS, enable);
 }
 
 bool da7280_setVibrate(uint8_t val)
 {
-    uint8_t accelState = _readRegister(TOP_CFG1);
-    accelState &= 0x04;
-    accelState = accelState >> 2;
+    uint8_t maxVal = _amplitudeLimit();
 
-    if ((accelState == ENABLE) && (val > 0x7F))
+    if (val > maxVal)
     {
-        val = 0x7F;
+        val = maxVal;
     }
 
     return _writeRegister(TOP_CTL2, 0x00, val, 0);
 }
 
+bool da7280_streamAmplitudes(const uint8_t *levels, size_t n, uint16_t period_us)
+{
+    uint8_t  maxVal = _amplitudeLimit();
+    uint32_t freq   = sl_sleeptimer_get_timer_frequency();
+    uint64_t start  = sl_sleeptimer_get_tick_count64();
+
+    for (size_t i = 0; i < n; i++)
+    {
+        uint8_t val = (levels[i] > maxVal) ? maxVal : levels[i];
+
+        // Deadlines are taken from the start of the stream so that the time
+        // spent on the bus does not accumulate into the cadence
+        _waitUntilTick(start + ((uint64_t)i * period_us * freq) / 1000000u);
+        if (!_writeRegister(TOP_CTL2, 0x00, val, 0))
+        {
+            return false;
+        }
+    }
+
+    // The last level is held for a full period as well
+    _waitUntilTick(start + ((uint64_t)n * period_us * freq) / 1000000u);
+    return true;
+}
+
 uint8_t da7280_getVibrate()
 {
     return _readRegister(TOP_CTL2);
@@ -478,7 +1069,7 @@ bool da7280_setFullBrake(uint8_t thresh)
     if (thresh > 15)
         return false;
 
-    return _writeRegister(TOP_CFG2, 0xF0, thresh, 0);
+    return _writeField(FULL_BRAKE_THR, thresh);
 }
 
 bool da7280_setMask(uint8_t mask)
@@ -496,7 +1087,7 @@ bool da7280_setBemf(uint8_t val)
     if (val > 3)
         return false;
 
-    return _writeRegister(TOP_INT_CFG1, 0xFC, val, 0);
+    return _writeField(BEMF_FAULT_LIM, val);
 }
 
 float da7280_getBemf()
@@ -520,7 +1111,8 @@ float da7280_getBemf()
 
 void da7280_clearIrq(uint8_t irq)
 {
-    _writeRegister(IRQ_EVENT1, ~irq, irq, 0);
+    // IRQ_EVENT1 is write-1-to-clear, writing back the other pending bits would clear them too
+    _writeRegister(IRQ_EVENT1, 0x00, irq, 0);
 }
 
 uint8_t da7280_addFrame(uint8_t gain, uint8_t timeBase, uint8_t snipIdLow)
@@ -532,159 +1124,1172 @@ uint8_t da7280_addFrame(uint8_t gain, uint8_t timeBase, uint8_t snipIdLow)
 
 bool da7280_playFromMemory(bool enable)
 {
-    return _writeRegister(TOP_CTL1, 0xEF, enable, 4);
+    return _writeField(SEQ_START, enable);
 }
 
 void da7280_eraseWaveformMemory()
 {
-    memset(snpMemCopy, 0, sizeof(snpMemCopy));
-    _writeWaveFormMemory(snpMemCopy);
-}
-
-event_t da7280_getIrqEvent()
-{
-    uint8_t irqEvent = _readRegister(IRQ_EVENT1);
-
-    if (!irqEvent)
-        return HAPTIC_SUCCESS;
-
-    switch (irqEvent)
-    {
-    case E_SEQ_CONTINUE:
-        return E_SEQ_CONTINUE;
-    case E_UVLO:
-        return E_UVLO;
-    case E_SEQ_DONE:
-        return E_SEQ_DONE;
-    case E_OVERTEMP_CRIT:
-        return E_OVERTEMP_CRIT;
-    case E_SEQ_FAULT:
-        return E_SEQ_FAULT;
-    case E_WARNING:
-        return E_WARNING;
-    case E_ACTUATOR_FAULT:
-        return E_ACTUATOR_FAULT;
-    case E_OC_FAULT:
-        return E_OC_FAULT;
-    default:
-        return (event_t)(irqEvent);
+    const uint8_t empty[TOTAL_MEM_REGISTERS] = {0};
+    uint8_t ctl1;
+    _stageWaveFormMemory(empty, TOTAL_MEM_REGISTERS);
+    if (_unlockWaveFormMemory(&ctl1))
+    {
+        _commitWaveFormMemory(TOTAL_MEM_REGISTERS);
     }
+    _restoreOperationMode(ctl1);
+    _clearResidents();
 }
 
-diag_status_t da7280_getEventDiag()
+bool da7280_verifyWaveformMemory(uint8_t *mismatched)
 {
-    uint8_t diag = _readRegister(IRQ_EVENT_SEQ_DIAG);
+    uint8_t regs[1 + TOTAL_MEM_REGISTERS];
+    uint8_t count = 0;
+    size_t  used = da7280_wavememImageUsed(_dev->snpMemCopy, _cachedRegister(MEM_CTL1));
 
-    switch (diag)
+    if (mismatched != NULL)
     {
-    case E_PWM_FAULT:
-        return E_PWM_FAULT;
-    case E_MEM_FAULT:
-        return E_MEM_FAULT;
-    case E_SEQ_ID_FAULT:
-        return E_SEQ_ID_FAULT;
-    default:
-        return NO_DIAG;
+        *mismatched = 0;
+    }
+    regs[0] = _cachedRegister(MEM_CTL1);
+    if (used == 0 || !_readConsReg(regs, 1 + used))
+    {
+        return false;
     }
-}
 
-status_t da7280_getIrqStatus()
-{
-    uint8_t status = _readRegister(IRQ_STATUS1);
-
-    switch (status)
-    {
-    case STA_SEQ_CONTINUE:
-        return STA_SEQ_CONTINUE;
-    case STA_UVLO_VBAT_OK:
-        return STA_UVLO_VBAT_OK;
-    case STA_PAT_DONE:
-        return STA_PAT_DONE;
-    case STA_OVERTEMP_CRIT:
-        return STA_OVERTEMP_CRIT;
-    case STA_PAT_FAULT:
-        return STA_PAT_FAULT;
-    case STA_WARNING:
-        return STA_WARNING;
-    case STA_ACTUATOR:
-        return STA_ACTUATOR;
-    case STA_OC:
-        return STA_OC;
-    default:
-        return STATUS_NOM;
+    if (da7280_wavememCrc(&regs[1], used) == da7280_wavememCrc(_dev->snpMemCopy, used))
+    {
+        // Holds the image, whatever was assumed since the last reset
+        _markWaveFormDirty(0, used, false);
+        return true;
     }
-}
 
-bool da7280_setSeqControl(uint8_t repetitions, uint8_t sequenceID)
-{
-    if (sequenceID > 15 || repetitions > 15)
-        return false;
+    for (size_t i = 0; i < used; i++)
+    {
+        bool differs = (regs[1 + i] != _dev->snpMemCopy[i]);
+        _markWaveFormDirty(i, 1, differs);
+        count += differs;
+    }
+    if (mismatched != NULL)
+    {
+        *mismatched = count;
+    }
 
-    return _writeRegister(SEQ_CTL2, 0xF0, sequenceID, 0) && _writeRegister(SEQ_CTL2, 0x0F, repetitions, 4);
+    uint8_t ctl1;
+    bool ok = _unlockWaveFormMemory(&ctl1) && _commitWaveFormMemory(used);
+    return _restoreOperationMode(ctl1) && ok;
 }
 
-static void _resetStateMachine()
+bool da7280_addSnippet(uint8_t ramp, uint8_t timeBase, uint8_t amplitude)
 {
-  _weight = 0;
-  _pattern_idx = 0xFF;
-  _parser_idx = 0;
-
-  for(uint8_t i = 0; i < ARR_MAX_LEN; i++)
+    if (ramp > 1 || timeBase > 7 || amplitude > 15)
     {
-      _available_patterns[i] = 0xFF;
+        return false;
     }
+
+    const uint8_t pwl = (uint8_t)((ramp << 7) | (timeBase << 4) | amplitude);
+    return da7280_addSnippets(&pwl, 1);
 }
 
-static bool _writeRegister(uint8_t reg, uint8_t mask, uint8_t bits, uint8_t startPos)
+bool da7280_addSnippets(const uint8_t snippets[], uint8_t numSnippets)
 {
-    uint8_t value = _readRegister(reg);
-    value &= mask;
-    value |= (bits << startPos);
-
-    uint8_t buf[2] = { reg, value };
-
-    I2C_TransferSeq_TypeDef seq = {0};
-    seq.addr        = _address << 1;
-    seq.flags       = I2C_FLAG_WRITE;
-    seq.buf[0].data = buf;
-    seq.buf[0].len  = sizeof(buf);
+    // Built on the current image, so a library goes out in one write
+    wavememImage image;
+    memcpy(image.bytes, _dev->snpMemCopy, sizeof(image.bytes));
+    if (!da7280_wavememAppendSnippets(&image, _cachedRegister(MEM_CTL1), snippets, numSnippets))
+    {
+        return false;
+    }
 
-    return (I2CSPM_Transfer(_i2cPort, &seq) == i2cTransferDone);
+    uint8_t ctl1;
+    _stageWaveFormMemory(image.bytes, image.used);
+    bool ok = _unlockWaveFormMemory(&ctl1) && _commitWaveFormMemory(image.used);
+    return _restoreOperationMode(ctl1) && ok;
 }
 
-static uint8_t _readRegister(uint8_t reg)
+bool da7280_loadPattern(uint8_t patternIdx, wavememTiming *timing)
 {
-    uint8_t result = 0;
+    memset(timing, 0, sizeof(*timing));
+    if (patternIdx >= PATTERN_MAP_SIZE)
+    {
+        return false;
+    }
 
-    I2C_TransferSeq_TypeDef seq = {0};
-    seq.addr        = _address << 1;
-    seq.flags       = I2C_FLAG_WRITE_READ;
-    seq.buf[0].data = &reg;
-    seq.buf[0].len  = 1;
-    seq.buf[1].data = &result;
-    seq.buf[1].len  = 1;
+    wavememFormat format = _currentFormat();
+    wavememStep steps[WAVEMEM_MAX_STEPS];
+    wavememBuilder builder;
 
-    if (I2CSPM_Transfer(_i2cPort, &seq) == i2cTransferDone) {
-        return result;
+    // Timing of the pattern on its own, the snippets it shares do not change it
+    size_t count = _patternSteps(patternIdx, steps, WAVEMEM_MAX_STEPS, NULL);
+    da7280_wavememInit(&builder, &format);
+    if (da7280_wavememAddSequence(&builder, steps, count, timing) < 0)
+    {
+        return false;
     }
-    return 0;
-}
+    // Residents encoded for another format are a miss, the repack below
+    // re-encodes all of them
+    bool stale = _residentsStale(&format);
+    if (_dev->residentSeq[patternIdx] != WAVEMEM_NOT_PACKED && !stale)
+    {
+        _dev->cacheStats.hits++;
+        _dev->residentUse[patternIdx] = ++_dev->useClock;
+        return true;
+    }
+    _dev->cacheStats.misses++;
+
+    // Residents keep their order so most of the image stays as it is; the
+    // least recently used are dropped until the pattern fits behind them
+    uint8_t order[PATTERN_MAP_SIZE];
+    uint8_t seqIds[PATTERN_MAP_SIZE];
+    size_t  n = 0;
+    for (uint8_t seq = 0; seq < WAVEMEM_MAX_SEQUENCES; seq++)
+    {
+        for (uint8_t i = 0; i < PATTERN_MAP_SIZE; i++)
+        {
+            if (_dev->residentSeq[i] == seq && i != patternIdx)
+            {
+                order[n++] = i;
+            }
+        }
+    }
+    for (;;)
+    {
+        order[n] = patternIdx;
+        da7280_wavememInit(&builder, &format);
+        if (da7280_wavememPack(&builder, n + 1, n + 1, _patternSteps, order, seqIds) == n + 1)
+        {
+            break;
+        }
 
-static bool _writeWaveFormMemory(uint8_t waveFormArray[])
-{
-    enum { BUF_LEN = 1 + TOTAL_MEM_REGISTERS };
-    uint8_t buf[BUF_LEN];
-    buf[0] = NUM_SNIPPETS_REG;
-    memcpy(&buf[1], waveFormArray, TOTAL_MEM_REGISTERS);
+        size_t lru = n;
+        for (size_t i = 0; i < n; i++)
+        {
+            if (!_isGpiPattern(order[i]) && order[i] != _dev->pinnedPattern &&
+                (lru == n || _dev->residentUse[order[i]] < _dev->residentUse[order[lru]]))
+            {
+                lru = i;
+            }
+        }
+        if (lru == n)
+        {
+            // Only patterns mapped to a GPI or pinned are left
+            return false;
+        }
+        memmove(&order[lru], &order[lru + 1], n - lru - 1);
+        n--;
+        _dev->cacheStats.evictions++;
+    }
+
+    // Free space goes to the other patterns of its mass the user can switch
+    // to without a new weight, then to the rest
+    size_t numRequired = ++n;
+    size_t numSameMass = n;
+    for (uint8_t pass = 0; pass < 2; pass++)
+    {
+        for (uint8_t i = 0; i < PATTERN_MAP_SIZE; i++)
+        {
+            bool sameMass = (pattern_map[i].mass_g == pattern_map[patternIdx].mass_g);
+            if (i != patternIdx && _dev->residentSeq[i] == WAVEMEM_NOT_PACKED && sameMass == (pass == 0))
+            {
+                order[n++] = i;
+            }
+        }
+        if (pass == 0)
+        {
+            numSameMass = n;
+        }
+    }
+    da7280_wavememPack(&builder, numSameMass - numRequired, 0, _patternSteps, &order[numRequired], &seqIds[numRequired]);
+    da7280_wavememPack(&builder, n - numSameMass, 0, _patternSteps, &order[numSameMass], &seqIds[numSameMass]);
+
+    wavememImage image;
+    uint8_t ctl1;
+    da7280_wavememBuild(&builder, &image);
+    _stageWaveFormMemory(image.bytes, image.used);
+    if (!_unlockWaveFormMemory(&ctl1) || !_commitWaveFormMemory(image.used))
+    {
+        // The IC may hold any mix of the old and the new image: nothing is
+        // resident, and the next load writes all of it instead of trusting
+        // _dev->snpMemCopy
+        _markWaveFormDirty(0, image.used, true);
+        memset(_dev->residentSeq, WAVEMEM_NOT_PACKED, sizeof(_dev->residentSeq));
+        _dropGpiMappings();
+        _restoreOperationMode(ctl1);
+        return false;
+    }
+
+    memset(_dev->residentSeq, WAVEMEM_NOT_PACKED, sizeof(_dev->residentSeq));
+    for (size_t i = 0; i < n; i++)
+    {
+        _dev->residentSeq[order[i]] = seqIds[i];
+        if (i >= numRequired)
+        {
+            _dev->residentUse[order[i]] = 0;
+        }
+    }
+    _dev->residentFormat = format;
+    _dev->residentUse[patternIdx] = ++_dev->useClock;
+    bool ok = _followGpiPatterns();
+    if (!ok)
+    {
+        // Not a hit next time, so the GPI inputs are written again
+        _dev->residentSeq[patternIdx] = WAVEMEM_NOT_PACKED;
+    }
+    return _restoreOperationMode(ctl1) && ok;
+}
+
+void da7280_getPatternCacheStats(patternCacheStats *stats)
+{
+    *stats = _dev->cacheStats;
+}
+
+void da7280_resetPatternCacheStats(void)
+{
+    memset(&_dev->cacheStats, 0, sizeof(_dev->cacheStats));
+}
+
+bool da7280_isPatternResident(uint8_t patternIdx)
+{
+    wavememFormat format = _currentFormat();
+    return patternIdx < PATTERN_MAP_SIZE && _dev->residentSeq[patternIdx] != WAVEMEM_NOT_PACKED &&
+           !_residentsStale(&format);
+}
+
+bool da7280_playPattern(uint8_t patternIdx)
+{
+    if (!da7280_isPatternResident(patternIdx))
+    {
+        return false;
+    }
+
+    // SEQ_CTL2 is shadowed, playing the same pattern again skips the write.
+    // No repetitions, so the register equals PS_SEQ_ID.
+    if (_cachedRegister(SEQ_CTL2) != _dev->residentSeq[patternIdx] && !da7280_setSeqControl(0, _dev->residentSeq[patternIdx]))
+    {
+        return false;
+    }
+
+    const regFieldValue start[] = {
+        { OPERATION_MODE, RTWM_MODE },
+        { SEQ_START, true }
+    };
+    return da7280_writeFields(start, sizeof(start) / sizeof(start[0]));
+}
+
+bool da7280_mapGpiSequence(uint8_t gpi, uint8_t sequenceID, GPI_POLARITIES polarity, GPI_MODES mode)
+{
+    if (gpi >= DA7280_NUM_GPI || sequenceID > 15 || polarity > GPI_BOTH_EDGES || mode > GPI_MULTI_PATTERN)
+    {
+        return false;
+    }
+
+    _dev->gpiPattern[gpi] = PATTERN_MAP_SIZE;
+    return _writeGpiControl(gpi, sequenceID, polarity, mode);
+}
+
+bool da7280_mapGpiPattern(uint8_t gpi, uint8_t patternIdx, GPI_POLARITIES polarity)
+{
+    if (gpi >= DA7280_NUM_GPI || patternIdx >= PATTERN_MAP_SIZE || polarity > GPI_BOTH_EDGES)
+    {
+        return false;
+    }
+
+    // The pattern mapped so far may be evicted to make room
+    uint8_t previous = _dev->gpiPattern[gpi];
+    wavememTiming timing;
+    _dev->gpiPattern[gpi] = PATTERN_MAP_SIZE;
+    if (!da7280_loadPattern(patternIdx, &timing))
+    {
+        _dev->gpiPattern[gpi] = previous;
+        return false;
+    }
+
+    _dev->gpiPattern[gpi] = patternIdx;
+    return _writeGpiControl(gpi, _dev->residentSeq[patternIdx], polarity, GPI_SINGLE_PATTERN);
+}
+
+bool da7280_getIrqSnapshot(irqSnapshot *snapshot)
+{
+    // IRQ_EVENT1, IRQ_EVENT_WARN_DIAG, IRQ_EVENT_SEQ_DIAG and IRQ_STATUS1
+    uint8_t regs[5] = { IRQ_EVENT1 };
+
+    memset(snapshot, 0, sizeof(*snapshot));
+    if (!_readConsReg(regs, sizeof(regs)))
+    {
+        return false;
+    }
+    snapshot->events   = regs[1];
+    snapshot->warnDiag = regs[2];
+    snapshot->seqDiag  = regs[3];
+    snapshot->status   = regs[4];
+
+    // The actuator fault details live far from the others, only fetch them when flagged
+    if (snapshot->events & E_ACTUATOR_FAULT)
+    {
+        uint8_t faultRegs[3] = { IRQ_EVENT_ACTUATOR_FAULT };
+        if (!_readConsReg(faultRegs, sizeof(faultRegs)))
+        {
+            return false;
+        }
+        snapshot->actuatorFault = faultRegs[1];
+        snapshot->status2       = faultRegs[2];
+    }
+    return true;
+}
+
+// Returns every pending event; more than one bit may be set.
+event_t da7280_getIrqEvent()
+{
+    return (event_t)_readRegister(IRQ_EVENT1);
+}
+
+// With several diagnostics pending the most significant one is returned.
+diag_status_t da7280_getEventDiag()
+{
+    return (diag_status_t)_highestBit(_readRegister(IRQ_EVENT_SEQ_DIAG) & 0xE0);
+}
+
+// With several status bits set the most significant one is returned.
+status_t da7280_getIrqStatus()
+{
+    return (status_t)_highestBit(_readRegister(IRQ_STATUS1));
+}
+
+bool da7280_setSeqControl(uint8_t repetitions, uint8_t sequenceID)
+{
+    if (sequenceID > 15 || repetitions > 15)
+        return false;
+
+    const regFieldValue updates[] = {
+        { PS_SEQ_ID, sequenceID },
+        { PS_SEQ_LOOP, repetitions }
+    };
+    return da7280_writeFields(updates, sizeof(updates) / sizeof(updates[0]));
+}
+
+// Brings up the selected instance
+static bool _beginDevice(void)
+{
+    uint8_t chipRev = _readRegister(CHIP_REV_REG);
+
+    if (chipRev != CHIP_REV)
+    {
+        return false;
+    }
+
+    _loadRegisterShadow();
+    _dev->maxAmplitude = 0;
+    _markWaveFormDirty(0, TOTAL_MEM_REGISTERS, true);
+    _clearResidents();
+    return true;
+}
+
+// wavememStepSource over pattern_map. ctx maps candidates to pattern
+// indices, NULL reads candidate as the index itself.
+static size_t _patternSteps(size_t candidate, wavememStep steps[], size_t maxSteps, void *ctx)
+{
+    const uint8_t *order = (const uint8_t *)ctx;
+    const PatternMapEntry *entry = &pattern_map[(order != NULL) ? order[candidate] : candidate];
+
+    if (entry->count > maxSteps)
+    {
+        return 0;
+    }
+    for (size_t i = 0; i < entry->count; i++)
+    {
+        // Same level da7280_setVibrate() would write for the step
+        steps[i].duration_ms = entry->steps[i].duration_ms;
+        steps[i].level       = entry->steps[i].force_pct;
+    }
+    return entry->count;
+}
+
+// The GPI mappings of patterns go with them, the registers are left as they are
+static void _clearResidents(void)
+{
+    memset(_dev->residentSeq, WAVEMEM_NOT_PACKED, sizeof(_dev->residentSeq));
+    memset(_dev->residentUse, 0, sizeof(_dev->residentUse));
+    memset(_dev->gpiPattern, PATTERN_MAP_SIZE, sizeof(_dev->gpiPattern));
+    _dev->pinnedPattern = PATTERN_MAP_SIZE;
+    _dev->useClock = 0;
+}
+
+static wavememFormat _currentFormat(void)
+{
+    bool accelerated = (_cachedRegister(TOP_CFG1) & REG_FIELD_MASK(ACCELERATION_EN)) != 0;
+    wavememFormat format = { _amplitudeLimit(), accelerated, _cachedRegister(MEM_CTL1) };
+    return format;
+}
+
+static bool _residentsStale(const wavememFormat *format)
+{
+    return format->fullScale != _dev->residentFormat.fullScale ||
+           format->accelerated != _dev->residentFormat.accelerated ||
+           format->baseAddr != _dev->residentFormat.baseAddr;
+}
+
+static bool _isGpiPattern(uint8_t patternIdx)
+{
+    for (uint8_t gpi = 0; gpi < DA7280_NUM_GPI; gpi++)
+    {
+        if (_dev->gpiPattern[gpi] == patternIdx)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// GPI_x_CTL is shadowed, an unchanged mapping is not written again
+static bool _writeGpiControl(uint8_t gpi, uint8_t sequenceID, uint8_t polarity, uint8_t mode)
+{
+    uint8_t value = (uint8_t)((sequenceID << GPI_SEQUENCE_ID(gpi).shift) & REG_FIELD_MASK(GPI_SEQUENCE_ID(gpi))) |
+                    (uint8_t)((mode << GPI_MODE(gpi).shift) & REG_FIELD_MASK(GPI_MODE(gpi))) |
+                    (uint8_t)((polarity << GPI_POLARITY(gpi).shift) & REG_FIELD_MASK(GPI_POLARITY(gpi)));
+
+    if (_cachedRegister(GPI_0_CTL + gpi) == value)
+    {
+        return true;
+    }
+    return _writeRegister(GPI_0_CTL + gpi, 0x00, value, 0);
+}
+
+// Points every GPI mapped to a pattern at its sequence after a repack. A
+// pattern that is no longer resident loses its mapping, and GPI_x_CTL its
+// sequence ID.
+static bool _followGpiPatterns(void)
+{
+    bool ok = true;
+    for (uint8_t gpi = 0; gpi < DA7280_NUM_GPI; gpi++)
+    {
+        uint8_t patternIdx = _dev->gpiPattern[gpi];
+        if (patternIdx < PATTERN_MAP_SIZE && _dev->residentSeq[patternIdx] == WAVEMEM_NOT_PACKED)
+        {
+            _dev->gpiPattern[gpi] = PATTERN_MAP_SIZE;
+            ok = _writeGpiControl(gpi, 0, GPI_RISING_EDGE, GPI_SINGLE_PATTERN) && ok;
+        }
+        else if (patternIdx < PATTERN_MAP_SIZE)
+        {
+            uint8_t ctl = _cachedRegister(GPI_0_CTL + gpi);
+            ok = _writeGpiControl(gpi, _dev->residentSeq[patternIdx],
+                                  (ctl & REG_FIELD_MASK(GPI_POLARITY(gpi))) >> GPI_POLARITY(gpi).shift,
+                                  GPI_SINGLE_PATTERN) && ok;
+        }
+    }
+    return ok;
+}
+
+// After a failed upload no sequence is known to be in the memory: every GPI
+// loses its mapping, sequence IDs from da7280_mapGpiSequence() included, and
+// GPI_x_CTL returns to its reset value.
+static bool _dropGpiMappings(void)
+{
+    bool ok = true;
+    for (uint8_t gpi = 0; gpi < DA7280_NUM_GPI; gpi++)
+    {
+        _dev->gpiPattern[gpi] = PATTERN_MAP_SIZE;
+        ok = _writeGpiControl(gpi, 0, GPI_RISING_EDGE, GPI_SINGLE_PATTERN) && ok;
+    }
+    return ok;
+}
+
+static void _resetStateMachine()
+{
+  _weight = 0;
+  _pattern_idx = 0xFF;
+  _parser_idx = 0;
+
+  for(uint8_t i = 0; i < ARR_MAX_LEN; i++)
+    {
+      _available_patterns[i] = 0xFF;
+    }
+}
+
+static void _onPlayTimer(sl_sleeptimer_timer_handle_t *handle, void *data)
+{
+  (void)handle;
+  (void)data;
+
+  // Interrupt context, the next step is written by da7280_performActivity()
+  _play_due = true;
+  app_proceed();
+}
+
+// Moves the deadline time_us on and arms the timer for it
+static void _armPlayTimer(uint32_t time_us)
+{
+  uint32_t freq = sl_sleeptimer_get_timer_frequency();
+  uint64_t now  = sl_sleeptimer_get_tick_count64();
+
+  _play_deadline_us += time_us;
+  // Rounded up, the timer must not fire before the deadline
+  uint64_t deadline = _play_start_tick + (_play_deadline_us * freq + 999999u) / 1000000u;
+
+  if (deadline <= now ||
+      sl_sleeptimer_start_timer(&_play_timer, (uint32_t)(deadline - now), _onPlayTimer, NULL, 0, 0) != SL_STATUS_OK)
+    {
+      // Already due, or no timer to wait with: carry on next pass
+      _play_due = true;
+      app_proceed();
+    }
+}
+
+// Time from the deadline of the boundary just handled to the end of its writes
+static void _recordLateness(void)
+{
+  uint64_t elapsed_us = ((sl_sleeptimer_get_tick_count64() - _play_start_tick) * 1000000u)
+                        / sl_sleeptimer_get_timer_frequency();
+  int64_t  late_us = (int64_t)(elapsed_us - _play_deadline_us);
+  uint32_t lateness_us = (late_us > 0) ? (uint32_t)late_us : 0;
+
+  if (_timing_stats.deadlines > 0)
+    {
+      _jitter_sum_us += (lateness_us > _last_lateness_us) ? lateness_us - _last_lateness_us
+                                                          : _last_lateness_us - lateness_us;
+    }
+  if (lateness_us > _timing_stats.maxLatenessUs)
+    {
+      _timing_stats.maxLatenessUs = lateness_us;
+    }
+  _lateness_sum_us += lateness_us;
+  _last_lateness_us = lateness_us;
+  _timing_stats.deadlines++;
+  _timing_stats.driftUs = (int32_t)late_us;
+}
+
+// Ends a session at once, a step or sequence in progress included
+static void _stopPlayback(void)
+{
+  bool running = false;
+
+  sl_sleeptimer_is_timer_running(&_play_timer, &running);
+  if (running)
+    {
+      sl_sleeptimer_stop_timer(&_play_timer);
+    }
+  if (_play_phase == PLAY_SEQUENCE)
+    {
+      da7280_setOperationMode(DRO_MODE);
+      da7280_setVibrate(0);
+    }
+  else if (_play_phase == PLAY_STEPS)
+    {
+      _writeLevel(0);
+    }
+  _leavePwm();
+  memset(&_play_ramp, 0, sizeof(_play_ramp));
+  _play_phase = PLAY_PASS;
+  _play_due = false;
+  _activity_time_ms = 0;
+  da7280_clearPlaylist();
+}
+
+// The first pass starts on the next turn of the super loop, the session is
+// timed from now
+static void _startSession(uint32_t activity_ms)
+{
+  _activity_time_ms = activity_ms;
+  _current_state = ACTIVE;
+  _play_phase = PLAY_PASS;
+  _play_level = 0;
+  _play_start_tick = sl_sleeptimer_get_tick_count64();
+  _play_deadline_us = 0;
+  memset(&_timing_stats, 0, sizeof(_timing_stats));
+  _lateness_sum_us = 0;
+  _jitter_sum_us = 0;
+  _last_lateness_us = 0;
+  _play_due = true;
+  app_proceed();
+}
+
+// Level of a pass written step by step, on the backend it plays with
+static void _writeLevel(uint8_t level)
+{
+  if (_play_pwm)
+    {
+      da7280_pwmSetLevel(level);
+    }
+  else
+    {
+      da7280_setVibrate(level);
+    }
+}
+
+// Back to DRO_MODE at level 0 after passes played in PWM_MODE
+static void _leavePwm(void)
+{
+  if (!_play_pwm)
+    {
+      return;
+    }
+  da7280_pwmSetLevel(0);
+  // TOP_CTL2 takes over in DRO_MODE, it may still hold a level from before
+  if (_cachedRegister(TOP_CTL2) != 0)
+    {
+      da7280_setVibrate(0);
+    }
+  da7280_setOperationMode(DRO_MODE);
+#if defined(SL_CATALOG_POWER_MANAGER_PRESENT)
+  sl_power_manager_remove_em_requirement(SL_POWER_MANAGER_EM1);
+#endif
+  _play_pwm = false;
+}
+
+static bool _isVolatileRegister(uint8_t reg)
+{
+    // Registers updated by the chip itself, these are never served from the shadow copy
+    switch (reg)
+    {
+    case IRQ_EVENT1:
+    case IRQ_EVENT_WARN_DIAG:
+    case IRQ_EVENT_SEQ_DIAG:
+    case IRQ_STATUS1:
+    case CALIB_IMP_H:
+    case CALIB_IMP_L:
+    case TOP_CTL1:          // SEQ_START self-clears, faults drop OPERATION_MODE
+    case ADC_DATA_H1:
+    case ADC_DATA_L1:
+    case LRA_AVR_H:
+    case LRA_AVR_L:
+    case FRQ_LRA_PER_ACT_H:
+    case FRQ_LRA_PER_ACT_L:
+    case FRQ_PHASE_H:
+    case FRQ_PHASE_L:
+    case IRQ_EVENT_ACTUATOR_FAULT:
+    case IRQ_STATUS2:
+        return true;
+    default:
+        return (reg >= SNP_MEM_X);
+    }
+}
+
+static void _loadRegisterShadow(void)
+{
+    static const uint8_t cachedRegs[] = {
+        IRQ_MASK1, CIF_I2C1, FRQ_LRA_PER_H, FRQ_LRA_PER_L,
+        ACTUATOR1, ACTUATOR2, ACTUATOR3, CALIB_V2I_H, CALIB_V2I_L,
+        TOP_CFG1, TOP_CFG2, TOP_CFG3, TOP_CFG4, TOP_INT_CFG1,
+        TOP_INT_CFG6_H, TOP_INT_CFG6_L, TOP_INT_CFG7_H, TOP_INT_CFG7_L, TOP_INT_CFG8,
+        TOP_CTL2, SEQ_CTL1, SWG_C1, SWG_C2, SWG_C3, SEQ_CTL2,
+        GPI_0_CTL, GPI_1_CTL, GPI_2_CTL, MEM_CTL1, MEM_CTL2,
+        POLARITY, FRQ_CTL, TRIM3, TRIM4, TRIM6, TOP_CFG5, IRQ_MASK2
+    };
+
+    uint8_t pairs[2 * sizeof(cachedRegs)];
+
+    memset(_dev->regShadowValid, 0, sizeof(_dev->regShadowValid));
+    for (size_t i = 0; i < sizeof(cachedRegs); i++)
+    {
+        pairs[2 * i] = cachedRegs[i];
+    }
+
+    // Registers left out of the shadow are read from the IC when needed
+    if (!_readNonConsReg(pairs, sizeof(pairs)))
+    {
+        return;
+    }
+
+    for (size_t i = 0; i < sizeof(cachedRegs); i++)
+    {
+        _dev->regShadow[cachedRegs[i]] = pairs[2 * i + 1];
+        _dev->regShadowValid[cachedRegs[i]] = true;
+    }
+}
+
+static uint8_t _amplitudeLimit(void)
+{
+    if (_dev->maxAmplitude == 0)
+    {
+        // ACCELERATION_EN limits TOP_CTL2 to 0x7F
+        _dev->maxAmplitude = ((_cachedRegister(TOP_CFG1) >> 2) & 0x01) ? 0x7F : 0xFF;
+    }
+    return _dev->maxAmplitude;
+}
+
+static uint8_t _highestBit(uint8_t bits)
+{
+    uint8_t bit = 0x80;
+
+    while (bit && !(bits & bit))
+    {
+        bit >>= 1;
+    }
+    return bit;
+}
+
+static void _waitUntilTick(uint64_t deadline)
+{
+    uint64_t now = sl_sleeptimer_get_tick_count64();
+
+    if (now < deadline)
+    {
+        sl_udelay_wait((unsigned)(((deadline - now) * 1000000u) / sl_sleeptimer_get_timer_frequency()));
+    }
+}
+
+static uint8_t _cachedRegister(uint8_t reg)
+{
+    if (_burst.open && reg >= _burst.firstReg && reg < _burst.firstReg + _burst.numRegs &&
+        (_burst.dirty & (1u << (reg - _burst.firstReg))))
+    {
+        return _burst.values[reg - _burst.firstReg];
+    }
+    if (!_isVolatileRegister(reg) && _dev->regShadowValid[reg])
+    {
+        return _dev->regShadow[reg];
+    }
+    return _readRegister(reg);
+}
+
+static void _beginBurst(uint8_t firstReg, uint8_t lastReg)
+{
+    _burst.open     = true;
+    _burst.firstReg = firstReg;
+    _burst.numRegs  = lastReg - firstReg + 1;
+    _burst.dirty    = 0;
+}
+
+static bool _commitBurst(void)
+{
+    bool ok = true;
+    uint8_t buf[1 + BURST_MAX_REGS];
+
+    _burst.open = false;
+
+    for (uint8_t i = 0; i < _burst.numRegs; )
+    {
+        if (!(_burst.dirty & (1u << i)))
+        {
+            i++;
+            continue;
+        }
+
+        // Gather the run of consecutive staged registers starting at i
+        size_t len = 0;
+        buf[len++] = _burst.firstReg + i;
+        while (i < _burst.numRegs && (_burst.dirty & (1u << i)))
+        {
+            buf[len++] = _burst.values[i];
+            i++;
+        }
+
+        if (len == 2)
+        {
+            ok = _writeRegister(buf[0], 0x00, buf[1], 0) && ok;
+        }
+        else
+        {
+            ok = _writeConsReg(buf, len) && ok;
+        }
+    }
+    _burst.dirty = 0;
+    return ok;
+}
+
+static bool _writeRegister(uint8_t reg, uint8_t mask, uint8_t bits, uint8_t startPos)
+{
+    uint8_t value = 0;
+
+    // A zero mask replaces the whole register, so there is nothing to read back
+    if (mask != 0x00)
+    {
+        value = _cachedRegister(reg) & mask;
+    }
+    value |= (bits << startPos);
+
+    if (_burst.open && reg >= _burst.firstReg && reg < _burst.firstReg + _burst.numRegs)
+    {
+        _burst.values[reg - _burst.firstReg] = value;
+        _burst.dirty |= (1u << (reg - _burst.firstReg));
+        return true;
+    }
+
+    uint8_t buf[2] = { reg, value };
 
     I2C_TransferSeq_TypeDef seq = {0};
-    seq.addr        = _address << 1;
+    seq.addr        = _dev->address << 1;
     seq.flags       = I2C_FLAG_WRITE;
     seq.buf[0].data = buf;
-    seq.buf[0].len  = BUF_LEN;
+    seq.buf[0].len  = sizeof(buf);
+
+    // Shadowed before the transfer, _onWriteDone() may run inside it
+    bool    shadowed  = !_isVolatileRegister(reg);
+    uint8_t oldValue  = _dev->regShadow[reg];
+    bool    oldValid  = _dev->regShadowValid[reg];
+    if (shadowed)
+    {
+        _dev->regShadow[reg] = value;
+        _dev->regShadowValid[reg] = true;
+    }
+
+    if (!_transferWrite(&seq))
+    {
+        if (shadowed)
+        {
+            _dev->regShadow[reg] = oldValue;
+            _dev->regShadowValid[reg] = oldValid;
+        }
+        return false;
+    }
+    return true;
+}
+
+// Values wider than the field are cut to its width instead of spilling into
+// the neighbouring bits.
+static bool _writeField(regField field, uint8_t value)
+{
+    uint8_t mask = REG_FIELD_MASK(field);
+
+    return _writeRegister(field.reg, (uint8_t)~mask, (uint8_t)(value << field.shift) & mask, 0);
+}
+
+static uint8_t _readRegister(uint8_t reg)
+{
+    uint8_t result = 0;
+
+    if (_readRegisterChecked(reg, &result)) {
+        return result;
+    }
+    return 0;
+}
+
+static bool _readRegisterChecked(uint8_t reg, uint8_t *result)
+{
+    uint8_t regs[2] = { reg, 0 };
+
+    if (!_readConsReg(regs, sizeof(regs)))
+    {
+        return false;
+    }
+    *result = regs[1];
+    return true;
+}
+
+// regs[0] is the first register, the values of it and the registers after it
+// are read into regs[1] onwards. len is the length of regs[].
+static bool _readConsReg(uint8_t regs[], size_t len)
+{
+    if (len < 2)
+    {
+        return true;
+    }
+
+    I2C_TransferSeq_TypeDef seq = {0};
+    seq.addr        = _dev->address << 1;
+    seq.flags       = I2C_FLAG_WRITE_READ;
+    seq.buf[0].data = &regs[0];
+    seq.buf[0].len  = 1;
+    seq.buf[1].data = &regs[1];
+    seq.buf[1].len  = len - 1;
+
+    return _transfer(&seq);
+}
+
+// regs[] holds register/value pairs with the registers in ascending order,
+// the values are filled in. Registers at most READ_GAP_MAX apart are read as
+// one block: a skipped register costs one byte on the bus, a new read three.
+static bool _readNonConsReg(uint8_t regs[], size_t len)
+{
+    uint8_t block[1 + READ_MAX_LEN];
+    size_t i = 0;
+
+    while (i + 1 < len)
+    {
+        uint8_t firstReg = regs[i];
+        size_t end = i + 2;
+
+        while (end + 1 < len && regs[end] > regs[end - 2] &&
+               regs[end] - regs[end - 2] <= READ_GAP_MAX + 1 && regs[end] - firstReg < READ_MAX_LEN)
+        {
+            end += 2;
+        }
+
+        block[0] = firstReg;
+        if (!_readConsReg(block, 2 + regs[end - 2] - firstReg))
+        {
+            return false;
+        }
+
+        for (; i < end; i += 2)
+        {
+            regs[i + 1] = block[1 + regs[i] - firstReg];
+        }
+    }
+    return true;
+}
+
+// Points the mux at the channel of the selected instance, or at all of
+// _muxGroup while a group starts. Written only when that changes.
+static bool _selectMuxChannels(void)
+{
+    if (_dev->muxChannel == DA7280_NO_MUX_CHANNEL)
+    {
+        return true;
+    }
+
+    uint8_t channels = (_muxGroup != 0) ? _muxGroup : (uint8_t)(1u << _dev->muxChannel);
+    if (channels == _muxChannels)
+    {
+        return true;
+    }
+
+    I2C_TransferSeq_TypeDef seq = {0};
+    seq.addr        = _muxAddress << 1;
+    seq.flags       = I2C_FLAG_WRITE;
+    seq.buf[0].data = &channels;
+    seq.buf[0].len  = 1;
 
-    _writeRegister(CIF_I2C1, 0x7F, 0, 7);
-    bool ok = (I2CSPM_Transfer(_i2cPort, &seq) == i2cTransferDone);
-    _writeRegister(CIF_I2C1, 0x7F, 1, 7);
+    bool ok = _asyncEnabled ? (da7280_asyncTransfer(&seq) == i2cTransferDone)
+                            : (I2CSPM_Transfer(_dev->port, &seq) == i2cTransferDone);
+    // Unknown after a failure, written again next time
+    _muxChannels = ok ? channels : 0;
     return ok;
 }
+
+static bool _transfer(I2C_TransferSeq_TypeDef *seq)
+{
+    if (!_selectMuxChannels())
+    {
+        return false;
+    }
+    if (_asyncEnabled)
+    {
+        return (da7280_asyncTransfer(seq) == i2cTransferDone);
+    }
+    return (I2CSPM_Transfer(_dev->port, seq) == i2cTransferDone);
+}
+
+// With async transfers enabled a write returns as soon as it is queued. The
+// callers update the shadow before the call and _onWriteDone() drops it again
+// if the write fails, which may happen before the call returns.
+static bool _transferWrite(I2C_TransferSeq_TypeDef *seq)
+{
+    if (_asyncEnabled)
+    {
+        // The instance goes along, another may be selected by the time it completes
+        uintptr_t ctx = seq->buf[0].data[0] | ((uintptr_t)(seq->buf[0].len - 1) << 8) |
+                        ((uintptr_t)(_dev - _devices) << 16);
+        return _selectMuxChannels() && da7280_asyncSubmit(seq, _onWriteDone, (void *)ctx);
+    }
+    return _transfer(seq);
+}
+
+static void _onWriteDone(I2C_TransferReturn_TypeDef status, void *ctx)
+{
+    if (status == i2cTransferDone)
+    {
+        return;
+    }
+
+    uint8_t       reg = (uintptr_t)ctx & 0xFF;
+    size_t        len = ((uintptr_t)ctx >> 8) & 0xFF;
+    da7280Device *dev = &_devices[(uintptr_t)ctx >> 16];
+    for (size_t i = 0; i < len && reg + i < SNP_MEM_X; i++)
+    {
+        dev->regShadowValid[reg + i] = false;
+    }
+}
+
+// Consecutive write mode: regs[0] is the first register, followed by the
+// values for it and the registers after it. len is the length of regs[].
+static bool _writeConsReg(uint8_t regs[], size_t len)
+{
+    if (!_setWriteMode(0))
+    {
+        return false;
+    }
+
+    I2C_TransferSeq_TypeDef seq = {0};
+    seq.addr        = _dev->address << 1;
+    seq.flags       = I2C_FLAG_WRITE;
+    seq.buf[0].data = regs;
+    seq.buf[0].len  = len;
+
+    // Shadowed before the transfer, _onWriteDone() may run inside it
+    uint8_t oldValues[BURST_MAX_REGS];
+    bool    oldValid[BURST_MAX_REGS];
+    size_t  numShadowed = (len - 1 < BURST_MAX_REGS) ? len - 1 : BURST_MAX_REGS;
+    for (size_t i = 0; i < numShadowed; i++)
+    {
+        uint8_t reg = regs[0] + i;
+        oldValues[i] = _dev->regShadow[reg];
+        oldValid[i]  = _dev->regShadowValid[reg];
+        if (!_isVolatileRegister(reg))
+        {
+            _dev->regShadow[reg] = regs[1 + i];
+            _dev->regShadowValid[reg] = true;
+        }
+    }
+
+    if (!_transferWrite(&seq))
+    {
+        for (size_t i = 0; i < numShadowed; i++)
+        {
+            _dev->regShadow[regs[0] + i] = oldValues[i];
+            _dev->regShadowValid[regs[0] + i] = oldValid[i];
+        }
+        return false;
+    }
+    return true;
+}
+
+// CIF_I2C1 bit 7 (I2C_WR_MODE): 0 = consecutive, 1 = non-consecutive.
+// Only touches the bus when the shadowed mode differs.
+static bool _setWriteMode(uint8_t mode)
+{
+    if (_dev->regShadowValid[CIF_I2C1] && ((_dev->regShadow[CIF_I2C1] >> 7) & 0x01) == mode)
+    {
+        return true;
+    }
+    return _writeField(I2C_WR_MODE, mode);
+}
+
+// Writes len bytes of the image from its byte first on, at WAV_MEM_BASE_ADDR
+// + first; the rest of the memory is not referenced by its end pointers.
+// Blocking even with async transfers enabled, the dirty bits and residents
+// only follow a write that reached the memory.
+static bool _writeWaveFormMemory(const uint8_t waveFormArray[], size_t first, size_t len)
+{
+    uint8_t buf[1 + TOTAL_MEM_REGISTERS];
+    if (first + len > TOTAL_MEM_REGISTERS || !_setWriteMode(0))
+    {
+        return false;
+    }
+    buf[0] = _cachedRegister(MEM_CTL1) + first;
+    memcpy(&buf[1], &waveFormArray[first], len);
+
+    I2C_TransferSeq_TypeDef seq = {0};
+    seq.addr        = _dev->address << 1;
+    seq.flags       = I2C_FLAG_WRITE;
+    seq.buf[0].data = buf;
+    seq.buf[0].len  = 1 + len;
+    return _transfer(&seq);
+}
+
+// The memory only takes writes while inactive and unlocked (datasheet 5.6.4).
+// ctl1 receives TOP_CTL1 as it was, without SEQ_START, or 0 if it could not
+// be read; _restoreOperationMode() takes it whether the unlock succeeded or not.
+static bool _unlockWaveFormMemory(uint8_t *ctl1)
+{
+    *ctl1 = 0;
+    if (!_readRegisterChecked(TOP_CTL1, ctl1))
+    {
+        return false;
+    }
+    *ctl1 &= (uint8_t)~REG_FIELD_MASK(SEQ_START);
+
+    uint8_t inactive = *ctl1 & (uint8_t)~REG_FIELD_MASK(OPERATION_MODE);
+    if (!_writeRegister(TOP_CTL1, 0x00, inactive, 0))
+    {
+        return false;
+    }
+    return (_cachedRegister(MEM_CTL2) & REG_FIELD_MASK(WAV_MEM_LOCK)) || _writeField(WAV_MEM_LOCK, UNLOCKED);
+}
+
+// Writes back the TOP_CTL1 saved by _unlockWaveFormMemory() once the memory
+// was written, so GPI edges, TOP_CTL2 levels and the PWM duty cycle take
+// effect as before. One write, the register is not read again.
+static bool _restoreOperationMode(uint8_t ctl1)
+{
+    return !(ctl1 & REG_FIELD_MASK(OPERATION_MODE)) || _writeRegister(TOP_CTL1, 0x00, ctl1, 0);
+}
+
+// Copies image[] into _dev->snpMemCopy, marking the bytes that change.
+static void _stageWaveFormMemory(const uint8_t image[], size_t len)
+{
+    for (size_t i = 0; i < len && i < TOTAL_MEM_REGISTERS; i++)
+    {
+        if (image[i] != _dev->snpMemCopy[i])
+        {
+            _dev->snpMemCopy[i] = image[i];
+            _markWaveFormDirty(i, 1, true);
+        }
+    }
+}
+
+// Writes the dirty bytes among the first used of _dev->snpMemCopy. Data runs go
+// first, one write each, runs at most MEM_WRITE_GAP_MAX apart merged. The
+// counts and end pointers follow in a single write, together with the data
+// right behind them, so the header never describes a layout whose data is
+// only partly there. Dirty bytes past used are not referenced and stay dirty.
+static bool _commitWaveFormMemory(size_t used)
+{
+    size_t headerLen = 2u + _dev->snpMemCopy[0] + _dev->snpMemCopy[1];
+    if (used > TOTAL_MEM_REGISTERS || headerLen > used)
+    {
+        return false;
+    }
+
+    size_t headerFirst = 0;
+    size_t headerLast  = headerLen;
+    while (headerFirst < headerLast && !_isWaveFormDirty(headerFirst))
+    {
+        headerFirst++;
+    }
+    while (headerLast > headerFirst && !_isWaveFormDirty(headerLast - 1))
+    {
+        headerLast--;
+    }
+
+    size_t pos = headerLen;
+    while (pos < used)
+    {
+        if (!_isWaveFormDirty(pos))
+        {
+            pos++;
+            continue;
+        }
+
+        size_t first = pos;
+        size_t last  = pos + 1;
+        for (pos = last; pos < used && pos - last <= MEM_WRITE_GAP_MAX; pos++)
+        {
+            if (_isWaveFormDirty(pos))
+            {
+                last = pos + 1;
+            }
+        }
+        pos = last;
+
+        if (headerFirst < headerLast && first - headerLast <= MEM_WRITE_GAP_MAX)
+        {
+            // Goes out with the header
+            headerLast = last;
+            continue;
+        }
+        if (!_writeWaveFormMemory(_dev->snpMemCopy, first, last - first))
+        {
+            return false;
+        }
+        _markWaveFormDirty(first, last - first, false);
+    }
+
+    if (headerFirst < headerLast)
+    {
+        if (!_writeWaveFormMemory(_dev->snpMemCopy, headerFirst, headerLast - headerFirst))
+        {
+            return false;
+        }
+        _markWaveFormDirty(headerFirst, headerLast - headerFirst, false);
+    }
+    return true;
+}
+
+static bool _isWaveFormDirty(size_t pos)
+{
+    return (_dev->snpMemDirty[pos / 8] >> (pos % 8)) & 0x01;
+}
+
+static void _markWaveFormDirty(size_t first, size_t len, bool dirty)
+{
+    for (size_t i = first; i < first + len; i++)
+    {
+        if (dirty)
+        {
+            _dev->snpMemDirty[i / 8] |= (uint8_t)(1u << (i % 8));
+        }
+        else
+        {
+            _dev->snpMemDirty[i / 8] &= (uint8_t)~(1u << (i % 8));
+        }
+    }
+}
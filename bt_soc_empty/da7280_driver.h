@@ -2,6 +2,8 @@
 #define DRIVER_DA7280_H
 
 #include "sl_i2cspm.h"
+#include "da7280_wavemem.h"
+#include "da7280_ramp.h"
 
 #include <stdint.h>   // for uint8_t, uint32_t
 #include <stddef.h>   // for size_t
@@ -94,6 +96,22 @@ typedef enum
     ETWM_MODE
 } OPERATION_MODES;
 
+// GPI_0_CTL..GPI_2_CTL, edge that starts the mapped sequence in ETWM mode
+typedef enum
+{
+    GPI_RISING_EDGE           = 0x00,
+    GPI_FALLING_EDGE          = 0x01,
+    GPI_BOTH_EDGES            = 0x02
+} GPI_POLARITIES;
+
+typedef enum
+{
+    GPI_SINGLE_PATTERN        = 0x00,
+    GPI_MULTI_PATTERN         = 0x01
+} GPI_MODES;
+
+#define DA7280_NUM_GPI        3
+
 typedef enum
 {
     BEGIN_SNP_MEM             = 0x00,
@@ -172,15 +190,171 @@ typedef enum
     SNP_MEM_X
 } REGISTERS;
 
+// Interrupt registers as read by da7280_getIrqSnapshot(). The fields hold
+// every pending bit, so several events can be handled from one read.
+typedef struct
+{
+    uint8_t events;             // IRQ_EVENT1, event_t bits
+    uint8_t warnDiag;           // IRQ_EVENT_WARN_DIAG
+    uint8_t seqDiag;            // IRQ_EVENT_SEQ_DIAG, diag_status_t bits
+    uint8_t status;             // IRQ_STATUS1, status_t bits
+    uint8_t actuatorFault;      // IRQ_EVENT_ACTUATOR_FAULT, only read with E_ACTUATOR_FAULT
+    uint8_t status2;            // IRQ_STATUS2, only read with E_ACTUATOR_FAULT
+} irqSnapshot;
+
+// Waveform memory as a cache of patterns, counted by da7280_loadPattern()
+typedef struct
+{
+    uint32_t hits;              // pattern was resident
+    uint32_t misses;            // memory was rewritten to make it resident
+    uint32_t evictions;         // resident patterns dropped to make room
+} patternCacheStats;
+
+// Timing of the current or last session against its deadlines, the start,
+// every step and the end of every pass and pause, kept by
+// da7280_performActivity(). Lateness runs from a deadline to the end of the
+// writes it triggers.
+typedef struct
+{
+    uint32_t deadlines;         // deadlines handled
+    uint32_t maxLatenessUs;
+    uint32_t meanLatenessUs;
+    uint32_t meanJitterUs;      // mean change of the lateness from one deadline to the next
+    int32_t  driftUs;           // lateness of the last deadline, the end once the session is over
+} playbackTimingStats;
+
+// How da7280_performActivity() drives passes it writes step by step
+typedef enum
+{
+    PLAYBACK_DRO,               // levels written to TOP_CTL2 over I2C
+    PLAYBACK_PWM                // duty cycle of GPI0/PWM from a timer, see da7280_pwm.h
+} playbackBackend;
+
+#define PLAYLIST_MAX_ENTRIES    8
+#define DA7280_MAX_DEVICES      8
+#define DA7280_NO_MUX_CHANNEL   0xFF
+
+// One DA7280 of those the driver drives, see da7280_addDevice()
+typedef struct da7280Device da7280Device;
+
+// repetitions passes of pattern_map[patternIdx], each followed by gapMs of
+// silence unless it is the last of the playlist
+typedef struct
+{
+    uint8_t  patternIdx;
+    uint8_t  repetitions;
+    uint16_t gapMs;
+} playlistEntry;
+
+// Bit field of a register: address, position of the lowest bit and width.
+// Masks are derived from shift and width by REG_FIELD_MASK() instead of
+// being written out by hand, and fold to constants for the descriptors below.
+typedef struct
+{
+    uint8_t reg;
+    uint8_t shift;
+    uint8_t width;
+} regField;
+
+typedef struct
+{
+    regField field;
+    uint8_t  value;
+} regFieldValue;
+
+#define REG_FIELD(reg, shift, width)    ((regField){ (reg), (shift), (width) })
+#define REG_FIELD_MASK(f)               ((uint8_t)(((1u << (f).width) - 1u) << (f).shift))
+
+#define I2C_WR_MODE                 REG_FIELD(CIF_I2C1, 7, 1)
+#define LRA_PER_L                   REG_FIELD(FRQ_LRA_PER_L, 0, 7)
+#define IMAX                        REG_FIELD(ACTUATOR3, 0, 5)
+#define AMP_PID_EN                  REG_FIELD(TOP_CFG1, 0, 1)
+#define RAPID_STOP_EN               REG_FIELD(TOP_CFG1, 1, 1)
+#define ACCELERATION_EN             REG_FIELD(TOP_CFG1, 2, 1)
+#define FREQ_TRACK_EN               REG_FIELD(TOP_CFG1, 3, 1)
+#define BEMF_SENSE_EN               REG_FIELD(TOP_CFG1, 4, 1)
+#define ACTUATOR_TYPE               REG_FIELD(TOP_CFG1, 5, 1)
+#define FULL_BRAKE_THR              REG_FIELD(TOP_CFG2, 0, 4)
+#define TST_CALIB_IMPEDANCE_DIS     REG_FIELD(TOP_CFG4, 6, 1)
+#define V2I_FACTOR_FREEZE           REG_FIELD(TOP_CFG4, 7, 1)
+#define BEMF_FAULT_LIM              REG_FIELD(TOP_INT_CFG1, 0, 2)
+#define OPERATION_MODE              REG_FIELD(TOP_CTL1, 0, 3)
+#define SEQ_START                   REG_FIELD(TOP_CTL1, 4, 1)
+#define PS_SEQ_ID                   REG_FIELD(SEQ_CTL2, 0, 4)
+#define PS_SEQ_LOOP                 REG_FIELD(SEQ_CTL2, 4, 4)
+#define WAV_MEM_LOCK                REG_FIELD(MEM_CTL2, 7, 1)
+#define GPI_POLARITY(gpi)           REG_FIELD(GPI_0_CTL + (gpi), 0, 2)
+#define GPI_MODE(gpi)               REG_FIELD(GPI_0_CTL + (gpi), 2, 1)
+#define GPI_SEQUENCE_ID(gpi)        REG_FIELD(GPI_0_CTL + (gpi), 3, 4)
+
 void da7280_setActivityDone(bool status);
 bool da7280_getActivityDone();
 bool da7280_isActivityTimeSet();
 void da7280_performActivity();
+// Opens every step of da7280_performActivity() with a ramp of rampMs from
+// the level before it, written to TOP_CTL2 at rateHz and cut short by the
+// length of the step. RAMP_STEP, the default, keeps the hard steps and
+// plays passes from waveform memory; other shapes write every pass sample
+// by sample. Takes effect with the next pass. False for a rate of 0 or
+// above RAMP_MAX_RATE_HZ.
+bool da7280_setStepRamp(rampShape shape, uint16_t rampMs, uint16_t rateHz);
+void da7280_getPlaybackTimingStats(playbackTimingStats *stats);
+// PLAYBACK_PWM plays the passes that are written step by step in PWM_MODE,
+// every level a duty cycle on GPI0/PWM and no bus access; a ramp that fits
+// DA7280_PWM_TABLE_LEN samples is streamed by the timer interrupt in one go.
+// Passes from waveform memory are unchanged. The PWM output drives the
+// selected device. While in PWM_MODE the driver holds an EM1 requirement,
+// the TIMER stops in EM2. Takes effect with the next pass. False for PLAYBACK_PWM
+// before da7280_pwmInit().
+bool da7280_setPlaybackBackend(playbackBackend backend);
+playbackBackend da7280_getPlaybackBackend(void);
+// Appends an entry to the playlist. False if PLAYLIST_MAX_ENTRIES are
+// queued, for an unknown pattern or one without steps and for 0 repetitions.
+bool da7280_queuePattern(uint8_t patternIdx, uint8_t repetitions, uint16_t gapMs);
+// Plays the playlist as one session, without the weight, pattern and
+// activity time inputs; passes are consumed as they end. The patterns are
+// loaded into waveform memory before the session starts, as many as fit.
+// One that is evicted again is reloaded during the gap ahead of it, or
+// without a gap before the last pass of the entry ahead of it, so entries
+// start on the deadline of the gap. False if the playlist is empty, the
+// controller is not booted or a session is active.
+bool da7280_startPlaylist(void);
+// Empties the playlist, a running playlist session ends after its pass.
+void da7280_clearPlaylist(void);
+uint8_t da7280_getPlaylistLength(void);
 void da7280_resetStateMachine();
 void da7280_setBootStatus(BOOT_STATUS status);
 uint8_t da7280_processUserInput(uint32_t event_value, uint16_t characteristic, char *out_buf, size_t out_buf_len);
+// Brings up the DA7280 at DEF_ADDR on i2c_port as the first instance and
+// selects it.
 bool da7280_begin(sl_i2cspm_t *i2c_port);
+// Brings up one more DA7280 at address, behind channel muxChannel of the
+// mux of da7280_setMux() or on the bus directly with DA7280_NO_MUX_CHANNEL,
+// and selects it. Every DA7280 answers at DEF_ADDR, so several on one bus
+// need a mux. NULL once DA7280_MAX_DEVICES are in use, for a channel above
+// 7 or without a mux, or if the chip does not answer.
+da7280Device *da7280_addDevice(sl_i2cspm_t *i2c_port, uint8_t address, uint8_t muxChannel);
+// All other calls, the pattern player included, act on the selected
+// instance. Each instance keeps its own register shadow, waveform memory
+// image and pattern cache.
+void da7280_select(da7280Device *dev);
+da7280Device *da7280_getSelected(void);
+// TCA9548A style mux at address: the byte written to it enables one
+// channel per bit. The channel is switched only when the selected instance
+// is behind another one.
+void da7280_setMux(uint8_t address);
+// Starts pattern_map[patterns[i]] from waveform memory on devs[i] with
+// bounded skew. Patterns are loaded and sequences chosen first, then the
+// starts go out as one TOP_CTL1 write per instance, back to back. Instances
+// behind the mux at the same address get a single write with all their
+// channels enabled and start on the same STOP condition. The selection is
+// left as it was. False if a pattern does not fit or a transfer fails.
+bool da7280_startGroup(da7280Device *const devs[], const uint8_t patterns[], size_t n);
+void da7280_enableAsyncTransfers(bool enable);
 bool da7280_setActuatorType(uint8_t type);
+// Fields of the same register are merged into one write, fields of nearby
+// registers into one burst.
+bool da7280_writeFields(const regFieldValue updates[], size_t n);
 bool da7280_setMotorSettings(hapticSettings settings);
 hapticSettings da7280_getMotorSettings(void);
 bool da7280_setOperationMode(OPERATION_MODES opMode);
@@ -204,6 +378,9 @@ bool da7280_setBemfFaultLimit(bool);
 bool da7280_enableV2iFactorFreeze(bool);
 bool da7280_calibrateImpedanceDistance(bool);
 bool da7280_setVibrate(uint8_t);
+// Writes levels[] to TOP_CTL2 one after the other, each held for period_us.
+// The acceleration clamp is resolved once for the whole stream.
+bool da7280_streamAmplitudes(const uint8_t *levels, size_t n, uint16_t period_us);
 uint8_t da7280_getVibrate();
 bool da7280_setFullBrake(uint8_t);
 float da7280_getFullBrake();
@@ -213,6 +390,48 @@ bool da7280_setBemf(uint8_t val);
 float da7280_getBemf();
 void da7280_clearIrq(uint8_t);
 void da7280_eraseWaveformMemory(void);
+// Reads the part of the waveform memory its end pointers reference back in
+// one burst and compares its CRC with the image the driver wrote. On a
+// mismatch only the runs of bytes that differ are written again. mismatched
+// receives their number, may be NULL. Cheaper than a full upload after a
+// brown-out.
+bool da7280_verifyWaveformMemory(uint8_t *mismatched);
+// Append step snippets to the waveform memory, each with a sequence that
+// plays it once; IDs already in use are kept. da7280_addSnippets() takes
+// PWL bytes and writes the whole set at once. Loading a pattern that is
+// not resident rebuilds the memory without them.
+bool da7280_addSnippet(uint8_t ramp, uint8_t timeBase, uint8_t amplitude);
+bool da7280_addSnippets(const uint8_t snippets[], uint8_t numSnippets);
+// Makes pattern_map[patternIdx] resident in waveform memory. If it is not,
+// the memory is repacked with the resident patterns, the least recently
+// loaded dropped until it fits, and free space filled with the other
+// patterns of its mass and then any others, snippets shared between them.
+// Only the bytes that change are written. Once ACCELERATION_EN, the
+// amplitude limit or WAV_MEM_BASE_ADDR change, no pattern is resident
+// until the next load re-encodes them all. timing reports the compiled
+// length against the step durations. False if the pattern does not fit on
+// its own.
+bool da7280_loadPattern(uint8_t patternIdx, wavememTiming *timing);
+bool da7280_isPatternResident(uint8_t patternIdx);
+void da7280_getPatternCacheStats(patternCacheStats *stats);
+void da7280_resetPatternCacheStats(void);
+// Plays a resident pattern in RTWM mode, no further bus traffic until it ends.
+bool da7280_playPattern(uint8_t patternIdx);
+// Edge-triggered waveform memory mode: with OPERATION_MODE set to ETWM_MODE
+// an edge on GPI0..GPI2 starts the sequence mapped to that input without
+// any bus traffic. GPI0 is also the PWM input. Rewriting the waveform memory
+// drops to INACTIVE; every call that does, da7280_loadPattern() on a miss,
+// da7280_addSnippets(), da7280_verifyWaveformMemory() and the playlist
+// preloads included, sets the mode it found again afterwards, also when
+// the write fails.
+// da7280_mapGpiSequence() maps a sequence ID as it is, e.g. one added by
+// da7280_addSnippets(). da7280_mapGpiPattern() loads the pattern and keeps
+// it resident while mapped; the input follows it if loading other patterns
+// renumbers the sequences. A load whose upload fails drops every mapping and
+// returns GPI_x_CTL to its reset value; map the inputs again after it.
+bool da7280_mapGpiSequence(uint8_t gpi, uint8_t sequenceID, GPI_POLARITIES polarity, GPI_MODES mode);
+bool da7280_mapGpiPattern(uint8_t gpi, uint8_t patternIdx, GPI_POLARITIES polarity);
+bool da7280_getIrqSnapshot(irqSnapshot *snapshot);
 event_t da7280_getIrqEvent();
 diag_status_t da7280_getEventDiag();
 status_t da7280_getIrqStatus();
@@ -0,0 +1,176 @@
+#include "da7280_i2c_async.h"
+#include "sl_component_catalog.h"
+#include "sl_core.h"
+#if defined(SL_CATALOG_POWER_MANAGER_PRESENT)
+#include "sl_power_manager.h"
+#endif
+
+#include <string.h>
+
+typedef struct
+{
+    I2C_TransferSeq_TypeDef seq;
+    uint8_t                 data[DA7280_ASYNC_MAX_WRITE];
+    da7280_asyncCallback    cb;
+    void                   *ctx;
+} asyncEntry;
+
+static sl_i2cspm_t *_i2cPort;
+static asyncEntry   _queue[DA7280_ASYNC_QUEUE_LEN];
+static volatile uint8_t _head = 0;      // entry being transferred
+static volatile uint8_t _count = 0;
+static volatile bool    _active = false;
+static volatile uint32_t _errors = 0;
+
+static void _startNext(void);
+
+void da7280_asyncInit(sl_i2cspm_t *i2cPort)
+{
+    _i2cPort = i2cPort;
+    _head = 0;
+    _count = 0;
+    _active = false;
+    _errors = 0;
+}
+
+// Called with interrupts disabled
+static void _startNext(void)
+{
+    while (_count > 0)
+    {
+        asyncEntry *entry = &_queue[_head];
+        I2C_TransferReturn_TypeDef ret = I2C_TransferInit(_i2cPort, &entry->seq);
+
+        if (ret == i2cTransferInProgress)
+        {
+            _active = true;
+            return;
+        }
+
+        // Failed (or finished) straight away
+        if (ret != i2cTransferDone)
+        {
+            _errors++;
+        }
+        _head = (_head + 1) % DA7280_ASYNC_QUEUE_LEN;
+        _count--;
+        if (entry->cb != NULL)
+        {
+            entry->cb(ret, entry->ctx);
+        }
+    }
+
+    _active = false;
+#if defined(SL_CATALOG_POWER_MANAGER_PRESENT)
+    // The I2C peripheral needs the HF clock until the queue is drained
+    sl_power_manager_remove_em_requirement(SL_POWER_MANAGER_EM1);
+#endif
+}
+
+void da7280_asyncIrqHandler(void)
+{
+    CORE_DECLARE_IRQ_STATE;
+    CORE_ENTER_CRITICAL();
+
+    if (_active)
+    {
+        I2C_TransferReturn_TypeDef ret = I2C_Transfer(_i2cPort);
+
+        if (ret != i2cTransferInProgress)
+        {
+            asyncEntry *entry = &_queue[_head];
+
+            if (ret != i2cTransferDone)
+            {
+                _errors++;
+            }
+            _head = (_head + 1) % DA7280_ASYNC_QUEUE_LEN;
+            _count--;
+            _active = false;
+            if (entry->cb != NULL)
+            {
+                entry->cb(ret, entry->ctx);
+            }
+            _startNext();
+        }
+    }
+
+    CORE_EXIT_CRITICAL();
+}
+
+bool da7280_asyncSubmit(const I2C_TransferSeq_TypeDef *seq, da7280_asyncCallback cb, void *ctx)
+{
+    if (seq->buf[0].len > DA7280_ASYNC_MAX_WRITE)
+    {
+        return false;
+    }
+
+    // Full, make room by driving the transfer in progress
+    while (_count >= DA7280_ASYNC_QUEUE_LEN)
+    {
+        da7280_asyncIrqHandler();
+    }
+
+    CORE_DECLARE_IRQ_STATE;
+    CORE_ENTER_CRITICAL();
+
+    asyncEntry *entry = &_queue[(_head + _count) % DA7280_ASYNC_QUEUE_LEN];
+    entry->seq = *seq;
+    memcpy(entry->data, seq->buf[0].data, seq->buf[0].len);
+    entry->seq.buf[0].data = entry->data;
+    entry->cb  = cb;
+    entry->ctx = ctx;
+    _count++;
+
+    if (!_active)
+    {
+#if defined(SL_CATALOG_POWER_MANAGER_PRESENT)
+        sl_power_manager_add_em_requirement(SL_POWER_MANAGER_EM1);
+#endif
+        _startNext();
+    }
+
+    CORE_EXIT_CRITICAL();
+    return true;
+}
+
+static void _onBlockingDone(I2C_TransferReturn_TypeDef status, void *ctx)
+{
+    *(volatile I2C_TransferReturn_TypeDef *)ctx = status;
+}
+
+I2C_TransferReturn_TypeDef da7280_asyncTransfer(I2C_TransferSeq_TypeDef *seq)
+{
+    volatile I2C_TransferReturn_TypeDef status = i2cTransferInProgress;
+
+    if (!da7280_asyncSubmit(seq, _onBlockingDone, (void *)&status))
+    {
+        return i2cTransferUsageFault;
+    }
+
+    // The caller needs the result anyway, so rather than sleep until the IRQ
+    // fires, drive the queue from here. I2C_Transfer() is safe to poll.
+    while (status == i2cTransferInProgress)
+    {
+        da7280_asyncIrqHandler();
+    }
+    return status;
+}
+
+bool da7280_asyncIsIdle(void)
+{
+    return (_count == 0);
+}
+
+void da7280_asyncFlush(void)
+{
+    while (_count > 0)
+    {
+        da7280_asyncIrqHandler();
+    }
+}
+
+uint32_t da7280_asyncErrorCount(void)
+{
+    return _errors;
+}
@@ -0,0 +1,34 @@
+#ifndef DA7280_I2C_ASYNC_H
+#define DA7280_I2C_ASYNC_H
+
+#include "sl_i2cspm.h"
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Queued, interrupt driven I2C transfers for the DA7280. Transfers are started
+// with I2C_TransferInit() and advanced by da7280_asyncIrqHandler(), which must
+// be called from the I2C peripheral's IRQ handler. Blocking transfers drive
+// the same state machine from the caller while they wait.
+
+#define DA7280_ASYNC_QUEUE_LEN    8
+#define DA7280_ASYNC_MAX_WRITE    101   // register + the whole waveform memory
+
+typedef void (*da7280_asyncCallback)(I2C_TransferReturn_TypeDef status, void *ctx);
+
+void da7280_asyncInit(sl_i2cspm_t *i2c_port);
+
+// Queues a transfer. Write data is copied, read buffers must stay valid until
+// the callback runs. Waits for a free slot if the queue is full.
+bool da7280_asyncSubmit(const I2C_TransferSeq_TypeDef *seq, da7280_asyncCallback cb, void *ctx);
+
+// Queues a transfer behind the pending ones and waits for it to finish.
+I2C_TransferReturn_TypeDef da7280_asyncTransfer(I2C_TransferSeq_TypeDef *seq);
+
+bool da7280_asyncIsIdle(void);
+void da7280_asyncFlush(void);
+uint32_t da7280_asyncErrorCount(void);
+void da7280_asyncIrqHandler(void);
+
+#endif // DA7280_I2C_ASYNC_H
@@ -0,0 +1,87 @@
+#include "da7280_nirq.h"
+#include "da7280_nirq_config.h"
+#include "da7280_driver.h"
+#include "em_gpio.h"
+#include "gpiointerrupt.h"
+#include "app.h"
+
+// Events that stop playback; E_SEQ_DONE after every RTWM/ETWM sequence and
+// the warnings are only cleared, so edge-triggered mode stays armed
+#define FAULT_EVENTS    (E_UVLO | E_OVERTEMP_CRIT | E_SEQ_FAULT | E_ACTUATOR_FAULT | E_OC_FAULT)
+
+static volatile bool _pending = false;
+
+static bool _lineAsserted(void)
+{
+    return GPIO_PinInGet(DA7280_NIRQ_PORT, DA7280_NIRQ_PIN) == 0;
+}
+
+static void _onNIrq(uint8_t intNo)
+{
+    (void)intNo;
+    _pending = true;
+    app_proceed();
+}
+
+void da7280_nirqInit(void)
+{
+    GPIO_PinModeSet(DA7280_NIRQ_PORT, DA7280_NIRQ_PIN, gpioModeInputPull, 1);
+
+    GPIOINT_Init();
+    GPIOINT_CallbackRegister(DA7280_NIRQ_INT_NO, _onNIrq);
+    GPIO_ExtIntConfig(DA7280_NIRQ_PORT, DA7280_NIRQ_PIN, DA7280_NIRQ_INT_NO, false, true, true);
+
+    // Events latched before the interrupt was enabled hold the line low without an edge
+    _pending = _lineAsserted();
+    if (_pending)
+    {
+        app_proceed();
+    }
+}
+
+bool da7280_nirqPending(void)
+{
+    return _pending;
+}
+
+uint8_t da7280_nirqService(void)
+{
+    irqSnapshot irq = {0};
+
+    if (!_pending)
+    {
+        return 0;
+    }
+    _pending = false;
+
+    if (da7280_getIrqSnapshot(&irq) && irq.events != HAPTIC_SUCCESS)
+    {
+        da7280_clearIrq(irq.events);
+
+        // E_UVLO is a fault itself, E_MEM_FAULT comes with E_SEQ_FAULT
+        if (irq.events & FAULT_EVENTS)
+        {
+            // Read before the repair below rewrites TOP_CTL1
+            uint8_t mode = da7280_getOperationMode();
+
+            // A brown-out or a memory fault may have corrupted the waveform
+            // memory; repair the bytes that differ instead of uploading it again
+            if ((irq.events & E_UVLO) || (irq.seqDiag & E_MEM_FAULT))
+            {
+                da7280_verifyWaveformMemory(NULL);
+            }
+            // GPI triggering stays armed, everything else stops in DRO_MODE
+            da7280_setOperationMode((mode == ETWM_MODE) ? ETWM_MODE : DRO_MODE);
+        }
+    }
+
+    // An event latched after the snapshot keeps the line low, so no new edge
+    // follows; catch it on the next pass. With queued writes the clear may
+    // still be pending, which costs one more snapshot read at most.
+    if (_lineAsserted())
+    {
+        _pending = true;
+        app_proceed();
+    }
+    return irq.events;
+}
@@ -0,0 +1,22 @@
+#ifndef DA7280_NIRQ_H
+#define DA7280_NIRQ_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Services DA7280 interrupts from the nIRQ line instead of polling IRQ_EVENT1.
+// The falling edge only sets a flag and requests the application process
+// action, the registers are read and cleared from da7280_nirqService().
+
+void da7280_nirqInit(void);
+bool da7280_nirqPending(void);
+
+// Reads the IRQ snapshot and clears the events if the line asserted since
+// the last call. Faults return to DRO_MODE, or to ETWM_MODE if the device
+// was still in it, E_SEQ_DONE and warnings leave the mode alone; after
+// E_UVLO or E_MEM_FAULT the waveform memory is verified and repaired. A
+// fault that already dropped the IC to INACTIVE ends edge-triggered mode,
+// the application arms it again. Returns the events that were cleared.
+uint8_t da7280_nirqService(void);
+
+#endif // DA7280_NIRQ_H
@@ -0,0 +1,14 @@
+#ifndef DA7280_NIRQ_CONFIG_H
+#define DA7280_NIRQ_CONFIG_H
+
+// GPIO the DA7280 nIRQ output is wired to. nIRQ is open drain and active low,
+// the pin is configured as input with pull-up. On series 2 devices only port
+// A and B pin interrupts wake the core from EM2.
+#define DA7280_NIRQ_PORT        gpioPortA
+#define DA7280_NIRQ_PIN         5
+
+// External interrupt line; on series 2 it must be in the same group of four
+// as the pin number.
+#define DA7280_NIRQ_INT_NO      DA7280_NIRQ_PIN
+
+#endif // DA7280_NIRQ_CONFIG_H
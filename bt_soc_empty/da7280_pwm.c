@@ -0,0 +1,241 @@
+#include "da7280_pwm.h"
+#include "sl_core.h"
+#include "sl_sleeptimer.h"
+
+#include <string.h>
+
+#define MIN_DUTY_STEPS          100
+// Samples of at least this many sleeptimer ticks (244 us at 32768 Hz) are
+// loaded from a sleeptimer timer, one wake-up each; shorter ones are counted
+// in PWM periods by the overflow interrupt
+#define MIN_SLEEPTIMER_TICKS    8
+
+static TIMER_TypeDef *_timer = NULL;
+static uint8_t  _cc = 0;
+static uint32_t _top = 0;
+static uint32_t _pwmHz = 0;
+static bool     _acceleration = true;
+static uint32_t _table[DA7280_PWM_TABLE_LEN];   // compare values
+static volatile size_t   _tableLen = 0;
+static volatile size_t   _next = 0;             // entry loaded at the end of the current sample
+static volatile uint32_t _periodsLeft = 0;
+static uint32_t _periodUnits = 0;               // PWM periods per sample, in millionths
+static uint32_t _periodPhase = 0;               // fraction carried to the next sample
+static volatile bool     _streaming = false;
+static volatile uint32_t _irqCount = 0;
+static sl_sleeptimer_timer_handle_t _sampleTimer;
+static uint64_t _streamStartTick = 0;
+static uint32_t _periodUs = 0;
+
+static uint32_t _compareValue(uint8_t level)
+{
+    uint32_t periodCounts = _top + 1;
+
+    if (_acceleration)
+    {
+        // ACCELERATION_EN limits TOP_CTL2 to 0x7F
+        level = (level > 0x7F) ? 0x7F : level;
+        return (level * periodCounts + 0x3F) / 0x7F;
+    }
+    // Two's complement level, 0 at half duty
+    int32_t offset = ((int32_t)(int8_t)level * (int32_t)periodCounts) / 256;
+    return (uint32_t)((int32_t)periodCounts / 2 + offset);
+}
+
+static void _stopStream(void)
+{
+    bool running = false;
+
+    _streaming = false;
+    TIMER_IntDisable(_timer, TIMER_IEN_OF);
+    TIMER_IntClear(_timer, TIMER_IF_OF);
+    sl_sleeptimer_is_timer_running(&_sampleTimer, &running);
+    if (running)
+    {
+        sl_sleeptimer_stop_timer(&_sampleTimer);
+    }
+}
+
+static void _onSampleTimer(sl_sleeptimer_timer_handle_t *handle, void *data);
+
+// Whole PWM periods of the next sample, the fractions add up so that the
+// samples keep to periodUs on average
+static uint32_t _nextPeriods(void)
+{
+    _periodPhase += _periodUnits;
+    uint32_t periods = _periodPhase / 1000000u;
+    _periodPhase -= periods * 1000000u;
+    return (periods > 0) ? periods : 1;
+}
+
+// Arms the sleeptimer for the start of sample _next, the end of the stream
+// after the last. Rounded down to the tick: the compare value is buffered,
+// so it still waits for the first PWM period at or after the deadline.
+static void _armSample(void)
+{
+    uint64_t now = sl_sleeptimer_get_tick_count64();
+    uint64_t due = _streamStartTick + ((uint64_t)_next * _periodUs * sl_sleeptimer_get_timer_frequency()) / 1000000u;
+
+    if (sl_sleeptimer_start_timer(&_sampleTimer, (due > now) ? (uint32_t)(due - now) : 0,
+                                  _onSampleTimer, NULL, 0, 0) != SL_STATUS_OK)
+    {
+        _stopStream();
+    }
+}
+
+static void _onSampleTimer(sl_sleeptimer_timer_handle_t *handle, void *data)
+{
+    (void)handle;
+    (void)data;
+
+    _irqCount++;
+    if (!_streaming)
+    {
+        return;
+    }
+    if (_next >= _tableLen)
+    {
+        // The last level was held for its time and stays
+        _stopStream();
+        return;
+    }
+    TIMER_CompareBufSet(_timer, _cc, _table[_next++]);
+    _armSample();
+}
+
+bool da7280_pwmInit(TIMER_TypeDef *timer, uint8_t cc, uint32_t timerClockHz, uint32_t pwmHz)
+{
+    if (pwmHz < DA7280_PWM_MIN_HZ || pwmHz > DA7280_PWM_MAX_HZ || cc >= TIMER_NUM_CC ||
+        timerClockHz / pwmHz < MIN_DUTY_STEPS)
+    {
+        return false;
+    }
+    if (_timer != NULL)
+    {
+        _stopStream();
+    }
+    _timer = timer;
+    _cc = cc;
+    _top = timerClockHz / pwmHz - 1;
+    _pwmHz = timerClockHz / (_top + 1);
+    _streaming = false;
+    _irqCount = 0;
+
+    TIMER_Init_TypeDef init = TIMER_INIT_DEFAULT;
+    init.enable = false;
+    TIMER_Init(_timer, &init);
+
+    TIMER_InitCC_TypeDef ccInit = TIMER_INITCC_DEFAULT;
+    ccInit.mode = timerCCModePWM;
+    TIMER_InitCC(_timer, _cc, &ccInit);
+
+    TIMER_TopSet(_timer, _top);
+    TIMER_CompareSet(_timer, _cc, 0);
+    TIMER_IntDisable(_timer, TIMER_IEN_OF);
+    TIMER_IntClear(_timer, TIMER_IF_OF);
+    TIMER_Enable(_timer, true);
+    return true;
+}
+
+bool da7280_pwmIsReady(void)
+{
+    return _timer != NULL;
+}
+
+void da7280_pwmSetAcceleration(bool enabled)
+{
+    _acceleration = enabled;
+}
+
+void da7280_pwmSetLevel(uint8_t level)
+{
+    if (_timer == NULL)
+    {
+        return;
+    }
+    CORE_DECLARE_IRQ_STATE;
+    CORE_ENTER_ATOMIC();
+    _stopStream();
+    TIMER_CompareBufSet(_timer, _cc, _compareValue(level));
+    CORE_EXIT_ATOMIC();
+}
+
+bool da7280_pwmStream(const uint8_t levels[], size_t n, uint32_t periodUs)
+{
+    if (_timer == NULL || n == 0 || n > DA7280_PWM_TABLE_LEN)
+    {
+        return false;
+    }
+
+    CORE_DECLARE_IRQ_STATE;
+    CORE_ENTER_ATOMIC();
+    _stopStream();
+    for (size_t i = 0; i < n; i++)
+    {
+        _table[i] = _compareValue(levels[i]);
+    }
+    _tableLen = n;
+    _periodUs = periodUs;
+
+    // The first level is taken over at the next overflow. Long samples wake
+    // once each from the sleeptimer; short ones from the interrupt of every
+    // overflow, which counts their periods down.
+    TIMER_CompareBufSet(_timer, _cc, _table[0]);
+    _next = 1;
+    _streaming = true;
+    if ((uint64_t)periodUs * sl_sleeptimer_get_timer_frequency() >= MIN_SLEEPTIMER_TICKS * 1000000ull)
+    {
+        _streamStartTick = sl_sleeptimer_get_tick_count64();
+        _armSample();
+    }
+    else
+    {
+        _periodUnits = periodUs * _pwmHz;
+        _periodPhase = 500000u;
+        _periodsLeft = _nextPeriods();
+        TIMER_IntEnable(_timer, TIMER_IEN_OF);
+    }
+    CORE_EXIT_ATOMIC();
+    return true;
+}
+
+bool da7280_pwmIsStreaming(void)
+{
+    return _streaming;
+}
+
+void da7280_pwmStop(void)
+{
+    if (_timer == NULL)
+    {
+        return;
+    }
+    CORE_DECLARE_IRQ_STATE;
+    CORE_ENTER_ATOMIC();
+    _stopStream();
+    CORE_EXIT_ATOMIC();
+}
+
+uint32_t da7280_pwmIrqCount(void)
+{
+    return _irqCount;
+}
+
+void da7280_pwmIrqHandler(void)
+{
+    TIMER_IntClear(_timer, TIMER_IF_OF);
+    _irqCount++;
+    if (!_streaming || --_periodsLeft > 0)
+    {
+        return;
+    }
+    if (_next >= _tableLen)
+    {
+        // The last level was held for its periods and stays
+        _stopStream();
+        return;
+    }
+    // Buffered, so it starts with the next period whatever the latency here
+    TIMER_CompareBufSet(_timer, _cc, _table[_next++]);
+    _periodsLeft = _nextPeriods();
+}
@@ -0,0 +1,52 @@
+#ifndef DA7280_PWM_H
+#define DA7280_PWM_H
+
+#include "em_timer.h"
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Amplitude of the DA7280 in PWM_MODE from the duty cycle of a TIMER
+// compare channel routed to GPI0/PWM. Levels are written to the buffered
+// compare value and taken over at the next timer overflow, no bus access.
+// A stream of levels is fed from a table, one wake-up per level from a
+// sleeptimer timer for levels of 244 us or more. Shorter levels are counted
+// in PWM periods by da7280_pwmIrqHandler(), which must be called from the
+// timer's IRQ handler; the overflow interrupt is only enabled while such a
+// stream plays. Clocking the timer and routing the channel to the pin are
+// left to the caller.
+
+#define DA7280_PWM_MIN_HZ       10000   // slowest PWM the DA7280 accepts
+#define DA7280_PWM_MAX_HZ       250000
+#define DA7280_PWM_TABLE_LEN    256
+
+// Sets up channel cc of timer for PWM at pwmHz from a timer clock of
+// timerClockHz, at 0 % duty. False outside the DA7280's PWM range or if
+// the timer clock leaves fewer than 100 duty steps.
+bool da7280_pwmInit(TIMER_TypeDef *timer, uint8_t cc, uint32_t timerClockHz, uint32_t pwmHz);
+bool da7280_pwmIsReady(void);
+
+// Maps levels as TOP_CTL2 does for the ACCELERATION_EN setting: 0..0x7F
+// over 0..100 % with it, a signed level around 50 % without.
+void da7280_pwmSetAcceleration(bool enabled);
+
+// Duty cycle of level from the next PWM period on; stops a stream.
+void da7280_pwmSetLevel(uint8_t level);
+
+// Plays levels[] from the next PWM period on, each held for periodUs and
+// holds the last one. A level loaded from the sleeptimer starts with the
+// first PWM period from a tick before its deadline, one from the overflow
+// interrupt after whole PWM periods that keep to periodUs on average. The levels are
+// copied, at most DA7280_PWM_TABLE_LEN. Replaces a stream in progress.
+bool da7280_pwmStream(const uint8_t levels[], size_t n, uint32_t periodUs);
+bool da7280_pwmIsStreaming(void);
+
+// Stops a stream, the duty cycle in use is held.
+void da7280_pwmStop(void);
+
+// Overflow and sleeptimer interrupts handled since da7280_pwmInit()
+uint32_t da7280_pwmIrqCount(void);
+void da7280_pwmIrqHandler(void);
+
+#endif // DA7280_PWM_H
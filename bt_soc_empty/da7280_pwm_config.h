@@ -0,0 +1,22 @@
+#ifndef DA7280_PWM_CONFIG_H
+#define DA7280_PWM_CONFIG_H
+
+// Plays the passes the pattern player writes step by step in PWM_MODE from
+// a TIMER compare channel instead of TOP_CTL2 writes, see da7280_pwm.h.
+// Needs the pin below wired to GPI0/PWM of the DA7280; 0 keeps DRO_MODE.
+#define DA7280_PWM_BACKEND      0
+
+#define DA7280_PWM_TIMER        TIMER0
+#define DA7280_PWM_TIMER_NUM    0
+#define DA7280_PWM_TIMER_CLOCK  cmuClock_TIMER0
+#define DA7280_PWM_TIMER_IRQn   TIMER0_IRQn
+#define DA7280_PWM_IRQHandler   TIMER0_IRQHandler
+// Output of compare channel 0
+#define DA7280_PWM_PORT         gpioPortC
+#define DA7280_PWM_PIN          1
+
+// 10 kHz..250 kHz, above the audible range and with 100 or more duty steps
+// from the timer clock
+#define DA7280_PWM_HZ           20000
+
+#endif // DA7280_PWM_CONFIG_H
@@ -0,0 +1,106 @@
+#include "da7280_ramp.h"
+
+#include <stddef.h>
+
+#define LUT_SEGMENTS        (RAMP_LUT_SIZE - 1)
+#define LUT_SEGMENT_BITS    6
+#define PHASE_FRAC_BITS     16
+#define FRACTION_BITS       16      // table values, 65535 is the whole way
+
+// Generated with x = i / 64, i = 0..64, scaled to 0..65535 and rounded.
+// (e^(x ln 16) - 1) / 15, the slope grows 16 times from start to end
+static const uint16_t _expLut[RAMP_LUT_SIZE] = {
+        0,   193,   395,   606,   827,  1057,  1297,  1548,
+     1810,  2083,  2369,  2667,  2979,  3304,  3644,  3999,
+     4369,  4756,  5160,  5582,  6022,  6482,  6963,  7464,
+     7988,  8536,  9107,  9703, 10327, 10977, 11657, 12366,
+    13107, 13881, 14689, 15532, 16414, 17334, 18295, 19298,
+    20346, 21440, 22583, 23776, 25022, 26323, 27682, 29101,
+    30583, 32130, 33746, 35434, 37196, 39036, 40958, 42965,
+    45061, 47249, 49534, 51921, 54413, 57016, 59733, 62571,
+    65535
+};
+
+// (1 - cos(pi x)) / 2
+static const uint16_t _cosLut[RAMP_LUT_SIZE] = {
+        0,    39,   158,   355,   630,   982,  1411,  1915,
+     2494,  3146,  3869,  4662,  5522,  6448,  7438,  8488,
+     9597, 10762, 11980, 13248, 14563, 15922, 17321, 18758,
+    20228, 21728, 23256, 24806, 26375, 27960, 29556, 31160,
+    32767, 34375, 35979, 37575, 39160, 40729, 42279, 43807,
+    45307, 46777, 48214, 49613, 50972, 52287, 53555, 54773,
+    55938, 57047, 58097, 59087, 60013, 60873, 61666, 62389,
+    63041, 63620, 64124, 64553, 64905, 65180, 65377, 65496,
+    65535
+};
+
+static const uint16_t *_tables[RAMP_NUM_SHAPES] = { NULL, NULL, _expLut, _cosLut };
+
+uint16_t da7280_rampSamples(uint16_t rampMs, uint16_t rateHz)
+{
+    uint32_t samples = ((uint32_t)rampMs * rateHz) / 1000u;
+
+    if (samples == 0)
+    {
+        return 1;
+    }
+    return (samples > UINT16_MAX) ? UINT16_MAX : (uint16_t)samples;
+}
+
+void da7280_rampInit(rampState *ramp, rampShape shape, uint8_t from, uint8_t to, uint16_t numSamples)
+{
+    ramp->from       = from;
+    ramp->to         = to;
+    ramp->shape      = (shape < RAMP_NUM_SHAPES) ? shape : RAMP_STEP;
+    ramp->falling    = to < from;
+    ramp->numSamples = (ramp->shape == RAMP_STEP || numSamples == 0) ? 1 : numSamples;
+    ramp->sample     = 0;
+    ramp->phase      = 0;
+    ramp->phaseStep  = ((uint32_t)LUT_SEGMENTS << PHASE_FRAC_BITS) / ramp->numSamples;
+}
+
+bool da7280_rampDone(const rampState *ramp)
+{
+    return ramp->sample >= ramp->numSamples;
+}
+
+uint8_t da7280_rampNext(rampState *ramp)
+{
+    if (ramp->sample + 1u >= ramp->numSamples)
+    {
+        // The last sample lands on the level whatever the rounding so far
+        ramp->sample = ramp->numSamples;
+        return ramp->to;
+    }
+    ramp->sample++;
+    ramp->phase += ramp->phaseStep;
+
+    // A falling ramp reads the table from the end and takes the value as
+    // the share still to go, so the exponential stays slow near the lower
+    // level in both directions
+    uint32_t phase = ramp->falling ? ((uint32_t)LUT_SEGMENTS << PHASE_FRAC_BITS) - ramp->phase : ramp->phase;
+    uint32_t fraction;
+    const uint16_t *table = _tables[ramp->shape];
+
+    if (table == NULL)
+    {
+        fraction = phase >> (PHASE_FRAC_BITS + LUT_SEGMENT_BITS - FRACTION_BITS);
+    }
+    else
+    {
+        uint32_t index = phase >> PHASE_FRAC_BITS;
+        uint32_t frac  = phase & ((1u << PHASE_FRAC_BITS) - 1);
+        uint32_t a     = table[index];
+        uint32_t b     = table[(index < LUT_SEGMENTS) ? index + 1 : index];
+
+        fraction = a + (((b - a) * frac) >> PHASE_FRAC_BITS);
+    }
+    if (ramp->falling)
+    {
+        // Still to go, counted from to
+        uint32_t span = ramp->from - ramp->to;
+        return (uint8_t)(ramp->to + ((span * fraction + (1u << (FRACTION_BITS - 1))) >> FRACTION_BITS));
+    }
+    uint32_t span = ramp->to - ramp->from;
+    return (uint8_t)(ramp->from + ((span * fraction + (1u << (FRACTION_BITS - 1))) >> FRACTION_BITS));
+}
@@ -0,0 +1,504 @@
+#include "da7280_wavemem.h"
+
+#include <string.h>
+
+#define PWL_TIME_MAX        7       // TIME[6:4], 8 timebases
+#define PWL_TIME_ANY        0xFF
+#define SILENCE_TIME        1       // snippet 0 is two timebases of silence
+#define FRAME_LOOPS_MAX     16      // SNP_ID_LOOP + 1
+#define FRAME_MAX_US        ((PWL_TIME_MAX + 1) * 87040u * FRAME_LOOPS_MAX)
+
+typedef struct
+{
+    uint8_t  snippetId;
+    uint8_t  gain;          // GAIN[1:0], 0 dB to -18 dB
+    uint8_t  timeBase;      // TIMEBASE[1:0]
+    uint8_t  time;          // TIME of the snippet, length - 1 timebases
+    uint8_t  loops;
+    uint32_t playedUs;
+} frameSpec;
+
+static const uint32_t _timeBaseUs[4] = { 5440, 21760, 43520, 87040 };
+// 0 dB, -6 dB, -12 dB and -18 dB
+static const uint16_t _gainPermille[4] = { 1000, 501, 251, 126 };
+
+uint32_t da7280_wavememTimeBaseUs(uint8_t timeBase)
+{
+    return _timeBaseUs[timeBase & 0x03];
+}
+
+// Closest AMP/GAIN pair to level. The frame gain refines the 4-bit AMP, so
+// low levels are not all rounded to the same one or two AMP steps.
+static uint8_t _pickAmplitude(uint8_t level, uint8_t fullScale, uint8_t ampMax, uint8_t *gain)
+{
+    uint32_t target = ((uint32_t)level * ampMax * 1000u + fullScale / 2) / fullScale;
+    uint32_t bestErr = UINT32_MAX;
+    uint8_t  bestAmp = 0;
+
+    *gain = 0;
+    for (uint8_t g = 0; g < 4; g++)
+    {
+        for (uint8_t amp = 0; amp <= ampMax; amp++)
+        {
+            uint32_t value = (uint32_t)amp * _gainPermille[g];
+            uint32_t err = (value > target) ? value - target : target - value;
+            if (err < bestErr)
+            {
+                bestErr = err;
+                bestAmp = amp;
+                *gain   = g;
+            }
+        }
+    }
+    return bestAmp;
+}
+
+// Timebase, snippet length and loop count closest to targetUs. With a fixed
+// snippet length only the timebase and loops are free. Single loops come
+// first so that a tie does not cost the second frame byte.
+static uint32_t _pickTiming(uint32_t targetUs, uint8_t fixedTime, frameSpec *frame)
+{
+    uint32_t bestErr = UINT32_MAX;
+
+    for (uint8_t loops = 1; loops <= FRAME_LOOPS_MAX; loops++)
+    {
+        for (uint8_t tb = 0; tb < 4; tb++)
+        {
+            for (uint8_t time = 0; time <= PWL_TIME_MAX; time++)
+            {
+                if (fixedTime != PWL_TIME_ANY && time != fixedTime)
+                {
+                    continue;
+                }
+
+                uint32_t played = (uint32_t)(time + 1) * _timeBaseUs[tb] * loops;
+                uint32_t err = (played > targetUs) ? played - targetUs : targetUs - played;
+                if (err < bestErr)
+                {
+                    bestErr         = err;
+                    frame->timeBase = tb;
+                    frame->time     = time;
+                    frame->loops    = loops;
+                    frame->playedUs = played;
+                }
+            }
+        }
+    }
+    return bestErr;
+}
+
+static size_t _encodeFrame(const frameSpec *frame, uint8_t out[])
+{
+    // COMMAND_TYPE = 0, GAIN, TIMEBASE, SNP_ID_L
+    out[0] = (uint8_t)((frame->gain << 5) | (frame->timeBase << 3) | (frame->snippetId & 0x07));
+    if (frame->loops == 1 && frame->snippetId < 8)
+    {
+        return 1;
+    }
+
+    // COMMAND_TYPE = 1, SNP_ID_LOOP, FREQ_CMD = 0, SNP_ID_H
+    out[1] = (uint8_t)(0x80 | ((frame->loops - 1) << 3) | (frame->snippetId >> 3));
+    return 2;
+}
+
+// Frames of a sequence and the snippets it needs on top of the builder's
+typedef struct
+{
+    uint8_t       frames[2 * WAVEMEM_MAX_STEPS];
+    size_t        numFrameBytes;
+    uint8_t       newSnippets[WAVEMEM_MAX_SNIPPETS];
+    uint8_t       numNewSnippets;
+    uint8_t       numUsedSnippets;
+    wavememTiming timing;
+} sequencePlan;
+
+static bool _planSequence(const wavememBuilder *builder, const wavememStep steps[], size_t count,
+                          sequencePlan *plan)
+{
+    const wavememFormat *format = &builder->format;
+    uint8_t  ampMax = format->accelerated ? 15 : 7;
+    uint16_t used   = 0;
+
+    memset(plan, 0, sizeof(*plan));
+    if (count == 0 || count > WAVEMEM_MAX_STEPS || format->fullScale == 0)
+    {
+        return false;
+    }
+
+    for (size_t i = 0; i < count; i++)
+    {
+        uint32_t  targetUs = (uint32_t)steps[i].duration_ms * 1000u;
+        frameSpec frame    = {0};
+
+        if (targetUs > FRAME_MAX_US)
+        {
+            return false;
+        }
+
+        uint8_t  level = (steps[i].level > format->fullScale) ? format->fullScale : steps[i].level;
+        uint8_t  amp   = _pickAmplitude(level, format->fullScale, ampMax, &frame.gain);
+        uint32_t err   = _pickTiming(targetUs, PWL_TIME_ANY, &frame);
+
+        // The built-in silence snippet takes no memory
+        frameSpec silence    = {0};
+        uint32_t  silenceErr = (amp == 0) ? _pickTiming(targetUs, SILENCE_TIME, &silence) : UINT32_MAX;
+        if (silenceErr <= err)
+        {
+            frame = silence;
+            err   = silenceErr;
+        }
+        else
+        {
+            // RMP = 0, one step of AMP held for TIME + 1 timebases. Snippets
+            // of earlier sequences come first, then the ones this one adds.
+            uint8_t pwl = (uint8_t)((frame.time << 4) | amp);
+            uint8_t id  = 0;
+
+            while (id < builder->numSnippets && builder->snippets[id] != pwl)
+            {
+                id++;
+            }
+            if (id == builder->numSnippets)
+            {
+                uint8_t n = 0;
+                while (n < plan->numNewSnippets && plan->newSnippets[n] != pwl)
+                {
+                    n++;
+                }
+                if (n == plan->numNewSnippets)
+                {
+                    if (builder->numSnippets + n == WAVEMEM_MAX_SNIPPETS)
+                    {
+                        return false;
+                    }
+                    plan->newSnippets[plan->numNewSnippets++] = pwl;
+                }
+                id += n;
+            }
+            frame.snippetId = id + 1;
+            used |= (uint16_t)(1u << id);
+        }
+
+        plan->numFrameBytes += _encodeFrame(&frame, &plan->frames[plan->numFrameBytes]);
+
+        plan->timing.targetUs += targetUs;
+        plan->timing.playedUs += frame.playedUs;
+        if (err > plan->timing.worstErrorUs)
+        {
+            plan->timing.worstErrorUs = err;
+            plan->timing.worstStep    = (uint8_t)i;
+        }
+    }
+
+    while (used != 0)
+    {
+        plan->numUsedSnippets += used & 1u;
+        used >>= 1;
+    }
+    return true;
+}
+
+// ID of a sequence with exactly the planned frames, -1 if there is none
+static int _findSequence(const wavememBuilder *builder, const sequencePlan *plan)
+{
+    if (plan->numNewSnippets > 0)
+    {
+        return -1;
+    }
+    for (uint8_t s = 0; s < builder->numSequences; s++)
+    {
+        uint8_t start = (s == 0) ? 0 : builder->seqEnd[s - 1];
+        if ((size_t)(builder->seqEnd[s] - start) == plan->numFrameBytes &&
+            memcmp(&builder->frames[start], plan->frames, plan->numFrameBytes) == 0)
+        {
+            return s;
+        }
+    }
+    return -1;
+}
+
+// New snippets take a PWL byte and an end pointer, the sequence its frames and an end pointer
+static size_t _planCost(const wavememBuilder *builder, const sequencePlan *plan)
+{
+    size_t cost = plan->numFrameBytes + 1 + 2u * plan->numNewSnippets;
+
+    if (builder->numSequences == WAVEMEM_MAX_SEQUENCES || da7280_wavememUsed(builder) + cost > WAVEMEM_SIZE)
+    {
+        return SIZE_MAX;
+    }
+    return cost;
+}
+
+void da7280_wavememInit(wavememBuilder *builder, const wavememFormat *format)
+{
+    memset(builder, 0, sizeof(*builder));
+    builder->format = *format;
+}
+
+int da7280_wavememAddSequence(wavememBuilder *builder, const wavememStep steps[], size_t count,
+                              wavememTiming *timing)
+{
+    sequencePlan plan;
+
+    if (timing != NULL)
+    {
+        memset(timing, 0, sizeof(*timing));
+    }
+    if (!_planSequence(builder, steps, count, &plan))
+    {
+        return -1;
+    }
+
+    // Patterns with the same frames play the same sequence
+    int id = _findSequence(builder, &plan);
+    if (id < 0)
+    {
+        if (_planCost(builder, &plan) == SIZE_MAX)
+        {
+            return -1;
+        }
+        memcpy(&builder->snippets[builder->numSnippets], plan.newSnippets, plan.numNewSnippets);
+        builder->numSnippets += plan.numNewSnippets;
+        builder->snippetRefs += plan.numUsedSnippets;
+        memcpy(&builder->frames[builder->numFrameBytes], plan.frames, plan.numFrameBytes);
+        builder->numFrameBytes += (uint8_t)plan.numFrameBytes;
+        builder->seqEnd[builder->numSequences] = builder->numFrameBytes;
+        id = builder->numSequences++;
+    }
+
+    if (timing != NULL)
+    {
+        *timing = plan.timing;
+    }
+    return id;
+}
+
+size_t da7280_wavememCost(const wavememBuilder *builder, const wavememStep steps[], size_t count)
+{
+    sequencePlan plan;
+
+    if (!_planSequence(builder, steps, count, &plan))
+    {
+        return SIZE_MAX;
+    }
+    return (_findSequence(builder, &plan) >= 0) ? 0 : _planCost(builder, &plan);
+}
+
+size_t da7280_wavememUsed(const wavememBuilder *builder)
+{
+    // Counts, an end pointer and a PWL byte per snippet, an end pointer per sequence, frames
+    return 2u + 2u * builder->numSnippets + builder->numSequences + builder->numFrameBytes;
+}
+
+void da7280_wavememGetUsage(const wavememBuilder *builder, wavememUsage *usage)
+{
+    usage->headerBytes  = 2 + builder->numSnippets + builder->numSequences;
+    usage->snippetBytes = builder->numSnippets;
+    usage->frameBytes   = builder->numFrameBytes;
+    usage->freeBytes    = (uint8_t)(WAVEMEM_SIZE - da7280_wavememUsed(builder));
+    usage->numSnippets  = builder->numSnippets;
+    usage->numSequences = builder->numSequences;
+    usage->sharedBytes  = 2 * (builder->snippetRefs - builder->numSnippets);
+}
+
+void da7280_wavememBuild(const wavememBuilder *builder, wavememImage *image)
+{
+    uint8_t base = builder->format.baseAddr;
+    size_t  pos  = 2u + builder->numSnippets + builder->numSequences;
+
+    memset(image->bytes, 0, sizeof(image->bytes));
+    image->bytes[0] = builder->numSnippets;
+    image->bytes[1] = builder->numSequences;
+    for (uint8_t s = 0; s < builder->numSnippets; s++)
+    {
+        image->bytes[pos] = builder->snippets[s];
+        image->bytes[2 + s] = (uint8_t)(base + pos);
+        pos++;
+    }
+    for (uint8_t s = 0; s < builder->numSequences; s++)
+    {
+        image->bytes[2 + builder->numSnippets + s] = (uint8_t)(base + pos + builder->seqEnd[s] - 1);
+    }
+    memcpy(&image->bytes[pos], builder->frames, builder->numFrameBytes);
+    image->used = (uint8_t)(pos + builder->numFrameBytes);
+}
+
+bool da7280_wavememCompile(const wavememStep steps[], size_t count, const wavememFormat *format,
+                           wavememImage *image, wavememTiming *timing)
+{
+    wavememBuilder builder;
+
+    da7280_wavememInit(&builder, format);
+    if (da7280_wavememAddSequence(&builder, steps, count, timing) < 0)
+    {
+        return false;
+    }
+    da7280_wavememBuild(&builder, image);
+    return true;
+}
+
+bool da7280_wavememAppendSnippets(wavememImage *image, uint8_t baseAddr, const uint8_t pwl[], size_t count)
+{
+    const uint8_t *in = image->bytes;
+    size_t numSnippets  = in[0];
+    size_t numSequences = in[1];
+    size_t numRegions   = numSnippets + numSequences;
+
+    if (numSnippets + count > WAVEMEM_MAX_SNIPPETS || numSequences + count > WAVEMEM_MAX_SEQUENCES)
+    {
+        return false;
+    }
+
+    // Regions end at their end pointer and start right after the previous one
+    size_t oldHeader  = 2 + numRegions;
+    size_t end        = oldHeader;
+    size_t snippetEnd = oldHeader;
+    for (size_t r = 0; r < numRegions; r++)
+    {
+        uint8_t endPointer = in[2 + r];
+        if (endPointer < baseAddr || (size_t)(endPointer - baseAddr) < end || endPointer - baseAddr >= WAVEMEM_SIZE)
+        {
+            return false;
+        }
+        end = endPointer - baseAddr + 1u;
+        if (r + 1 == numSnippets)
+        {
+            snippetEnd = end;
+        }
+    }
+
+    // Every snippet adds two end pointers, which move all data behind the header
+    size_t shift = 2 * count;
+    size_t used  = end + shift + count;
+    for (size_t k = 0; k < count; k++)
+    {
+        used += (numSnippets + 1 + k < 8) ? 1 : 2;
+    }
+    if (used > WAVEMEM_SIZE)
+    {
+        return false;
+    }
+
+    wavememImage out;
+    memset(&out, 0, sizeof(out));
+    out.bytes[0] = (uint8_t)(numSnippets + count);
+    out.bytes[1] = (uint8_t)(numSequences + count);
+
+    size_t pos = oldHeader + shift;
+    memcpy(&out.bytes[pos], &in[oldHeader], snippetEnd - oldHeader);
+    pos += snippetEnd - oldHeader;
+    for (size_t r = 0; r < numSnippets; r++)
+    {
+        out.bytes[2 + r] = (uint8_t)(in[2 + r] + shift);
+    }
+    for (size_t k = 0; k < count; k++)
+    {
+        out.bytes[pos] = pwl[k];
+        out.bytes[2 + numSnippets + k] = (uint8_t)(baseAddr + pos);
+        pos++;
+    }
+
+    uint8_t *seqEnd = &out.bytes[2 + numSnippets + count];
+    memcpy(&out.bytes[pos], &in[snippetEnd], end - snippetEnd);
+    pos += end - snippetEnd;
+    for (size_t r = 0; r < numSequences; r++)
+    {
+        seqEnd[r] = (uint8_t)(in[2 + numSnippets + r] + shift + count);
+    }
+    for (size_t k = 0; k < count; k++)
+    {
+        frameSpec frame = { (uint8_t)(numSnippets + 1 + k), 0, 3, 0, 1, 0 };
+        pos += _encodeFrame(&frame, &out.bytes[pos]);
+        seqEnd[numSequences + k] = (uint8_t)(baseAddr + pos - 1);
+    }
+    out.used = (uint8_t)pos;
+
+    *image = out;
+    return true;
+}
+
+size_t da7280_wavememImageUsed(const uint8_t bytes[], uint8_t baseAddr)
+{
+    size_t numRegions = (size_t)bytes[0] + bytes[1];
+    if (numRegions == 0)
+    {
+        return 2;
+    }
+    if (2 + numRegions > WAVEMEM_SIZE)
+    {
+        return 0;
+    }
+
+    // The last sequence, or snippet without sequences, ends the data
+    uint8_t last = bytes[1 + numRegions];
+    if (last < baseAddr || last - baseAddr >= WAVEMEM_SIZE || (size_t)(last - baseAddr) < 2 + numRegions)
+    {
+        return 0;
+    }
+    return last - baseAddr + 1u;
+}
+
+uint16_t da7280_wavememCrc(const uint8_t bytes[], size_t len)
+{
+    uint16_t crc = 0xFFFF;
+    for (size_t i = 0; i < len; i++)
+    {
+        crc ^= (uint16_t)(bytes[i] << 8);
+        for (int bit = 0; bit < 8; bit++)
+        {
+            crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+size_t da7280_wavememPack(wavememBuilder *builder, size_t numCandidates, size_t numRequired,
+                          wavememStepSource source, void *ctx, uint8_t seqIds[])
+{
+    wavememStep steps[WAVEMEM_MAX_STEPS];
+    size_t packed = 0;
+
+    memset(seqIds, WAVEMEM_NOT_PACKED, numCandidates);
+    for (size_t i = 0; i < numRequired && i < numCandidates; i++)
+    {
+        size_t count = source(i, steps, WAVEMEM_MAX_STEPS, ctx);
+        int    id    = da7280_wavememAddSequence(builder, steps, count, NULL);
+        if (id < 0)
+        {
+            return packed;
+        }
+        seqIds[i] = (uint8_t)id;
+        packed++;
+    }
+
+    // Cheapest first packs the most sequences; shared snippets make a
+    // candidate cheaper once another one has added them, so every round
+    // looks at all of the remaining candidates again
+    for (;;)
+    {
+        size_t best     = numCandidates;
+        size_t bestCost = SIZE_MAX;
+
+        for (size_t i = numRequired; i < numCandidates; i++)
+        {
+            if (seqIds[i] != WAVEMEM_NOT_PACKED)
+            {
+                continue;
+            }
+            size_t cost = da7280_wavememCost(builder, steps, source(i, steps, WAVEMEM_MAX_STEPS, ctx));
+            if (cost < bestCost)
+            {
+                best     = i;
+                bestCost = cost;
+            }
+        }
+        if (best == numCandidates)
+        {
+            return packed;
+        }
+
+        size_t count = source(best, steps, WAVEMEM_MAX_STEPS, ctx);
+        seqIds[best] = (uint8_t)da7280_wavememAddSequence(builder, steps, count, NULL);
+        packed++;
+    }
+}
@@ -0,0 +1,135 @@
+#ifndef DA7280_WAVEMEM_H
+#define DA7280_WAVEMEM_H
+
+/* Compiles vibration patterns into a DA7280 waveform memory image: one step
+ * snippet per distinct amplitude/length pair and one frame per step, each
+ * pattern a sequence. Snippets are shared by every sequence of the image.
+ * No bus access, the same code runs on the device and on a host.
+ *
+ * Image layout (datasheet section 5.8):
+ *   [0]        number of snippets, the built-in silence snippet 0 excluded
+ *   [1]        number of sequences
+ *   [2..]      end pointers, snippets first, each the register address of
+ *              the last byte of its snippet/sequence
+ *   then       snippet PWL bytes, then the frames of every sequence
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define WAVEMEM_SIZE            100     // TOTAL_MEM_REGISTERS
+#define WAVEMEM_MAX_SNIPPETS    15
+#define WAVEMEM_MAX_SEQUENCES   16
+// A frame takes at least one byte next to the three byte header of a
+// single-sequence image, longer patterns can never fit
+#define WAVEMEM_MAX_STEPS       (WAVEMEM_SIZE - 3)
+#define WAVEMEM_NOT_PACKED      0xFF
+
+// One step of a pattern, level is the TOP_CTL2 value it would be played at
+typedef struct
+{
+    uint16_t duration_ms;
+    uint8_t  level;
+} wavememStep;
+
+typedef struct
+{
+    uint8_t fullScale;          // TOP_CTL2 value of 100 % drive
+    bool    accelerated;        // ACCELERATION_EN, AMP is unsigned 0..15 instead of signed -7..7
+    uint8_t baseAddr;           // WAV_MEM_BASE_ADDR, end pointers are absolute
+} wavememFormat;
+
+// Timing of a compiled sequence against the original step durations. The
+// frame timebases (5.44 ms to 87.04 ms, FREQ_WAVEFORM_TIMEBASE = 0) only
+// approximate a step length, the error is reported rather than hidden.
+typedef struct
+{
+    uint32_t targetUs;          // sum of the step durations
+    uint32_t playedUs;          // length of the sequence as the IC plays it
+    uint32_t worstErrorUs;      // largest |played - target| of a single step
+    uint8_t  worstStep;
+} wavememTiming;
+
+typedef struct
+{
+    uint8_t bytes[WAVEMEM_SIZE];
+    uint8_t used;               // bytes from the start of the image that carry data
+} wavememImage;
+
+// Image under construction, sequences are added one by one
+typedef struct
+{
+    wavememFormat format;
+    uint8_t snippets[WAVEMEM_MAX_SNIPPETS];             // PWL byte of each snippet
+    uint8_t numSnippets;
+    uint8_t snippetRefs;                                // snippets used per sequence, summed
+    uint8_t seqEnd[WAVEMEM_MAX_SEQUENCES];              // end of each sequence in frames[]
+    uint8_t numSequences;
+    uint8_t frames[WAVEMEM_SIZE];
+    uint8_t numFrameBytes;
+} wavememBuilder;
+
+typedef struct
+{
+    uint8_t headerBytes;        // counts and end pointers
+    uint8_t snippetBytes;
+    uint8_t frameBytes;
+    uint8_t freeBytes;
+    uint8_t numSnippets;
+    uint8_t numSequences;
+    uint8_t sharedBytes;        // snippet and end pointer bytes saved by sharing snippets
+} wavememUsage;
+
+// Fills steps[] with candidate's pattern and returns its step count, 0 if
+// it has none or more than maxSteps.
+typedef size_t (*wavememStepSource)(size_t candidate, wavememStep steps[], size_t maxSteps, void *ctx);
+
+// Length of one timebase of a frame, FREQ_WAVEFORM_TIMEBASE = 0.
+uint32_t da7280_wavememTimeBaseUs(uint8_t timeBase);
+
+void da7280_wavememInit(wavememBuilder *builder, const wavememFormat *format);
+
+// Adds steps[] as the next sequence, reusing the snippets already in the
+// image and an identical sequence if there is one. Returns the sequence ID,
+// or -1 with the builder unchanged if a step is longer than one frame can
+// play (8 timebases of 87.04 ms, 16 loops) or the sequence needs more
+// snippets or bytes than are left.
+int da7280_wavememAddSequence(wavememBuilder *builder, const wavememStep steps[], size_t count,
+                              wavememTiming *timing);
+
+// Bytes the sequence would add to the image, SIZE_MAX if it cannot be added.
+size_t da7280_wavememCost(const wavememBuilder *builder, const wavememStep steps[], size_t count);
+
+size_t da7280_wavememUsed(const wavememBuilder *builder);
+void da7280_wavememGetUsage(const wavememBuilder *builder, wavememUsage *usage);
+void da7280_wavememBuild(const wavememBuilder *builder, wavememImage *image);
+
+// Builds image with steps[] as sequence 0.
+bool da7280_wavememCompile(const wavememStep steps[], size_t count, const wavememFormat *format,
+                           wavememImage *image, wavememTiming *timing);
+
+// Appends one snippet per pwl[] byte to image, a valid image for baseAddr
+// (all zeros is empty), each with a sequence of one frame that plays it at
+// TIMEBASE 3. Snippets and sequences already in the image keep their IDs.
+// False with image unchanged if it is malformed or snippets, sequences or
+// bytes run out.
+bool da7280_wavememAppendSnippets(wavememImage *image, uint8_t baseAddr, const uint8_t pwl[], size_t count);
+
+// Bytes from the start of image its end pointers reference, the two counts
+// at least. 0 if an end pointer lies outside the memory.
+size_t da7280_wavememImageUsed(const uint8_t bytes[], uint8_t baseAddr);
+
+// CRC-16/CCITT-FALSE (polynomial 0x1021, initial value 0xFFFF) of len bytes,
+// to compare a memory read back against the image it should hold.
+uint16_t da7280_wavememCrc(const uint8_t bytes[], size_t len);
+
+// Packs as many of the candidates as fit. Candidates 0..numRequired-1 are
+// added first and in order, then the remaining candidate that adds the
+// fewest bytes is added until none fits. seqIds[i] receives the sequence ID
+// of candidate i or WAVEMEM_NOT_PACKED. Returns the number of candidates
+// packed, candidates with the same frames share one sequence.
+size_t da7280_wavememPack(wavememBuilder *builder, size_t numCandidates, size_t numRequired,
+                          wavememStepSource source, void *ctx, uint8_t seqIds[]);
+
+#endif // DA7280_WAVEMEM_H
@@ -56,17 +56,13 @@ int main(void)
   app_init();
 
   while (1) {
+    // Writes the next step when its sleeptimer has expired and returns at
+    // once otherwise, so BLE events are handled while a pattern plays
     if(da7280_isActivityTimeSet())
       {
         da7280_performActivity();
       }
 
-    uint8_t irqEvent = da7280_getIrqEvent();
-    if(irqEvent != HAPTIC_SUCCESS)
-      {
-        da7280_clearIrq(irqEvent);
-        da7280_setOperationMode(DRO_MODE);
-      }
     // Silicon Labs components process action routine
     // must be called from the super loop.
     sl_main_process_action();
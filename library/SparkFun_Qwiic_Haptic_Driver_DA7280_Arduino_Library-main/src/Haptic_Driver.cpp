@@ -23,7 +23,7 @@ bool Haptic_Driver::begin(TwoWire &wirePort)
 
     delay(2);
     _i2cPort = &wirePort;
-    uint8_t chipRev;
+    uint8_t chipRev = 0;
 
     uint8_t tempRegVal = _readRegister(CHIP_REV_REG);
     chipRev |= tempRegVal << 8;
@@ -31,8 +31,13 @@ bool Haptic_Driver::begin(TwoWire &wirePort)
 
     if (chipRev != CHIP_REV)
         return false;
-    else
-        return true;
+
+    _loadRegisterShadow();
+    _maxAmplitude = 0;
+    _markWaveFormDirty(BEGIN_SNP_MEM, TOTAL_MEM_REGISTERS, true);
+    _numResidents = 0;
+    memset(_gpiImage, 0, sizeof(_gpiImage));
+    return true;
 }
 
 // Address: 0x13 , bit[5]: default value is 0x00.
@@ -44,7 +49,7 @@ bool Haptic_Driver::setActuatorType(uint8_t actuator)
     if (actuator != LRA_TYPE && actuator != ERM_TYPE)
         return false;
 
-    if (_writeRegister(TOP_CFG1, 0xDF, actuator, 5))
+    if (writeFields<ACTUATOR_TYPE>(actuator))
         return true;
     else
         return false;
@@ -57,10 +62,10 @@ bool Haptic_Driver::setActuatorType(uint8_t actuator)
 bool Haptic_Driver::setOperationMode(uint8_t mode)
 {
 
-    if (mode < 0 || mode > 3)
+    if (mode > ETWM_MODE)
         return false;
 
-    if (_writeRegister(TOP_CTL1, 0xF8, mode, 0))
+    if (writeFields<OPERATION_MODE>(mode))
         return true;
     else
         return false;
@@ -93,39 +98,42 @@ bool Haptic_Driver::defaultMotor()
     sparkSettings.impedance = 13.8; // ohms
     sparkSettings.lraFreq = 170;    // hertz
 
-    if (setActuatorType(sparkSettings.motorType) && setActuatorABSVolt(sparkSettings.absVolt) &&
-        setActuatorNOMVolt(sparkSettings.nomVolt) && setActuatorIMAX(sparkSettings.currMax) &&
-        setActuatorImpedance(sparkSettings.impedance) && setActuatorLRAfreq(sparkSettings.lraFreq))
-        return true;
-    else
-        return false;
+    return setMotor(sparkSettings);
 }
 
 // This function returns a struct of the motor's settings set by the user.
 hapticSettings Haptic_Driver::getSettings()
 {
 
-    hapticSettings temp;
-    uint16_t v2i_factor;
-    temp.nomVolt = _readRegister(ACTUATOR1) * (23.4 * pow(10, -3));
-    temp.absVolt = _readRegister(ACTUATOR2) * (23.4 * pow(10, -3));
-    temp.currMax = (_readRegister(ACTUATOR3) * 7.2) + 28.6;
-    v2i_factor = (_readRegister(CALIB_V2I_H) << 8) | _readRegister(CALIB_IMP_L);
-    temp.impedance = (v2i_factor * 1.6104) / (_readRegister(ACTUATOR3) + 4);
+    hapticSettings temp{};
+
+    // ACTUATOR1 through CALIB_V2I_L in one read
+    uint8_t regs[1 + CALIB_V2I_L - ACTUATOR1 + 1] = {ACTUATOR1};
+    if (!_readConsReg(regs, sizeof(regs)))
+        return temp;
+
+    uint8_t currVal = regs[1 + ACTUATOR3 - ACTUATOR1] & IMAX::mask;
+    uint16_t v2i_factor = (regs[1 + CALIB_V2I_H - ACTUATOR1] << 8) | regs[1 + CALIB_V2I_L - ACTUATOR1];
+
+    temp.nomVolt = regs[1 + ACTUATOR1 - ACTUATOR1] * (23.4 * pow(10, -3));
+    temp.absVolt = regs[1 + ACTUATOR2 - ACTUATOR1] * (23.4 * pow(10, -3));
+    temp.currMax = (currVal * 7.2) + 28.6;
+    temp.impedance = (v2i_factor * 1.6104) / (currVal + 4);
     return temp;
 }
 
 // This function takes a hapticSettings type and calls the respective function
-// to set the various motor characteristics.
+// to set the various motor characteristics. The updates to FRQ_LRA_PER_H
+// through TOP_CFG1 are collected and written in one burst.
 bool Haptic_Driver::setMotor(hapticSettings userSettings)
 {
 
-    if (setActuatorType(userSettings.motorType) && setActuatorABSVolt(userSettings.absVolt) &&
-        setActuatorNOMVolt(userSettings.nomVolt) && setActuatorIMAX(userSettings.currMax) &&
-        setActuatorImpedance(userSettings.impedance) && setActuatorLRAfreq(userSettings.lraFreq))
-        return true;
-    else
-        return false;
+    _beginBurst(FRQ_LRA_PER_H, TOP_CFG1);
+    bool staged = setActuatorType(userSettings.motorType) && setActuatorABSVolt(userSettings.absVolt) &&
+                  setActuatorNOMVolt(userSettings.nomVolt) && setActuatorIMAX(userSettings.currMax) &&
+                  setActuatorImpedance(userSettings.impedance) && setActuatorLRAfreq(userSettings.lraFreq);
+
+    return _commitBurst() && staged;
 }
 
 // Address: 0x0D , bit[7:0]: default value is: 0x78 (2.808 Volts)
@@ -194,7 +202,7 @@ bool Haptic_Driver::setActuatorIMAX(float maxCurr)
 
     maxCurr = (maxCurr - 28.6) / 7.2;
 
-    if (_writeRegister(ACTUATOR3, 0xE0, static_cast<uint8_t>(maxCurr), 0))
+    if (writeFields<IMAX>(static_cast<uint8_t>(maxCurr)))
         return true;
     else
         return false;
@@ -226,7 +234,7 @@ bool Haptic_Driver::setActuatorImpedance(float motorImpedance)
     uint8_t msbImpedance;
     uint8_t lsbImpedance;
     uint16_t v2iFactor;
-    uint8_t maxCurr = _readRegister(ACTUATOR3) | 0x1F;
+    uint8_t maxCurr = _cachedRegister(ACTUATOR3) | 0x1F;
 
     v2iFactor = (motorImpedance * (maxCurr + 4)) / 1.6104;
     msbImpedance = (v2iFactor - (v2iFactor & 0x00FF)) / 256;
@@ -243,11 +251,13 @@ bool Haptic_Driver::setActuatorImpedance(float motorImpedance)
 uint16_t Haptic_Driver::getActuatorImpedance()
 {
 
-    uint16_t regValMSB = _readRegister(CALIB_V2I_H);
-    uint8_t regValLSB = _readRegister(CALIB_V2I_L);
-    uint8_t currVal = _readRegister(ACTUATOR3) & 0x1F;
+    // ACTUATOR3, CALIB_V2I_H and CALIB_V2I_L in one read
+    uint8_t regs[4] = {ACTUATOR3};
+    if (!_readConsReg(regs, sizeof(regs)))
+        return 0;
 
-    uint16_t v2iFactor = (regValMSB << 8) | regValLSB;
+    uint8_t currVal = regs[1] & IMAX::mask;
+    uint16_t v2iFactor = (regs[2] << 8) | regs[3];
 
     return (v2iFactor * 1.6104) / (currVal + 4);
 }
@@ -272,7 +282,7 @@ bool Haptic_Driver::setActuatorLRAfreq(float frequency)
     msbFrequency = (lraPeriod - (lraPeriod & 0x007F)) / 128;
     lsbFrequency = (lraPeriod - 128 * (lraPeriod & 0xFF00));
 
-    if (_writeRegister(FRQ_LRA_PER_H, 0x00, msbFrequency, 0) && _writeRegister(FRQ_LRA_PER_L, 0x80, lsbFrequency, 0))
+    if (_writeRegister(FRQ_LRA_PER_H, 0x00, msbFrequency, 0) && writeFields<LRA_PER_L>(lsbFrequency))
     {
         return true;
     }
@@ -287,10 +297,11 @@ bool Haptic_Driver::setActuatorLRAfreq(float frequency)
 uint16_t Haptic_Driver::readImpAdjus()
 {
 
-    uint8_t tempMSB = _readRegister(CALIB_IMP_H);
-    uint8_t tempLSB = _readRegister(CALIB_IMP_L);
+    uint8_t regs[3] = {CALIB_IMP_H};
+    if (!_readConsReg(regs, sizeof(regs)))
+        return 0;
 
-    uint16_t totalImp = (4 * 62.5 * pow(10, -3) * tempMSB) + (62.5 * pow(10, -3) * tempLSB);
+    uint16_t totalImp = (4 * 62.5 * pow(10, -3) * regs[1]) + (62.5 * pow(10, -3) * regs[2]);
     return totalImp;
 }
 
@@ -311,10 +322,11 @@ bool Haptic_Driver::enableCoinERM()
 bool Haptic_Driver::enableAcceleration(bool enable)
 {
 
-    if (_writeRegister(TOP_CFG1, 0xFB, enable, 2))
-        return true;
-    else
+    if (!writeFields<ACCELERATION_EN>(enable))
         return false;
+
+    _maxAmplitude = enable ? 0x7F : 0xFF;
+    return true;
 }
 
 // Address: 0x13, bit[1]: default value is 0x1
@@ -322,7 +334,7 @@ bool Haptic_Driver::enableAcceleration(bool enable)
 bool Haptic_Driver::enableRapidStop(bool enable)
 {
 
-    if (_writeRegister(TOP_CFG1, 0xFD, enable, 1))
+    if (writeFields<RAPID_STOP_EN>(enable))
         return true;
     else
         return false;
@@ -333,7 +345,7 @@ bool Haptic_Driver::enableRapidStop(bool enable)
 bool Haptic_Driver::enableAmpPid(bool enable)
 {
 
-    if (_writeRegister(TOP_CFG1, 0xFE, enable, 0))
+    if (writeFields<AMP_PID_EN>(enable))
         return true;
     else
         return false;
@@ -344,7 +356,7 @@ bool Haptic_Driver::enableAmpPid(bool enable)
 bool Haptic_Driver::enableFreqTrack(bool enable)
 {
 
-    if (_writeRegister(TOP_CFG1, 0xF7, enable, 3))
+    if (writeFields<FREQ_TRACK_EN>(enable))
         return true;
     else
         return false;
@@ -356,7 +368,7 @@ bool Haptic_Driver::enableFreqTrack(bool enable)
 bool Haptic_Driver::setBemfFaultLimit(bool enable)
 {
 
-    if (_writeRegister(TOP_CFG1, 0xEF, enable, 4))
+    if (writeFields<BEMF_SENSE_EN>(enable))
         return true;
     else
         return false;
@@ -368,7 +380,7 @@ bool Haptic_Driver::setBemfFaultLimit(bool enable)
 bool Haptic_Driver::enableV2iFactorFreeze(bool enable)
 {
 
-    if (_writeRegister(TOP_CFG4, 0x7F, enable, 7))
+    if (writeFields<V2I_FACTOR_FREEZE>(enable))
         return true;
     else
         return false;
@@ -379,7 +391,7 @@ bool Haptic_Driver::enableV2iFactorFreeze(bool enable)
 bool Haptic_Driver::calibrateImpedanceDistance(bool enable)
 {
 
-    if (_writeRegister(TOP_CFG4, 0xBF, enable, 6))
+    if (writeFields<TST_CALIB_IMPEDANCE_DIS>(enable))
         return true;
     else
         return false;
@@ -387,33 +399,53 @@ bool Haptic_Driver::calibrateImpedanceDistance(bool enable)
 
 // Address: 0x23, bit[7:0]
 // Applies the argument "wave" to the register that controls the strength of
-// the vibration. The function first checks if acceleration mode is enabled
-// which limits the maximum value that can be written to the register.
+// the vibration. When acceleration mode is enabled the maximum value that can
+// be written to the register is 0x7F, larger values are limited to that.
 bool Haptic_Driver::setVibrate(uint8_t val)
 {
 
-    if (val < 0)
+    uint8_t maxVal = _amplitudeLimit();
+    if (val > maxVal)
+        val = maxVal; // Just limit the argument to the physical limit
+
+    if (_writeRegister(TOP_CTL2, 0x00, val, 0))
+        return true;
+    else
         return false;
+}
 
-    uint8_t accelState = _readRegister(TOP_CFG1);
-    accelState &= 0x04;
-    accelState = accelState >> 2;
+// Address: 0x23, bit[7:0]
+// Writes the given levels to the vibration register one after the other,
+// holding each one for periodUs microseconds, to play an amplitude envelope
+// in DRO_MODE. The acceleration limit is resolved once for the whole stream.
+bool Haptic_Driver::streamAmplitudes(const uint8_t levels[], size_t numLevels, uint16_t periodUs)
+{
 
-    if (accelState == ENABLE)
-    {
-        if (val > 0x7F)
-            val = 0x7F; // Just limit the argument to the physical limit
-    }
-    else
+    uint8_t maxVal = _amplitudeLimit();
+    unsigned long start = micros();
+
+    for (size_t i = 0; i <= numLevels; i++)
     {
-        if (val > 0xFF)
-            val = 0xFF; // Just limit the argument to the physical limit
+        // Deadlines are taken from the start of the stream so the time spent
+        // on the bus does not add up, the last level is held a full period.
+        unsigned long deadline = (unsigned long)i * periodUs;
+        unsigned long elapsed = micros() - start;
+        if (elapsed < deadline)
+        {
+            unsigned long remaining = deadline - elapsed;
+            delay(remaining / 1000); // delayMicroseconds() is only accurate up to 16383
+            delayMicroseconds(remaining % 1000);
+        }
+
+        if (i == numLevels)
+            break;
+
+        uint8_t val = (levels[i] > maxVal) ? maxVal : levels[i];
+        if (!_writeRegister(TOP_CTL2, 0x00, val, 0))
+            return false;
     }
 
-    if (_writeRegister(TOP_CTL2, 0x00, val, 0))
-        return true;
-    else
-        return false;
+    return true;
 }
 
 // Address: 0x23, bit[7:0]
@@ -440,7 +472,7 @@ bool Haptic_Driver::setFullBrake(uint8_t thresh)
     if (thresh < 0 || thresh > 15)
         return false;
 
-    if (_writeRegister(TOP_CFG2, 0xF0, thresh, 0))
+    if (writeFields<FULL_BRAKE_THR>(thresh))
         return true;
     else
         return false;
@@ -475,7 +507,7 @@ bool Haptic_Driver::setBemf(uint8_t val)
     if (val < 0 || val > 3)
         return false;
 
-    if (_writeRegister(TOP_INT_CFG1, 0xFC, val, 0))
+    if (writeFields<BEMF_FAULT_LIM>(val))
         return true;
     else
         return false;
@@ -505,9 +537,12 @@ void Haptic_Driver::createHeader(uint8_t numSnippets, uint8_t numSequences)
 {
 }
 
+// Address: 0x03, bit[7:0]
+// IRQ_EVENT1 is write-1-to-clear, so only the given bits are written; writing
+// back the other pending bits would clear them as well.
 void Haptic_Driver::clearIrq(uint8_t irq)
 {
-    _writeRegister(IRQ_EVENT1, ~irq, irq, 0);
+    _writeRegister(IRQ_EVENT1, 0x00, irq, 0);
 }
 
 bool Haptic_Driver::addSnippet(uint8_t ramp, uint8_t timeBase, uint8_t amplitude)
@@ -522,49 +557,74 @@ bool Haptic_Driver::addSnippet(uint8_t ramp, uint8_t timeBase, uint8_t amplitude
     if (timeBase < 0 | timeBase > 7)
         return false;
 
-    setOperationMode(INACTIVE);
+    uint8_t pwlVal = (ramp << 7) | (timeBase << 4) | (amplitude << 0);
+    return addSnippet(&pwlVal, 1);
+}
 
-    if ((_readRegister(MEM_CTL2) >> 7) == LOCKED)
-        _writeRegister(MEM_CTL2, 0x7F, UNLOCKED, 7);
+// Appends numOfSnippets one byte snippets (PWL bytes) and one sequence per
+// snippet that plays it once, keeping the IDs already in use, and writes
+// them with the new header, in as few writes as the Wire buffer allows.
+bool Haptic_Driver::addSnippet(uint8_t snippets[], uint8_t numOfSnippets)
+{
 
-    uint8_t pwlVal = (ramp << 7) | (timeBase << 4) | (amplitude << 0);
-    uint8_t snipAddrLoc = _readRegister(MEM_CTL1);
+    uint8_t numSnippets = snpMemCopy[NUM_SNIPPETS];
+    uint8_t numSequences = snpMemCopy[NUM_SEQUENCES];
+    if (numSnippets + numOfSnippets > MAX_SNIPPETS || numSequences + numOfSnippets > MAX_SEQUENCES)
+        return false;
 
-    snpMemCopy[NUM_SNIPPETS] = snpMemCopy[NUM_SNIPPETS] + 1;   // Number of Snippets
-    snpMemCopy[NUM_SEQUENCES] = snpMemCopy[NUM_SEQUENCES] + 1; // Number of sequences
+    // Snippets end where the sequences begin, both right after the header when empty
+    uint8_t oldHeader = ENDPOINTERS + numSnippets + numSequences;
+    uint8_t snippetEnd = oldHeader;
+    uint8_t end = oldHeader;
+    uint8_t start;
+    if (numSnippets > 0 && !_imageRegion(snpMemCopy, numSnippets - 1, start, snippetEnd))
+        return false;
+    if (numSnippets + numSequences > 0 && !_imageRegion(snpMemCopy, numSnippets + numSequences - 1, start, end))
+        return false;
 
-    uint8_t frameByte = addFrame(0, 3, 1);
+    // Every snippet adds two end pointers, which move all data behind the header
+    uint8_t shift = 2 * numOfSnippets;
+    uint16_t used = end + shift + numOfSnippets;
+    for (uint8_t k = 0; k < numOfSnippets; k++)
+        used += (numSnippets + 1 + k < 8) ? 1 : 2;
+    if (used > TOTAL_MEM_REGISTERS)
+        return false;
 
-    for (uint8_t i = 0; i < snpMemCopy[NUM_SNIPPETS]; i++)
+    uint8_t image[TOTAL_MEM_REGISTERS] = {0};
+    image[NUM_SNIPPETS] = numSnippets + numOfSnippets;
+    image[NUM_SEQUENCES] = numSequences + numOfSnippets;
+
+    uint8_t pos = oldHeader + shift;
+    memcpy(&image[pos], &snpMemCopy[oldHeader], snippetEnd - oldHeader);
+    pos += snippetEnd - oldHeader;
+    for (uint8_t r = 0; r < numSnippets; r++)
+        image[SNP_ENDPOINTERS + r] = snpMemCopy[SNP_ENDPOINTERS + r] + shift;
+    for (uint8_t k = 0; k < numOfSnippets; k++)
     {
-        snpMemCopy[SNP_ENDPOINTERS + i] = SNP_ENDPOINTERS_REGS + i; // snippet endpointer
-        lastPosWritten = SNP_ENDPOINTERS + i;
+        image[pos] = snippets[k];
+        image[SNP_ENDPOINTERS + numSnippets + k] = NUM_SNIPPETS_REG + pos;
+        pos++;
     }
 
-    lastPosWritten = lastPosWritten + 1;
-
-    for (uint8_t i = 0; i < snpMemCopy[NUM_SEQUENCES]; i++)
+    uint8_t seqEnd = SNP_ENDPOINTERS + numSnippets + numOfSnippets;
+    memcpy(&image[pos], &snpMemCopy[snippetEnd], end - snippetEnd);
+    pos += end - snippetEnd;
+    for (uint8_t r = 0; r < numSequences; r++)
+        image[seqEnd + r] = snpMemCopy[SNP_ENDPOINTERS + numSnippets + r] + shift + numOfSnippets;
+    for (uint8_t k = 0; k < numOfSnippets; k++)
     {
-        snpMemCopy[lastPosWritten] = SNP_ENDPOINTERS_REGS + snpMemCopy[NUM_SNIPPETS] + i; // sequence endpointer
-        lastPosWritten = SNP_ENDPOINTERS + snpMemCopy[NUM_SNIPPETS] + i;
+        uint8_t id = numSnippets + 1 + k;
+        image[pos++] = addFrame(0, 3, id & 0x07);
+        if (id > 7)
+            image[pos++] = 0x80 | (id >> 3); // SNP_ID_H, one loop
+        image[seqEnd + numSequences + k] = NUM_SNIPPETS_REG + pos - 1;
     }
+    lastPosWritten = pos - 1;
 
-    lastPosWritten = lastPosWritten + 1;
-    snpMemCopy[lastPosWritten] = pwlVal; // Write snippet
-    lastPosWritten = lastPosWritten + 1;
-    snpMemCopy[lastPosWritten] = frameByte;
-
-    setSeqControl(1, 0);
-
-    if (_writeWaveFormMemory(snpMemCopy))
-        return true;
-    else
-        return false;
-}
-
-bool Haptic_Driver::addSnippet(uint8_t snippets[], uint8_t numOfSnippets)
-{
-    return true;
+    uint8_t ctl1;
+    _stageWaveFormMemory(image, pos);
+    bool ok = _unlockWaveFormMemory(ctl1) && _commitWaveFormMemory(pos);
+    return _restoreOperationMode(ctl1) && ok;
 }
 
 uint8_t Haptic_Driver::addFrame(uint8_t gain, uint8_t timeBase, uint8_t snipIdLow)
@@ -578,7 +638,7 @@ uint8_t Haptic_Driver::addFrame(uint8_t gain, uint8_t timeBase, uint8_t snipIdLo
 bool Haptic_Driver::playFromMemory(bool enable)
 {
 
-    if (_writeRegister(TOP_CTL1, 0xEF, enable, 4))
+    if (writeFields<SEQ_START>(enable))
         return true;
     else
         return false;
@@ -587,96 +647,230 @@ bool Haptic_Driver::playFromMemory(bool enable)
 void Haptic_Driver::eraseWaveformMemory(uint8_t mode)
 {
 
-    for (uint8_t i; i = BEGIN_SNP_MEM; i < TOTAL_MEM_REGISTERS)
+    const uint8_t empty[TOTAL_MEM_REGISTERS] = {0};
+    uint8_t ctl1;
+    _stageWaveFormMemory(empty, TOTAL_MEM_REGISTERS);
+    if (_unlockWaveFormMemory(ctl1))
+        _commitWaveFormMemory(TOTAL_MEM_REGISTERS);
+    _restoreOperationMode(ctl1);
+    _numResidents = 0;
+    memset(_gpiImage, 0, sizeof(_gpiImage));
+}
+
+// Address: 0x84 - 0xE7
+// Reads are split into READ_MAX_LEN bursts for the Wire buffer.
+bool Haptic_Driver::verifyWaveformMemory(uint8_t *mismatched)
+{
+
+    uint8_t numRegions = snpMemCopy[NUM_SNIPPETS] + snpMemCopy[NUM_SEQUENCES];
+    uint8_t used = ENDPOINTERS;
+    uint8_t start;
+    if (mismatched != nullptr)
+        *mismatched = 0;
+    if (numRegions > 0 && !_imageRegion(snpMemCopy, numRegions - 1, start, used))
+        return false;
+
+    uint8_t regs[1 + TOTAL_MEM_REGISTERS] = {NUM_SNIPPETS_REG};
+    if (!_readConsReg(regs, 1 + used))
+        return false;
+
+    if (_crc16(&regs[1], used) == _crc16(snpMemCopy, used))
     {
-        snpMemCopy[i] = 0;
+        // Holds the image, whatever was assumed since begin()
+        _markWaveFormDirty(BEGIN_SNP_MEM, used, false);
+        return true;
     }
-    _writeWaveFormMemory(snpMemCopy);
+
+    uint8_t count = 0;
+    for (uint8_t i = 0; i < used; i++)
+    {
+        bool differs = regs[1 + i] != snpMemCopy[i];
+        _markWaveFormDirty(i, 1, differs);
+        count += differs;
+    }
+    if (mismatched != nullptr)
+        *mismatched = count;
+
+    uint8_t ctl1;
+    bool ok = _unlockWaveFormMemory(ctl1) && _commitWaveFormMemory(used);
+    return _restoreOperationMode(ctl1) && ok;
+}
+
+int8_t Haptic_Driver::loadSequence(const uint8_t image[])
+{
+
+    for (uint8_t i = 0; i < _numResidents; i++)
+    {
+        if (_residents[i].image == image)
+        {
+            _cacheStats.hits++;
+            _residents[i].lastUse = ++_useClock;
+            return i;
+        }
+    }
+    _cacheStats.misses++;
+
+    // Nothing is evicted for an image that does not fit next to the ones
+    // mapped to a GPI
+    uint8_t merged[TOTAL_MEM_REGISTERS];
+    uint8_t used = 0;
+    residentSequence loaded = {image, ++_useClock};
+    residentSequence kept[NUM_GPI + 1];
+    uint8_t numKept = 0;
+    for (uint8_t i = 0; i < _numResidents; i++)
+    {
+        if (_isGpiImage(_residents[i].image))
+            kept[numKept++] = _residents[i];
+    }
+    kept[numKept++] = loaded;
+    if (!_buildCacheImage(kept, numKept, merged, used))
+        return -1;
+
+    // The residents keep their order so most of the image stays as it is.
+    // The new image is the most recently used and is never evicted.
+    if (_numResidents == MAX_SEQUENCES)
+        _evictLeastRecent();
+    _residents[_numResidents++] = loaded;
+    while (!_buildCacheImage(_residents, _numResidents, merged, used))
+        _evictLeastRecent();
+
+    uint8_t ctl1;
+    _stageWaveFormMemory(merged, used);
+    if (!_unlockWaveFormMemory(ctl1) || !_commitWaveFormMemory(used))
+    {
+        // Whatever the IC holds now, the next load writes all of it again
+        _markWaveFormDirty(BEGIN_SNP_MEM, used, true);
+        _numResidents = 0;
+        _dropGpiMappings();
+        _restoreOperationMode(ctl1);
+        return -1;
+    }
+    bool ok = _followGpiImages();
+    if (!ok)
+    {
+        // Not a hit next time, so the GPI inputs are written again. It is
+        // the last resident, nothing else is renumbered.
+        _numResidents--;
+    }
+    if (!_restoreOperationMode(ctl1) || !ok)
+        return -1;
+    return _numResidents - 1;
+}
+
+bool Haptic_Driver::playSequence(const uint8_t image[])
+{
+
+    int8_t sequenceID = loadSequence(image);
+    if (sequenceID < 0)
+        return false;
+
+    // SEQ_CTL2 is shadowed, playing the same sequence again skips the write
+    if (_cachedRegister(SEQ_CTL2) != sequenceID && !setSeqControl(0, sequenceID))
+        return false;
+
+    return writeFields<OPERATION_MODE, SEQ_START>(RTWM_MODE, true);
+}
+
+hapticCacheStats Haptic_Driver::getCacheStats()
+{
+    return _cacheStats;
+}
+
+void Haptic_Driver::resetCacheStats()
+{
+    _cacheStats = hapticCacheStats{};
+}
+
+// Address: 0x29 - 0x2B, bits[6:0]
+// Maps sequenceID to input gpi: the edge that starts it in ETWM mode
+// (GPI_RISING_EDGE, GPI_FALLING_EDGE or GPI_BOTH_EDGES) and
+// GPI_SINGLE_PATTERN or GPI_MULTI_PATTERN.
+bool Haptic_Driver::mapGpiSequence(uint8_t gpi, uint8_t sequenceID, uint8_t polarity, uint8_t mode)
+{
+
+    if (gpi >= NUM_GPI || sequenceID > 15 || polarity > GPI_BOTH_EDGES || mode > GPI_MULTI_PATTERN)
+        return false;
+
+    _gpiImage[gpi] = nullptr;
+    return _writeGpiControl(gpi, sequenceID, polarity, mode);
+}
+
+bool Haptic_Driver::mapGpiImage(uint8_t gpi, const uint8_t image[], uint8_t polarity)
+{
+
+    if (gpi >= NUM_GPI || polarity > GPI_BOTH_EDGES)
+        return false;
+
+    // The image mapped so far may be evicted to make room
+    const uint8_t *previous = _gpiImage[gpi];
+    _gpiImage[gpi] = nullptr;
+    int8_t sequenceID = loadSequence(image);
+    if (sequenceID < 0)
+    {
+        _gpiImage[gpi] = previous;
+        return false;
+    }
+
+    _gpiImage[gpi] = image;
+    return _writeGpiControl(gpi, sequenceID, polarity, GPI_SINGLE_PATTERN);
+}
+
+// Address: 0x03 - 0x06, and 0x81 - 0x82 when E_ACTUATOR_FAULT is set
+// Reads the event, diagnostic and status registers in one transaction so
+// every pending interrupt can be handled from a single read.
+bool Haptic_Driver::getIrqSnapshot(irqSnapshot &snapshot)
+{
+
+    // IRQ_EVENT1, IRQ_EVENT_WARN_DIAG, IRQ_EVENT_SEQ_DIAG and IRQ_STATUS1
+    uint8_t regs[5] = {IRQ_EVENT1};
+
+    snapshot = irqSnapshot{};
+    if (!_readConsReg(regs, sizeof(regs)))
+        return false;
+
+    snapshot.events = regs[1];
+    snapshot.warnDiag = regs[2];
+    snapshot.seqDiag = regs[3];
+    snapshot.status = regs[4];
+
+    if (snapshot.events & E_ACTUATOR_FAULT)
+    {
+        uint8_t faultRegs[3] = {IRQ_EVENT_ACTUATOR_FAULT};
+        if (!_readConsReg(faultRegs, sizeof(faultRegs)))
+            return false;
+
+        snapshot.actuatorFault = faultRegs[1];
+        snapshot.status2 = faultRegs[2];
+    }
+    return true;
 }
 
 // Address: 0x03, bit[7:0]
-// This retrieves the interrupt value and returns the corresponding interrupt
-// found or success otherwise.
+// This retrieves the interrupt value and returns every interrupt found, more
+// than one bit may be set, or success otherwise.
 event_t Haptic_Driver::getIrqEvent()
 {
 
-    uint8_t irqEvent = _readRegister(IRQ_EVENT1);
-
-    if (!irqEvent)
-        return HAPTIC_SUCCESS;
-
-    switch (irqEvent)
-    {
-    case E_SEQ_CONTINUE:
-        return E_SEQ_CONTINUE;
-    case E_UVLO:
-        return E_UVLO;
-    case E_SEQ_DONE:
-        return E_SEQ_DONE;
-    case E_OVERTEMP_CRIT:
-        return E_OVERTEMP_CRIT;
-    case E_SEQ_FAULT:
-        return E_SEQ_FAULT;
-    case E_WARNING:
-        return E_WARNING;
-    case E_ACTUATOR_FAULT:
-        return E_ACTUATOR_FAULT;
-    case E_OC_FAULT:
-        return E_OC_FAULT;
-    default:
-        return static_cast<event_t>(irqEvent); // In the case that there are more than one.
-    }
+    return static_cast<event_t>(_readRegister(IRQ_EVENT1));
 }
 
 // Address: 0x05 , bit[7:5]
 // Given an interrupt corresponding to an error with using memory or pwm mode,
-// this returns further information on the error.
+// this returns further information on the error. With several diagnostics
+// pending the most significant one is returned.
 diag_status_t Haptic_Driver::getEventDiag()
 {
 
-    uint8_t diag = _readRegister(IRQ_EVENT_SEQ_DIAG);
-
-    switch (diag)
-    {
-    case E_PWM_FAULT:
-        return E_PWM_FAULT;
-    case E_MEM_FAULT:
-        return E_MEM_FAULT;
-    case E_SEQ_ID_FAULT:
-        return E_SEQ_ID_FAULT;
-    default:
-        return NO_DIAG;
-    }
+    return static_cast<diag_status_t>(_highestBit(_readRegister(IRQ_EVENT_SEQ_DIAG) & 0xE0));
 }
 
 // Address: 0x06 , bit[7:0]
-// Retu
+// Returns the interrupt status. With several status bits set the most
+// significant one is returned.
 status_t Haptic_Driver::getIrqStatus()
 {
 
-    uint8_t status = _readRegister(IRQ_STATUS1);
-
-    switch (status)
-    {
-    case STA_SEQ_CONTINUE:
-        return STA_SEQ_CONTINUE;
-    case STA_UVLO_VBAT_OK:
-        return STA_UVLO_VBAT_OK;
-    case STA_PAT_DONE:
-        return STA_PAT_DONE;
-    case STA_OVERTEMP_CRIT:
-        return STA_OVERTEMP_CRIT;
-    case STA_PAT_FAULT:
-        return STA_PAT_FAULT;
-    case STA_WARNING:
-        return STA_WARNING;
-    case STA_ACTUATOR:
-        return STA_ACTUATOR;
-    case STA_OC:
-        return STA_OC;
-    default:
-        return STATUS_NOM;
-    }
+    return static_cast<status_t>(_highestBit(_readRegister(IRQ_STATUS1)));
 }
 
 bool Haptic_Driver::setSeqControl(uint8_t repetitions, uint8_t sequenceID)
@@ -688,68 +882,302 @@ bool Haptic_Driver::setSeqControl(uint8_t repetitions, uint8_t sequenceID)
     if (repetitions < 0 | repetitions > 15)
         return false;
 
-    if (_writeRegister(SEQ_CTL2, 0xF0, sequenceID, 0) && _writeRegister(SEQ_CTL2, 0x0F, repetitions, 4))
-        return true;
-    else
-        return false;
+    return writeFields<PS_SEQ_ID, PS_SEQ_LOOP>(sequenceID, repetitions);
 }
 
 // This generic function handles I2C write commands for modifying individual
 // bits in an eight bit register. Paramaters include the register's address, a mask
 // for bits that are ignored, the bits to write, and the bits' starting
 // position.
+// The current value is taken from the register shadow when possible, a mask of
+// 0x00 replaces the whole register and needs no read at all.
 bool Haptic_Driver::_writeRegister(uint8_t _wReg, uint8_t _mask, uint8_t _bits, uint8_t _startPosition)
 {
 
-    uint8_t _i2cWrite;
-    _i2cWrite = _readRegister(_wReg);       // Get the current value of the register
-    _i2cWrite &= (_mask);                   // Mask the position we want to write to.
-    _i2cWrite |= (_bits << _startPosition); // Write the given bits to the variable
+    uint8_t _i2cWrite = 0;
+    if (_mask != 0x00)
+        _i2cWrite = _cachedRegister(_wReg) & _mask; // Current value, with the position we want to write masked.
+    _i2cWrite |= (_bits << _startPosition);         // Write the given bits to the variable
+
+    if (_burst.open && _wReg >= _burst.firstReg && _wReg < _burst.firstReg + _burst.numRegs)
+    {
+        _burst.values[_wReg - _burst.firstReg] = _i2cWrite; // Staged, written by _commitBurst()
+        _burst.dirty |= (1u << (_wReg - _burst.firstReg));
+        return true;
+    }
+
     _i2cPort->beginTransmission(_address);  // Start communication.
     _i2cPort->write(_wReg);                 // at register....
     _i2cPort->write(_i2cWrite);             // Write register...
 
-    if (!_i2cPort->endTransmission()) // End communcation.
-        return true;
-    else
+    if (_i2cPort->endTransmission()) // End communcation.
         return false;
+
+    if (!_isVolatileRegister(_wReg))
+    {
+        _regShadow[_wReg] = _i2cWrite;
+        _regShadowValid[_wReg] = true;
+    }
+    return true;
+}
+
+// Interrupt events and status, the calibrated impedance, ADC readings, the
+// tracked LRA period and phase all change without a write from us. TOP_CTL1
+// is included as SEQ_START self-clears and faults drop the operation mode.
+bool Haptic_Driver::_isVolatileRegister(uint8_t _reg)
+{
+
+    switch (_reg)
+    {
+    case IRQ_EVENT1:
+    case IRQ_EVENT_WARN_DIAG:
+    case IRQ_EVENT_SEQ_DIAG:
+    case IRQ_STATUS1:
+    case CALIB_IMP_H:
+    case CALIB_IMP_L:
+    case TOP_CTL1:
+    case ADC_DATA_H1:
+    case ADC_DATA_L1:
+    case LRA_AVR_H:
+    case LRA_AVR_L:
+    case FRQ_LRA_PER_ACT_H:
+    case FRQ_LRA_PER_ACT_L:
+    case FRQ_PHASE_H:
+    case FRQ_PHASE_L:
+    case IRQ_EVENT_ACTUATOR_FAULT:
+    case IRQ_STATUS2:
+        return true;
+    default:
+        return (_reg >= SNP_MEM_X);
+    }
+}
+
+// Returns the most significant set bit, or 0.
+uint8_t Haptic_Driver::_highestBit(uint8_t bits)
+{
+
+    uint8_t bit = 0x80;
+    while (bit && !(bits & bit))
+        bit >>= 1;
+
+    return bit;
+}
+
+// Address: 0x13, bit[2]
+// ACCELERATION_EN limits the vibration register to 0x7F.
+uint8_t Haptic_Driver::_amplitudeLimit()
+{
+
+    if (_maxAmplitude == 0)
+        _maxAmplitude = ((_cachedRegister(TOP_CFG1) >> 2) & 0x01) ? 0x7F : 0xFF;
+
+    return _maxAmplitude;
+}
+
+uint8_t Haptic_Driver::_cachedRegister(uint8_t _reg)
+{
+
+    if (_burst.open && _reg >= _burst.firstReg && _reg < _burst.firstReg + _burst.numRegs &&
+        (_burst.dirty & (1u << (_reg - _burst.firstReg))))
+        return _burst.values[_reg - _burst.firstReg];
+
+    if (!_isVolatileRegister(_reg) && _regShadowValid[_reg])
+        return _regShadow[_reg];
+
+    return _readRegister(_reg);
+}
+
+void Haptic_Driver::_beginBurst(uint8_t firstReg, uint8_t lastReg)
+{
+
+    _burst.open = true;
+    _burst.firstReg = firstReg;
+    _burst.numRegs = lastReg - firstReg + 1;
+    _burst.dirty = 0;
+}
+
+// Writes each run of consecutive staged registers as one transaction. Single
+// registers go through _writeRegister() so no write mode change is needed.
+bool Haptic_Driver::_commitBurst()
+{
+
+    bool ok = true;
+    uint8_t buf[1 + BURST_MAX_REGS];
+
+    _burst.open = false;
+
+    for (uint8_t i = 0; i < _burst.numRegs;)
+    {
+        if (!(_burst.dirty & (1u << i)))
+        {
+            i++;
+            continue;
+        }
+
+        size_t len = 0;
+        buf[len++] = _burst.firstReg + i;
+        while (i < _burst.numRegs && (_burst.dirty & (1u << i)))
+            buf[len++] = _burst.values[i++];
+
+        if (len == 2)
+            ok = _writeRegister(buf[0], 0x00, buf[1], 0) && ok;
+        else
+            ok = _writeConsReg(buf, len) && ok;
+    }
+
+    _burst.dirty = 0;
+    return ok;
+}
+
+// Address: 0x08, bit[7]
+// I2C_WR_MODE is only written when it differs from the shadowed value.
+bool Haptic_Driver::_setWriteMode(uint8_t mode)
+{
+
+    if (_regShadowValid[CIF_I2C1] && ((_regShadow[CIF_I2C1] >> 7) & 0x01) == mode)
+        return true;
+
+    return writeFields<I2C_WR_MODE>(mode);
+}
+
+// Reads every configuration register once so later read-modify-write updates
+// can be served from the shadow copy.
+void Haptic_Driver::_loadRegisterShadow()
+{
+
+    static const uint8_t cachedRegs[] = {
+        IRQ_MASK1,      CIF_I2C1,       FRQ_LRA_PER_H,  FRQ_LRA_PER_L,  ACTUATOR1, ACTUATOR2, ACTUATOR3,
+        CALIB_V2I_H,    CALIB_V2I_L,    TOP_CFG1,       TOP_CFG2,       TOP_CFG3,  TOP_CFG4,  TOP_INT_CFG1,
+        TOP_INT_CFG6_H, TOP_INT_CFG6_L, TOP_INT_CFG7_H, TOP_INT_CFG7_L, TOP_INT_CFG8, TOP_CTL2, SEQ_CTL1,
+        SWG_C1,         SWG_C2,         SWG_C3,         SEQ_CTL2,       GPI_0_CTL, GPI_1_CTL, GPI_2_CTL,
+        MEM_CTL1,       MEM_CTL2,       POLARITY,       FRQ_CTL,        TRIM3,     TRIM4,     TRIM6,
+        TOP_CFG5,       IRQ_MASK2};
+
+    uint8_t pairs[2 * sizeof(cachedRegs)];
+    for (size_t i = 0; i < sizeof(cachedRegs); i++)
+        pairs[2 * i] = cachedRegs[i];
+
+    // Registers left out of the shadow are read from the IC when needed
+    if (!_readNonConsReg(pairs, sizeof(pairs)))
+        return;
+
+    for (size_t i = 0; i < sizeof(cachedRegs); i++)
+    {
+        _regShadow[cachedRegs[i]] = pairs[2 * i + 1];
+        _regShadowValid[cachedRegs[i]] = true;
+    }
 }
 
 // This generic function reads an eight bit register. It takes the register's
-// address as its' parameter.
+// address as its' parameter. Returns 0 if the read fails, use _readConsReg()
+// where the caller needs to know.
 uint8_t Haptic_Driver::_readRegister(uint8_t _reg)
 {
 
-    _i2cPort->beginTransmission(_address);
-    _i2cPort->write(_reg);            // Moves pointer to register.
-    _i2cPort->endTransmission(false); // 'False' here sends a re-"start" message so that bus is not released
-    _i2cPort->requestFrom(static_cast<uint8_t>(_address),
-                          static_cast<uint8_t>(1)); // Read the register, only ever once.
-    uint8_t _regValue = _i2cPort->read();
-    return _regValue;
+    uint8_t regs[2] = {_reg, 0};
+    if (!_readConsReg(regs, sizeof(regs)))
+        return 0;
+
+    return regs[1];
+}
+
+// Moves the register pointer with a repeated start and reads the registers
+// that follow it, in pieces no larger than the Wire buffer.
+bool Haptic_Driver::_readConsReg(uint8_t regs[], size_t numReads)
+{
+
+    uint8_t reg = regs[0];
+    size_t pos = 1;
+
+    while (pos < numReads)
+    {
+        size_t len = numReads - pos;
+        if (len > READ_MAX_LEN)
+            len = READ_MAX_LEN;
+
+        _i2cPort->beginTransmission(_address);
+        _i2cPort->write(reg);
+        if (_i2cPort->endTransmission(false))
+            return false;
+
+        if (_i2cPort->requestFrom(static_cast<uint8_t>(_address), static_cast<uint8_t>(len)) != len)
+            return false;
+
+        for (size_t i = 0; i < len; i++)
+            regs[pos++] = _i2cPort->read();
+
+        reg += len;
+    }
+    return true;
+}
+
+// Registers at most READ_GAP_MAX apart are read as one block, the registers in
+// between cost one byte each on the bus where a new read would cost three.
+bool Haptic_Driver::_readNonConsReg(uint8_t regs[], size_t numReads)
+{
+
+    uint8_t block[1 + READ_MAX_LEN];
+    size_t i = 0;
+
+    while (i + 1 < numReads)
+    {
+        uint8_t firstReg = regs[i];
+        size_t end = i + 2;
+
+        while (end + 1 < numReads && regs[end] > regs[end - 2] && regs[end] - regs[end - 2] <= READ_GAP_MAX + 1 &&
+               regs[end] - firstReg < READ_MAX_LEN)
+            end += 2;
+
+        block[0] = firstReg;
+        if (!_readConsReg(block, 2 + regs[end - 2] - firstReg))
+            return false;
+
+        for (; i < end; i += 2)
+            regs[i + 1] = block[1 + regs[i] - firstReg];
+    }
+    return true;
 }
 
 // Consecutive Write Mode: I2C_WR_MODE = 0
 // Allows for n-number of writes on consecutive registers, beginning at the
 // given register.
 // This particular write does not care what is currently in the register and
-// overwrites whatever is there.
+// overwrites whatever is there. Longer writes are split into WRITE_MAX_LEN
+// pieces, the Wire buffer drops what does not fit without an error; the
+// shadow only takes the pieces that were acknowledged.
 bool Haptic_Driver::_writeConsReg(uint8_t regs[], size_t numWrites)
 {
 
-    _writeRegister(CIF_I2C1, 0x7F, 0, 7);
+    if (!_setWriteMode(0))
+        return false;
 
-    _i2cPort->beginTransmission(_address);
+    uint8_t reg = regs[0];
+    size_t pos = 1;
 
-    for (size_t i = 0; i <= numWrites; i++)
+    while (pos < numWrites)
     {
-        _i2cPort->write(regs[i]);
+        size_t len = numWrites - pos;
+        if (len > WRITE_MAX_LEN)
+            len = WRITE_MAX_LEN;
+
+        _i2cPort->beginTransmission(_address);
+        _i2cPort->write(reg);
+        for (size_t i = 0; i < len; i++)
+            _i2cPort->write(regs[pos + i]);
+
+        if (_i2cPort->endTransmission())
+            return false;
+
+        for (size_t i = 0; i < len; i++, pos++, reg++)
+        {
+            if (!_isVolatileRegister(reg))
+            {
+                _regShadow[reg] = regs[pos];
+                _regShadowValid[reg] = true;
+            }
+        }
     }
-
-    if (!_i2cPort->endTransmission())
-        return true;
-    else
-        return false;
+    return true;
 }
 
 // Non-Consecutive Write Mode: I2C_WR_MODE = 1
@@ -760,34 +1188,355 @@ bool Haptic_Driver::_writeConsReg(uint8_t regs[], size_t numWrites)
 bool Haptic_Driver::_writeNonConsReg(uint8_t regs[], size_t numWrites)
 {
 
-    _writeRegister(CIF_I2C1, 0x7F, 1, 7);
+    if (!_setWriteMode(1))
+        return false;
 
     _i2cPort->beginTransmission(_address); // Start communication.
-    for (size_t i = 0; i <= numWrites; i++)
+    for (size_t i = 0; i < numWrites; i++)
     {
         // Here's to hoping that the register pointer will indeed jump locations as
         // advertised.
         _i2cPort->write(regs[i]);
     }
 
-    if (!_i2cPort->endTransmission())
-        return true;
-    else
+    if (_i2cPort->endTransmission())
         return false;
+
+    for (size_t i = 0; i + 1 < numWrites; i += 2)
+    {
+        if (!_isVolatileRegister(regs[i]))
+        {
+            _regShadow[regs[i]] = regs[i + 1];
+            _regShadowValid[regs[i]] = true;
+        }
+    }
+    return true;
 }
 
-bool Haptic_Driver::_writeWaveFormMemory(uint8_t waveFormArray[])
+bool Haptic_Driver::_writeWaveFormMemory(const uint8_t waveFormArray[], uint8_t first, uint8_t len)
 {
 
-    _i2cPort->beginTransmission(_address); // Start communication.
-    _i2cPort->write(NUM_SNIPPETS_REG);     // Moves pointer to register.
-    for (size_t i = BEGIN_SNP_MEM; i < TOTAL_MEM_REGISTERS; i++)
+    uint8_t buf[1 + TOTAL_MEM_REGISTERS];
+    if (first + len > TOTAL_MEM_REGISTERS)
+        return false;
+
+    buf[0] = NUM_SNIPPETS_REG + first;
+    memcpy(&buf[1], &waveFormArray[first], len);
+    return _writeConsReg(buf, 1 + len);
+}
+
+// The memory only takes writes while inactive and unlocked. TOP_CTL1 is read
+// once, for the value to restore and the write.
+bool Haptic_Driver::_unlockWaveFormMemory(uint8_t &ctl1)
+{
+
+    uint8_t regs[2] = {TOP_CTL1, 0};
+    ctl1 = 0;
+    if (!_readConsReg(regs, sizeof(regs)))
+        return false;
+
+    ctl1 = regs[1] & (uint8_t)~SEQ_START::mask;
+    if (!_writeRegister(TOP_CTL1, 0x00, ctl1 & (uint8_t)~OPERATION_MODE::mask, 0))
+        return false;
+
+    return (_cachedRegister(MEM_CTL2) >> 7) == UNLOCKED || writeFields<WAV_MEM_LOCK>(UNLOCKED);
+}
+
+bool Haptic_Driver::_restoreOperationMode(uint8_t ctl1)
+{
+
+    return !(ctl1 & OPERATION_MODE::mask) || _writeRegister(TOP_CTL1, 0x00, ctl1, 0);
+}
+
+void Haptic_Driver::_stageWaveFormMemory(const uint8_t image[], uint8_t len)
+{
+
+    for (uint8_t i = 0; i < len && i < TOTAL_MEM_REGISTERS; i++)
     {
-        _i2cPort->write(waveFormArray[i]);
+        if (image[i] != snpMemCopy[i])
+        {
+            snpMemCopy[i] = image[i];
+            _markWaveFormDirty(i, 1, true);
+        }
     }
+}
 
-    if (!_i2cPort->endTransmission())
+bool Haptic_Driver::_commitWaveFormMemory(uint8_t used)
+{
+
+    uint8_t headerLen = ENDPOINTERS + snpMemCopy[NUM_SNIPPETS] + snpMemCopy[NUM_SEQUENCES];
+    if (used > TOTAL_MEM_REGISTERS || headerLen > used)
+        return false;
+
+    uint8_t headerFirst = BEGIN_SNP_MEM;
+    uint8_t headerLast = headerLen;
+    while (headerFirst < headerLast && !_isWaveFormDirty(headerFirst))
+        headerFirst++;
+    while (headerLast > headerFirst && !_isWaveFormDirty(headerLast - 1))
+        headerLast--;
+
+    uint8_t pos = headerLen;
+    while (pos < used)
+    {
+        if (!_isWaveFormDirty(pos))
+        {
+            pos++;
+            continue;
+        }
+
+        uint8_t first = pos;
+        uint8_t last = pos + 1;
+        for (pos = last; pos < used && pos - last <= MEM_WRITE_GAP_MAX; pos++)
+        {
+            if (_isWaveFormDirty(pos))
+                last = pos + 1;
+        }
+        pos = last;
+
+        // Data right behind the header goes out with it
+        if (headerFirst < headerLast && first - headerLast <= MEM_WRITE_GAP_MAX)
+        {
+            headerLast = last;
+            continue;
+        }
+        if (!_writeWaveFormRun(first, last - first))
+            return false;
+    }
+
+    // Counts and end pointers after the data they describe
+    if (headerFirst == headerLast)
         return true;
-    else
+
+    return _writeWaveFormRun(headerFirst, headerLast - headerFirst);
+}
+
+// Writes a run of snpMemCopy in pieces that fit the Wire buffer, last piece
+// first so a header split over several writes gets its counts last, and
+// cleans each piece once it was acknowledged.
+bool Haptic_Driver::_writeWaveFormRun(uint8_t first, uint8_t len)
+{
+
+    while (len > 0)
+    {
+        uint8_t piece = (len > WRITE_MAX_LEN) ? WRITE_MAX_LEN : len;
+        len -= piece;
+        if (!_writeWaveFormMemory(snpMemCopy, first + len, piece))
+            return false;
+
+        _markWaveFormDirty(first + len, piece, false);
+    }
+    return true;
+}
+
+bool Haptic_Driver::_isWaveFormDirty(uint8_t pos)
+{
+    return (_snpMemDirty[pos / 8] >> (pos % 8)) & 0x01;
+}
+
+void Haptic_Driver::_markWaveFormDirty(uint8_t first, uint8_t len, bool dirty)
+{
+
+    for (uint8_t i = first; i < first + len; i++)
+    {
+        if (dirty)
+            _snpMemDirty[i / 8] |= (1 << (i % 8));
+        else
+            _snpMemDirty[i / 8] &= ~(1 << (i % 8));
+    }
+}
+
+bool Haptic_Driver::_imageRegion(const uint8_t image[], uint8_t region, uint8_t &start, uint8_t &end)
+{
+
+    uint8_t numSnippets = image[NUM_SNIPPETS];
+    uint8_t numSequences = image[NUM_SEQUENCES];
+    if (numSnippets > MAX_SNIPPETS || numSequences > MAX_SEQUENCES || region >= numSnippets + numSequences)
         return false;
+
+    // Regions start right after the previous one, the first after the end pointers
+    start = ENDPOINTERS + numSnippets + numSequences;
+    for (uint8_t r = 0; r <= region; r++)
+    {
+        uint8_t endPointer = image[ENDPOINTERS + r];
+        if (endPointer < NUM_SNIPPETS_REG + start || endPointer > END_OF_MEM)
+            return false;
+
+        end = endPointer - NUM_SNIPPETS_REG + 1;
+        if (r < region)
+            start = end;
+    }
+    return true;
+}
+
+bool Haptic_Driver::_buildCacheImage(const residentSequence residents[], uint8_t count, uint8_t image[], uint8_t &used)
+{
+
+    uint8_t numSnippets = 0;
+    for (uint8_t i = 0; i < count; i++)
+        numSnippets += residents[i].image[NUM_SNIPPETS];
+    if (numSnippets > MAX_SNIPPETS)
+        return false;
+
+    memset(image, 0, TOTAL_MEM_REGISTERS);
+    image[NUM_SNIPPETS] = numSnippets;
+    image[NUM_SEQUENCES] = count;
+    uint8_t pos = ENDPOINTERS + numSnippets + count;
+    uint8_t start;
+    uint8_t end;
+
+    uint8_t snippet = 0;
+    for (uint8_t i = 0; i < count; i++)
+    {
+        const uint8_t *src = residents[i].image;
+        for (uint8_t k = 0; k < src[NUM_SNIPPETS]; k++)
+        {
+            if (!_imageRegion(src, k, start, end) || pos + (end - start) > TOTAL_MEM_REGISTERS)
+                return false;
+
+            memcpy(&image[pos], &src[start], end - start);
+            pos += end - start;
+            image[ENDPOINTERS + snippet++] = NUM_SNIPPETS_REG + pos - 1;
+        }
+    }
+
+    // Snippet 0 is the built-in silence and keeps its ID
+    uint8_t idOffset = 0;
+    for (uint8_t i = 0; i < count; i++)
+    {
+        const uint8_t *src = residents[i].image;
+        if (!_imageRegion(src, src[NUM_SNIPPETS], start, end))
+            return false;
+
+        for (uint8_t p = start; p < end; p++)
+        {
+            // Byte 1 of a frame has COMMAND_TYPE = 0, the optional byte 2
+            // COMMAND_TYPE = 1 and SNP_ID_H, byte 3 follows with FREQ_CMD
+            uint8_t frame = src[p];
+            bool hasByte2 = (p + 1 < end) && (src[p + 1] & 0x80);
+            if (frame & 0x80)
+                return false;
+
+            uint8_t id = (frame & 0x07) | (hasByte2 ? (src[p + 1] & 0x01) << 3 : 0);
+            if (id > 0)
+                id += idOffset;
+
+            bool hasByte3 = hasByte2 && (src[p + 1] & 0x04);
+            uint8_t frameLen = 1 + ((hasByte2 || id > 7) ? 1 : 0) + (hasByte3 ? 1 : 0);
+            if ((hasByte3 && p + 2 >= end) || pos + frameLen > TOTAL_MEM_REGISTERS)
+                return false;
+
+            image[pos++] = (frame & ~0x07) | (id & 0x07);
+            if (hasByte2)
+            {
+                uint8_t byte2 = src[++p];
+                image[pos++] = (byte2 & ~0x01) | (id >> 3);
+                if (hasByte3)
+                    image[pos++] = src[++p];
+            }
+            else if (id > 7)
+            {
+                // SNP_ID_H needs byte 2, one loop and no frequency change as without it
+                image[pos++] = 0x80 | (id >> 3);
+            }
+        }
+        image[ENDPOINTERS + numSnippets + i] = NUM_SNIPPETS_REG + pos - 1;
+        idOffset += src[NUM_SNIPPETS];
+    }
+
+    used = pos;
+    return true;
+}
+
+void Haptic_Driver::_evictLeastRecent()
+{
+
+    uint8_t lru = _numResidents;
+    for (uint8_t i = 0; i + 1 < _numResidents; i++)
+    {
+        if (!_isGpiImage(_residents[i].image) &&
+            (lru == _numResidents || _residents[i].lastUse < _residents[lru].lastUse))
+            lru = i;
+    }
+    if (lru == _numResidents)
+        return;
+    for (uint8_t i = lru; i + 1 < _numResidents; i++)
+        _residents[i] = _residents[i + 1];
+
+    _numResidents--;
+    _cacheStats.evictions++;
+}
+
+uint16_t Haptic_Driver::_crc16(const uint8_t bytes[], uint8_t len)
+{
+
+    uint16_t crc = 0xFFFF;
+    for (uint8_t i = 0; i < len; i++)
+    {
+        crc ^= (uint16_t)(bytes[i] << 8);
+        for (uint8_t bit = 0; bit < 8; bit++)
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+    }
+    return crc;
+}
+
+bool Haptic_Driver::_isGpiImage(const uint8_t image[])
+{
+
+    for (uint8_t gpi = 0; gpi < NUM_GPI; gpi++)
+    {
+        if (_gpiImage[gpi] == image)
+            return true;
+    }
+    return false;
+}
+
+bool Haptic_Driver::_writeGpiControl(uint8_t gpi, uint8_t sequenceID, uint8_t polarity, uint8_t mode)
+{
+
+    uint8_t value = GPI_SEQUENCE_ID::bits(sequenceID) | GPI_MODE::bits(mode) | GPI_POLARITY::bits(polarity);
+    if (_cachedRegister(GPI_0_CTL + gpi) == value)
+        return true;
+
+    return _writeRegister(GPI_0_CTL + gpi, 0x00, value, 0);
+}
+
+// An image that is no longer resident loses its mapping
+bool Haptic_Driver::_followGpiImages()
+{
+
+    bool ok = true;
+    for (uint8_t gpi = 0; gpi < NUM_GPI; gpi++)
+    {
+        if (_gpiImage[gpi] == nullptr)
+            continue;
+
+        uint8_t i = 0;
+        while (i < _numResidents && _residents[i].image != _gpiImage[gpi])
+            i++;
+        if (i == _numResidents)
+        {
+            _gpiImage[gpi] = nullptr;
+            ok = _writeGpiControl(gpi, 0, GPI_RISING_EDGE, GPI_SINGLE_PATTERN) && ok;
+            continue;
+        }
+
+        uint8_t ctl = _cachedRegister(GPI_0_CTL + gpi);
+        ok = _writeGpiControl(gpi, i, ctl & GPI_POLARITY::mask, GPI_SINGLE_PATTERN) && ok;
+    }
+    return ok;
+}
+
+bool Haptic_Driver::_dropGpiMappings()
+{
+
+    bool ok = true;
+    memset(_gpiImage, 0, sizeof(_gpiImage));
+    for (uint8_t gpi = 0; gpi < NUM_GPI; gpi++)
+        ok = _writeGpiControl(gpi, 0, GPI_RISING_EDGE, GPI_SINGLE_PATTERN) && ok;
+    return ok;
+}
+
+bool Haptic_Driver::_writeWaveFormMemory(uint8_t waveFormArray[])
+{
+    return _writeWaveFormMemory(waveFormArray, BEGIN_SNP_MEM, TOTAL_MEM_REGISTERS);
 }
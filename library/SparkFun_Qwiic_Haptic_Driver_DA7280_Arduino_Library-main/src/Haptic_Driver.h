@@ -14,6 +14,14 @@
 #define ERM_TYPE 0x01
 #define RAMP 0x01
 #define STEP 0x00
+#define BURST_MAX_REGS 16
+#define READ_MAX_LEN 32 // Wire buffer on the smaller AVR boards
+#define WRITE_MAX_LEN (READ_MAX_LEN - 1) // Data bytes behind the register byte in one write
+#define READ_GAP_MAX 3  // Unwanted registers a burst read may span instead of starting a new one
+#define MEM_WRITE_GAP_MAX 2 // Unchanged bytes a waveform memory write may span instead of starting a new one
+#define MAX_SNIPPETS 15
+#define MAX_SEQUENCES 16
+#define NUM_GPI 3
 
 struct hapticSettings
 {
@@ -67,6 +75,26 @@ typedef enum
 
 } status_t;
 
+// Interrupt registers as read by getIrqSnapshot(). The fields hold every
+// pending bit, so several events can be handled from one read.
+struct irqSnapshot
+{
+    uint8_t events;        // IRQ_EVENT1, event_t bits
+    uint8_t warnDiag;      // IRQ_EVENT_WARN_DIAG
+    uint8_t seqDiag;       // IRQ_EVENT_SEQ_DIAG, diag_status_t bits
+    uint8_t status;        // IRQ_STATUS1, status_t bits
+    uint8_t actuatorFault; // IRQ_EVENT_ACTUATOR_FAULT, only read with E_ACTUATOR_FAULT
+    uint8_t status2;       // IRQ_STATUS2, only read with E_ACTUATOR_FAULT
+};
+
+// Waveform memory as a cache of sequences, counted by loadSequence()
+struct hapticCacheStats
+{
+    uint32_t hits;      // image was resident
+    uint32_t misses;    // memory was rewritten to make it resident
+    uint32_t evictions; // resident images dropped to make room
+};
+
 enum OPERATION_MODES
 {
 
@@ -77,6 +105,22 @@ enum OPERATION_MODES
     ETWM_MODE
 };
 
+// GPI_0_CTL..GPI_2_CTL, edge that starts the mapped sequence in ETWM mode
+enum GPI_POLARITIES
+{
+
+    GPI_RISING_EDGE = 0x00,
+    GPI_FALLING_EDGE,
+    GPI_BOTH_EDGES
+};
+
+enum GPI_MODES
+{
+
+    GPI_SINGLE_PATTERN = 0x00,
+    GPI_MULTI_PATTERN
+};
+
 enum SNPMEM_ARRAY_POS
 {
 
@@ -160,6 +204,68 @@ enum REGISTERS
     SNP_MEM_X
 };
 
+// Bit field of a register: address, position of the lowest bit and width.
+// The mask is computed at compile time, so it is never written out by hand.
+template <uint8_t Reg, uint8_t Shift, uint8_t Width = 1> struct hapticField
+{
+    static_assert(Shift + Width <= 8, "Field does not fit in an eight bit register");
+
+    static constexpr uint8_t reg = Reg;
+    static constexpr uint8_t mask = ((1u << Width) - 1u) << Shift;
+
+    // Values wider than the field are cut to its width instead of spilling
+    // into the neighbouring bits.
+    static constexpr uint8_t bits(uint8_t value)
+    {
+        return (uint8_t)(value << Shift) & mask;
+    }
+};
+
+// Combined mask of several fields, and whether they share one register
+// without overlapping.
+template <typename... Fields> struct hapticFieldSet;
+
+template <typename Field> struct hapticFieldSet<Field>
+{
+    static constexpr uint8_t reg = Field::reg;
+    static constexpr uint8_t mask = Field::mask;
+    static constexpr bool sameRegister = true;
+    static constexpr bool disjoint = true;
+};
+
+template <typename Field, typename... Rest> struct hapticFieldSet<Field, Rest...>
+{
+    static constexpr uint8_t reg = Field::reg;
+    static constexpr uint8_t mask = Field::mask | hapticFieldSet<Rest...>::mask;
+    static constexpr bool sameRegister =
+        (Field::reg == hapticFieldSet<Rest...>::reg) && hapticFieldSet<Rest...>::sameRegister;
+    static constexpr bool disjoint =
+        ((Field::mask & hapticFieldSet<Rest...>::mask) == 0) && hapticFieldSet<Rest...>::disjoint;
+};
+
+typedef hapticField<CIF_I2C1, 7> I2C_WR_MODE;
+typedef hapticField<FRQ_LRA_PER_L, 0, 7> LRA_PER_L;
+typedef hapticField<ACTUATOR3, 0, 5> IMAX;
+typedef hapticField<TOP_CFG1, 0> AMP_PID_EN;
+typedef hapticField<TOP_CFG1, 1> RAPID_STOP_EN;
+typedef hapticField<TOP_CFG1, 2> ACCELERATION_EN;
+typedef hapticField<TOP_CFG1, 3> FREQ_TRACK_EN;
+typedef hapticField<TOP_CFG1, 4> BEMF_SENSE_EN;
+typedef hapticField<TOP_CFG1, 5> ACTUATOR_TYPE;
+typedef hapticField<TOP_CFG2, 0, 4> FULL_BRAKE_THR;
+typedef hapticField<TOP_CFG4, 6> TST_CALIB_IMPEDANCE_DIS;
+typedef hapticField<TOP_CFG4, 7> V2I_FACTOR_FREEZE;
+typedef hapticField<TOP_INT_CFG1, 0, 2> BEMF_FAULT_LIM;
+typedef hapticField<TOP_CTL1, 0, 3> OPERATION_MODE;
+typedef hapticField<TOP_CTL1, 4> SEQ_START;
+typedef hapticField<SEQ_CTL2, 0, 4> PS_SEQ_ID;
+typedef hapticField<SEQ_CTL2, 4, 4> PS_SEQ_LOOP;
+typedef hapticField<MEM_CTL2, 7> WAV_MEM_LOCK;
+// GPI_1_CTL and GPI_2_CTL have the same layout
+typedef hapticField<GPI_0_CTL, 0, 2> GPI_POLARITY;
+typedef hapticField<GPI_0_CTL, 2> GPI_MODE;
+typedef hapticField<GPI_0_CTL, 3, 4> GPI_SEQUENCE_ID;
+
 class Haptic_Driver
 {
   public:
@@ -198,6 +304,7 @@ class Haptic_Driver
     bool enableV2iFactorFreeze(bool);
     bool calibrateImpedanceDistance(bool);
     bool setVibrate(uint8_t);
+    bool streamAmplitudes(const uint8_t levels[], size_t, uint16_t);
     uint8_t getVibrate();
     float getFullBrake();
     bool setMask(uint8_t);
@@ -207,9 +314,19 @@ class Haptic_Driver
     float getBemf();
     void createHeader(uint8_t, uint8_t);
     void clearIrq(uint8_t);
+    // Append step snippets to the waveform memory, each with a sequence that
+    // plays it once; IDs already in use are kept. The array version takes PWL
+    // bytes and writes the whole set at once. A loadSequence() that is not a
+    // hit rebuilds the memory from the loaded images only, without them.
     bool addSnippet(uint8_t ramp = RAMP, uint8_t amplitude = 2, uint8_t timeBase = 2);
     bool addSnippet(uint8_t snippets[], uint8_t);
     void eraseWaveformMemory(uint8_t);
+    // Reads the part of the waveform memory its end pointers reference back
+    // and compares its CRC with snpMemCopy. On a mismatch only the runs of
+    // bytes that differ are written again; mismatched receives their number.
+    // Cheaper than a full upload after a brown-out.
+    bool verifyWaveformMemory(uint8_t *mismatched = nullptr);
+    bool getIrqSnapshot(irqSnapshot &);
     event_t getIrqEvent();
     diag_status_t getEventDiag();
     status_t getIrqStatus();
@@ -217,12 +334,106 @@ class Haptic_Driver
     bool setSeqControl(uint8_t, uint8_t);
     uint8_t addFrame(uint8_t, uint8_t, uint8_t);
 
+    // Waveform memory as a cache of effects. image is a complete waveform
+    // memory image of one sequence (counts, end pointers from
+    // NUM_SNIPPETS_REG on, snippets and frames). loadSequence() makes it
+    // resident next to the images loaded before, dropping the least recently
+    // used ones when memory, snippets or sequences run out, and rewrites only
+    // the bytes that change. Images are told apart by address and have to
+    // stay valid while resident. Loading an image that is not resident drops
+    // the snippets and sequences added with addSnippet(). Returns the sequence
+    // ID, -1 if the image is malformed or the write fails.
+    int8_t loadSequence(const uint8_t image[]);
+    // Loads image if needed and plays it in RTWM mode.
+    bool playSequence(const uint8_t image[]);
+    hapticCacheStats getCacheStats();
+    void resetCacheStats();
+
+    // Edge-triggered waveform memory mode: with setOperationMode(ETWM_MODE)
+    // an edge on GPI0..GPI2 starts the sequence mapped to that input without
+    // any bus traffic. GPI0 is also the PWM input. Rewriting the waveform
+    // memory drops to INACTIVE; every call that does sets the mode it found
+    // again afterwards, ETWM_MODE as well as DRO_MODE, PWM_MODE or RTWM_MODE,
+    // also when the write fails.
+    // mapGpiImage() loads image like loadSequence() and keeps it resident
+    // while mapped; the input follows it if other loads renumber the
+    // sequences. A load whose upload fails drops every mapping and returns
+    // GPI_x_CTL to its reset value; map the inputs again after it.
+    bool mapGpiSequence(uint8_t gpi, uint8_t sequenceID, uint8_t polarity = GPI_RISING_EDGE,
+                        uint8_t mode = GPI_SINGLE_PATTERN);
+    bool mapGpiImage(uint8_t gpi, const uint8_t image[], uint8_t polarity = GPI_RISING_EDGE);
+
+    // Writes several fields of one register with a single read-modify-write,
+    // e.g. writeFields<FREQ_TRACK_EN, ACCELERATION_EN>(true, true). Fields of
+    // different registers or overlapping fields fail to compile.
+    template <typename... Fields, typename... Values> bool writeFields(Values... values)
+    {
+        typedef hapticFieldSet<Fields...> set;
+        static_assert(sizeof...(Fields) == sizeof...(Values), "One value is needed per field");
+        static_assert(set::sameRegister, "Fields must belong to the same register");
+        static_assert(set::disjoint, "Fields must not overlap");
+
+        const uint8_t bits[] = {Fields::bits(values)...};
+        uint8_t value = 0;
+        for (uint8_t b : bits)
+            value |= b;
+
+        // ACCELERATION_EN may have changed, resolved again from the shadow
+        if (set::reg == TOP_CFG1)
+            _maxAmplitude = 0;
+
+        return _writeRegister(set::reg, (uint8_t)~set::mask, value, 0);
+    }
+
     hapticSettings sparkSettings;
 
   private:
     // Private Variables
     uint8_t _address;
 
+    // Shadow copy of the configuration registers (0x00..0x83), filled in
+    // begin() and kept up to date by _writeRegister() so that read-modify-write
+    // updates don't need to read the register back over the bus.
+    uint8_t _regShadow[SNP_MEM_X]{};
+    bool _regShadowValid[SNP_MEM_X]{};
+
+    // Registers that the IC updates on its own (interrupt events, status, ADC
+    // and frequency tracking results). These are never served from the shadow.
+    bool _isVolatileRegister(uint8_t);
+
+    // Reads every cacheable register once into the shadow copy.
+    void _loadRegisterShadow();
+
+    // While a burst is open, _writeRegister() stages updates to registers in
+    // [firstReg, firstReg + numRegs) instead of writing them, and
+    // _commitBurst() writes every run of staged registers in one consecutive
+    // write. Used to configure the actuator with a single transaction.
+    struct regBurst
+    {
+        bool open;
+        uint8_t firstReg;
+        uint8_t numRegs;
+        uint16_t dirty;
+        uint8_t values[BURST_MAX_REGS];
+    };
+    regBurst _burst{};
+    void _beginBurst(uint8_t, uint8_t);
+    bool _commitBurst();
+
+    // Returns the staged, shadowed or (for volatile registers) current value
+    // of a register.
+    uint8_t _cachedRegister(uint8_t);
+
+    // Largest TOP_CTL2 value for the current ACCELERATION_EN setting, 0 until
+    // resolved from TOP_CFG1. Kept in sync by enableAcceleration().
+    uint8_t _maxAmplitude = 0;
+    uint8_t _amplitudeLimit();
+
+    uint8_t _highestBit(uint8_t);
+
+    // Sets I2C_WR_MODE in CIF_I2C1, only writing when the mode changes.
+    bool _setWriteMode(uint8_t);
+
     // This generic function handles I2C write commands for modifying individual
     // bits in an eight bit register. Paramaters include the register's address, a mask
     // for bits that are ignored, the bits to write, and the bits' starting
@@ -231,7 +442,8 @@ class Haptic_Driver
 
     // Consecutive Write Mode: I2C_WR_MODE = 0
     // Allows for n-number of writes on consecutive registers, beginning at the
-    // given register.
+    // given register. regs[0] is the register, followed by the values; the size
+    // is the total length of regs[].
     // This particular write does not care what is currently in the register and
     // overwrites whatever is there.
     bool _writeConsReg(uint8_t regs[], size_t);
@@ -239,6 +451,7 @@ class Haptic_Driver
     // Non-Consecutive Write Mode: I2C_WR_MODE = 1
     // Allows for n-number of writes on non-consecutive registers, beginning at the
     // given register but able to jump locations by giving another address.
+    // regs[] holds register/value pairs; the size is the total length of regs[].
     // This particular write does not care what is currently in the register and
     // overwrites whatever is there.
     bool _writeNonConsReg(uint8_t regs[], size_t);
@@ -248,13 +461,83 @@ class Haptic_Driver
     void _writeCommand(uint8_t);
 
     bool _writeWaveFormMemory(uint8_t waveFormArray[]);
+    bool _writeWaveFormMemory(const uint8_t waveFormArray[], uint8_t, uint8_t);
+
+    // One bit per byte of snpMemCopy that the waveform memory may not hold
+    // yet. All of them after begin(), a failed write leaves its bytes set.
+    uint8_t _snpMemDirty[(TOTAL_MEM_REGISTERS + 7) / 8]{};
+
+    // INACTIVE mode, and WAV_MEM_LOCK released unless the shadow shows it is.
+    // ctl1 receives TOP_CTL1 as it was, without SEQ_START, or 0 if it could
+    // not be read; _restoreOperationMode() takes it whether this succeeded or not.
+    bool _unlockWaveFormMemory(uint8_t &ctl1);
+
+    // Writes back the TOP_CTL1 _unlockWaveFormMemory() saved, mode included.
+    bool _restoreOperationMode(uint8_t ctl1);
+
+    // Copies image[] into snpMemCopy, marking the bytes that change.
+    void _stageWaveFormMemory(const uint8_t image[], uint8_t);
+
+    // Writes the dirty bytes among the first used of snpMemCopy: the data
+    // runs first, runs at most MEM_WRITE_GAP_MAX apart merged, then counts
+    // and end pointers last, counts in the final write, so the header never
+    // describes data that is only partly there. Dirty bytes past used stay dirty.
+    bool _commitWaveFormMemory(uint8_t);
+    bool _writeWaveFormRun(uint8_t, uint8_t);
+    bool _isWaveFormDirty(uint8_t);
+    void _markWaveFormDirty(uint8_t, uint8_t, bool);
+
+    // Images resident in waveform memory, the sequence ID is the index
+    struct residentSequence
+    {
+        const uint8_t *image;
+        uint32_t lastUse;
+    };
+    residentSequence _residents[MAX_SEQUENCES]{};
+    uint8_t _numResidents = 0;
+    uint32_t _useClock = 0;
+    hapticCacheStats _cacheStats{};
+
+    // Start and end (exclusive) in image of a region, snippets 0..n-1 first,
+    // then the sequences. False if the counts or end pointers are out of range.
+    bool _imageRegion(const uint8_t image[], uint8_t, uint8_t &, uint8_t &);
+
+    // Lays the images out as one: their snippets in order, then one sequence
+    // each with the snippet IDs moved past the snippets of the images before.
+    bool _buildCacheImage(const residentSequence[], uint8_t, uint8_t image[], uint8_t &);
+
+    // CRC-16/CCITT-FALSE, polynomial 0x1021 and initial value 0xFFFF
+    uint16_t _crc16(const uint8_t[], uint8_t);
+    // Drops the least recently used image that is neither mapped to a GPI nor
+    // the last one loaded.
+    void _evictLeastRecent();
+
+    // Image mapped to each GPI by mapGpiImage(), never evicted; mapGpiSequence() clears it
+    const uint8_t *_gpiImage[NUM_GPI]{};
+    bool _isGpiImage(const uint8_t image[]);
+    // GPI_x_CTL is shadowed, an unchanged mapping is not written again
+    bool _writeGpiControl(uint8_t, uint8_t, uint8_t, uint8_t);
+    // Points every GPI mapped to an image at its sequence after a reload, an
+    // image that is no longer resident loses its mapping and GPI_x_CTL its ID
+    bool _followGpiImages();
+    // After a failed upload: no GPI is mapped, GPI_x_CTL back to reset values
+    bool _dropGpiMappings();
 
     // This generic function reads an eight bit register. It takes the register's
     // address as its' parameter.
     uint8_t _readRegister(uint8_t);
 
+    // Reads consecutive registers: regs[0] is the first register and the
+    // values are read into regs[1] onwards; the size is the total length of
+    // regs[]. Returns false if the IC does not acknowledge or returns fewer
+    // bytes than requested.
     bool _readConsReg(uint8_t regs[], size_t);
+
+    // Reads non-consecutive registers: regs[] holds register/value pairs with
+    // the registers in ascending order, the values are filled in. Registers
+    // close to each other are read in one burst.
     bool _readNonConsReg(uint8_t regs[], size_t);
+
     // This generic function does a basic I-squared-C read transaction at the given
     // addres, taking the number of reads as argument.
     uint8_t _readCommand(uint8_t);
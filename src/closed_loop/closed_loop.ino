@@ -0,0 +1,215 @@
+#include <Wire.h>
+#include <SPI.h>
+#include <SFE_LSM9DS0.h>
+#include "Haptic_Driver.h"
+#include "force_control.h"
+
+#define LSM9DS0_XM       0x1D
+#define LSM9DS0_G        0x6B
+#define SAMPLE_RATE      800
+#define ENVELOPE_WINDOW  24     // 30 ms, over two periods at 80 Hz
+#define CONTROL_EVERY    8      // samples, a level update every 10 ms
+#define ACTUATOR_M       0.017f
+
+// Calibration at 81 Hz, the same for 17..40 g (Rezultate_calibrare.xlsx)
+const forcePoint calibration[] = {
+  { 0, 0.0f }, { 10, 0.0612f }, { 50, 0.0885f }, { 100, 0.2465f }
+};
+
+LSM9DS0 imu(MODE_I2C, LSM9DS0_G, LSM9DS0_XM);
+Haptic_Driver hapDrive;
+forceControl control;
+forceEnvelope envelope;
+
+unsigned long latencySumUs = 0;
+unsigned long latencyMaxUs = 0;
+unsigned long writes = 0;
+
+void setup()
+{
+  Wire.begin();
+  Wire.setClock(400000UL);
+  Serial.begin(115200);
+  delay(100);
+
+  if (imu.begin() != 0x49D4)
+  {
+    Serial.println("Failed to initialize LSM9DS0!");
+    while (1);
+  }
+  imu.setAccelODR(LSM9DS0::A_ODR_800);
+  imu.setAccelScale(LSM9DS0::A_SCALE_2G);
+
+  if (!hapDrive.begin())
+  {
+    Serial.println("Haptic Driver initialization failed!");
+    while (1);
+  }
+
+  hapticSettings motorSettings;
+  motorSettings.motorType = LRA_TYPE;
+  motorSettings.nomVolt = 1.4;
+  motorSettings.absVolt = 1.45;
+  motorSettings.currMax = 213;
+  motorSettings.impedance = 8.0;
+  motorSettings.lraFreq = 80;
+
+  if (!hapDrive.setMotor(motorSettings) || !hapDrive.setOperationMode(DRO_MODE))
+  {
+    Serial.println("Failed to configure actuator.");
+    while (1);
+  }
+  hapDrive.enableFreqTrack(false);
+  hapDrive.enableAcceleration(false);
+  hapDrive.enableRapidStop(false);
+
+  forceControlConfig config;
+  config.curve = calibration;
+  config.numPoints = sizeof(calibration) / sizeof(calibration[0]);
+  config.actuatorMassKg = ACTUATOR_M;
+  config.maxLevel = 0x7F;
+  config.adaptRate = 0.5f;
+  config.settleMs = 60;
+  config.tolerance = 0.05f;
+  config.minGain = 0.25f;
+  config.maxGain = 4.0f;
+  forcectl_init(&control, &config);
+
+  Serial.println("Send a profile, \"100ms 50%, 300ms 10%\", or \"r <profile>\" to record it open loop.");
+}
+
+// Writes the level and books the time from the sample it was computed
+// from to the end of the write
+void writeLevel(uint8_t level, unsigned long sampleUs)
+{
+  hapDrive.setVibrate(level);
+  unsigned long latencyUs = micros() - sampleUs;
+  latencySumUs += latencyUs;
+  latencyMaxUs = (latencyUs > latencyMaxUs) ? latencyUs : latencyMaxUs;
+  writes++;
+}
+
+// Plays one step, in closed loop unless record is set, in which case the
+// level is written as it is and the envelope printed as "ms,level,m/s^2"
+// for force_loop -i
+void playStep(const forceStep *step, bool record, unsigned long startUs)
+{
+  const unsigned long samplingInterval = 1000000UL / SAMPLE_RATE;
+  uint8_t level = record ? step->level : forcectl_setTarget(&control, step->level);
+  unsigned long stepUs = micros();
+  unsigned long next = stepUs;
+
+  hapDrive.setVibrate(level);
+  for (uint32_t i = 1; micros() - stepUs < step->durationMs * 1000UL; i++)
+  {
+    while ((long)(micros() - next) < 0) { }
+    next += samplingInterval;
+
+    unsigned long sampleUs = micros();
+    imu.readAccel();
+    forcectl_envelopeAdd(&envelope, imu.calcAccel(imu.ay) * 9.80665f);
+    if (i % CONTROL_EVERY != 0 || !forcectl_envelopeFull(&envelope))
+    {
+      continue;
+    }
+    float amplitude = forcectl_envelopeAmplitude(&envelope);
+    if (record)
+    {
+      Serial.print((sampleUs - startUs) / 1000UL);
+      Serial.print(",");
+      Serial.print(level);
+      Serial.print(",");
+      Serial.println(amplitude, 4);
+      continue;
+    }
+    uint8_t updated = forcectl_update(&control, amplitude, CONTROL_EVERY * 1000UL / SAMPLE_RATE);
+    if (updated != level)
+    {
+      level = updated;
+      writeLevel(level, sampleUs);
+    }
+  }
+
+  if (!record && step->level > 0)
+  {
+    Serial.print(step->durationMs);
+    Serial.print("ms ");
+    Serial.print(step->level);
+    Serial.print("%: target ");
+    Serial.print(control.targetN, 4);
+    Serial.print(" N, measured ");
+    Serial.print(control.targetN + control.lastErrorN, 4);
+    Serial.print(" N, level ");
+    Serial.print(level);
+    Serial.print(", gain ");
+    Serial.println(control.gain, 3);
+  }
+}
+
+void loop()
+{
+  if (Serial.available() == 0)
+  {
+    return;
+  }
+  String line = Serial.readStringUntil('\n');
+  bool record = line.startsWith("r ");
+  if (record)
+  {
+    line = line.substring(2);
+  }
+
+  forceStep steps[FORCE_PROFILE_MAX_STEPS];
+  size_t numSteps = forcectl_parseProfile(line.c_str(), steps, FORCE_PROFILE_MAX_STEPS);
+  if (numSteps == 0)
+  {
+    Serial.println("Not a profile.");
+    return;
+  }
+
+  forcectl_envelopeInit(&envelope, ENVELOPE_WINDOW);
+  forcectl_resetStats(&control);
+  latencySumUs = 0;
+  latencyMaxUs = 0;
+  writes = 0;
+
+  unsigned long startUs = micros();
+  for (size_t i = 0; i < numSteps; i++)
+  {
+    playStep(&steps[i], record, startUs);
+  }
+  forcectl_setTarget(&control, 0);
+  hapDrive.setVibrate(0);
+  if (record)
+  {
+    return;
+  }
+
+  forceControlStats stats;
+  forcectl_getStats(&control, &stats);
+  Serial.print("Converged ");
+  Serial.print(stats.converged);
+  Serial.print("/");
+  Serial.print(stats.targets);
+  Serial.print(" steps, mean ");
+  Serial.print(stats.meanConvergeMs);
+  Serial.print(" ms, max ");
+  Serial.print(stats.maxConvergeMs);
+  Serial.print(" ms, ");
+  Serial.print(stats.adaptations);
+  Serial.print(" gain updates, ");
+  Serial.print(stats.saturations);
+  Serial.println(" saturated");
+  // The peak to peak envelope lags the acceleration by half its window
+  Serial.print("Latency: envelope delay ");
+  Serial.print(ENVELOPE_WINDOW * 500UL / SAMPLE_RATE);
+  Serial.print(" ms (half the ");
+  Serial.print(ENVELOPE_WINDOW * 1000UL / SAMPLE_RATE);
+  Serial.print(" ms window), sample to level written mean ");
+  Serial.print(writes > 0 ? latencySumUs / writes : 0);
+  Serial.print(" us, max ");
+  Serial.print(latencyMaxUs);
+  Serial.print(" us over ");
+  Serial.print(writes);
+  Serial.println(" writes");
+}
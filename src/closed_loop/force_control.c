@@ -0,0 +1,225 @@
+#include "force_control.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+void forcectl_envelopeInit(forceEnvelope *env, uint8_t window)
+{
+    memset(env, 0, sizeof(*env));
+    env->window = (window > FORCE_ENVELOPE_MAX_SAMPLES) ? FORCE_ENVELOPE_MAX_SAMPLES : window;
+    env->window = (env->window > 0) ? env->window : 1;
+}
+
+void forcectl_envelopeAdd(forceEnvelope *env, float accel)
+{
+    env->samples[env->next] = accel;
+    env->next = (uint8_t)((env->next + 1) % env->window);
+    if (env->count < env->window)
+    {
+        env->count++;
+    }
+}
+
+bool forcectl_envelopeFull(const forceEnvelope *env)
+{
+    return env->count == env->window;
+}
+
+float forcectl_envelopeAmplitude(const forceEnvelope *env)
+{
+    if (env->count == 0)
+    {
+        return 0.0f;
+    }
+    float maxVal = env->samples[0];
+    float minVal = env->samples[0];
+    for (uint8_t i = 1; i < env->count; i++)
+    {
+        maxVal = (env->samples[i] > maxVal) ? env->samples[i] : maxVal;
+        minVal = (env->samples[i] < minVal) ? env->samples[i] : minVal;
+    }
+    return (maxVal - minVal) * 0.5f;
+}
+
+void forcectl_init(forceControl *ctl, const forceControlConfig *config)
+{
+    memset(ctl, 0, sizeof(*ctl));
+    ctl->config = *config;
+    ctl->gain = 1.0f;
+}
+
+float forcectl_nominalForce(const forceControl *ctl, uint8_t level)
+{
+    const forcePoint *curve = ctl->config.curve;
+    uint8_t n = ctl->config.numPoints;
+
+    if (n < 2)
+    {
+        return 0.0f;
+    }
+    // Segment the level falls on, the last one above the curve
+    uint8_t i = 1;
+    while (i < n - 1 && level > curve[i].level)
+    {
+        i++;
+    }
+    float span = (float)curve[i].level - curve[i - 1].level;
+    float x = (span > 0) ? (level - (float)curve[i - 1].level) / span : 1.0f;
+    return curve[i - 1].forceN + x * (curve[i].forceN - curve[i - 1].forceN);
+}
+
+// Lowest level whose nominal force is closest to forceN
+static uint8_t _levelFor(forceControl *ctl, float forceN)
+{
+    uint8_t best = 0;
+    float   bestError = forceN;
+
+    if (forceN <= 0.0f)
+    {
+        return 0;
+    }
+    for (uint16_t level = 1; level <= ctl->config.maxLevel; level++)
+    {
+        float error = forcectl_nominalForce(ctl, (uint8_t)level) - forceN;
+        error = (error < 0) ? -error : error;
+        if (error < bestError)
+        {
+            best = (uint8_t)level;
+            bestError = error;
+        }
+    }
+    if (best == ctl->config.maxLevel && forcectl_nominalForce(ctl, best) < forceN)
+    {
+        ctl->stats.saturations++;
+    }
+    return best;
+}
+
+// Books the target that ends against the convergence statistics
+static void _endTarget(forceControl *ctl)
+{
+    if (ctl->targetN <= 0.0f)
+    {
+        return;
+    }
+    ctl->stats.targets++;
+    if (ctl->withinSinceMs > 0)
+    {
+        ctl->stats.converged++;
+        ctl->convergeSumMs += ctl->withinSinceMs;
+        if (ctl->withinSinceMs > ctl->stats.maxConvergeMs)
+        {
+            ctl->stats.maxConvergeMs = ctl->withinSinceMs;
+        }
+    }
+}
+
+uint8_t forcectl_setTarget(forceControl *ctl, uint8_t level)
+{
+    _endTarget(ctl);
+    ctl->targetN = forcectl_nominalForce(ctl, level);
+    ctl->sinceTargetMs = 0;
+    ctl->withinSinceMs = 0;
+    ctl->lastErrorN = 0.0f;
+
+    uint8_t next = (level == 0) ? 0 : _levelFor(ctl, ctl->targetN / ctl->gain);
+    if (next != ctl->level)
+    {
+        ctl->level = next;
+        ctl->sinceLevelMs = 0;
+    }
+    return ctl->level;
+}
+
+uint8_t forcectl_update(forceControl *ctl, float amplitude, uint32_t elapsedMs)
+{
+    const forceControlConfig *config = &ctl->config;
+    float measuredN = config->actuatorMassKg * amplitude;
+
+    ctl->sinceLevelMs += elapsedMs;
+    ctl->sinceTargetMs += elapsedMs;
+    if (ctl->targetN <= 0.0f)
+    {
+        return ctl->level;
+    }
+
+    // Converged once the error stays within the tolerance
+    ctl->lastErrorN = measuredN - ctl->targetN;
+    float error = (ctl->lastErrorN < 0) ? -ctl->lastErrorN : ctl->lastErrorN;
+    if (error > config->tolerance * ctl->targetN)
+    {
+        ctl->withinSinceMs = 0;
+    }
+    else if (ctl->withinSinceMs == 0)
+    {
+        ctl->withinSinceMs = (ctl->sinceTargetMs > 0) ? ctl->sinceTargetMs : 1;
+    }
+
+    if (ctl->sinceLevelMs < config->settleMs || ctl->level == 0)
+    {
+        return ctl->level;
+    }
+
+    // The settled response against the curve at the level that caused it
+    float nominalN = forcectl_nominalForce(ctl, ctl->level);
+    if (nominalN > 0.0f)
+    {
+        ctl->gain += config->adaptRate * (measuredN / nominalN - ctl->gain);
+        ctl->gain = (ctl->gain < config->minGain) ? config->minGain : ctl->gain;
+        ctl->gain = (ctl->gain > config->maxGain) ? config->maxGain : ctl->gain;
+        ctl->stats.adaptations++;
+    }
+
+    uint8_t next = _levelFor(ctl, ctl->targetN / ctl->gain);
+    if (next != ctl->level)
+    {
+        ctl->level = next;
+        ctl->sinceLevelMs = 0;
+    }
+    return ctl->level;
+}
+
+void forcectl_getStats(const forceControl *ctl, forceControlStats *stats)
+{
+    *stats = ctl->stats;
+    if (stats->converged > 0)
+    {
+        stats->meanConvergeMs = (uint32_t)(ctl->convergeSumMs / stats->converged);
+    }
+}
+
+void forcectl_resetStats(forceControl *ctl)
+{
+    memset(&ctl->stats, 0, sizeof(ctl->stats));
+    ctl->convergeSumMs = 0;
+}
+
+size_t forcectl_parseProfile(const char *text, forceStep steps[], size_t maxSteps)
+{
+    size_t n = 0;
+
+    while (*text != '\0' && n < maxSteps)
+    {
+        char *end;
+        long  durationMs = strtol(text, &end, 10);
+        if (end == text || strncmp(end, "ms", 2) != 0)
+        {
+            return 0;
+        }
+        text = end + 2;
+        long level = strtol(text, &end, 10);
+        if (end == text || *end != '%' || durationMs < 1 || durationMs > UINT16_MAX || level < 0 || level > UINT8_MAX)
+        {
+            return 0;
+        }
+        steps[n].durationMs = (uint16_t)durationMs;
+        steps[n].level = (uint8_t)level;
+        n++;
+        text = end + 1;
+        while (*text == ',' || *text == ' ' || *text == '\r' || *text == '\n')
+        {
+            text++;
+        }
+    }
+    return n;
+}
@@ -0,0 +1,121 @@
+#ifndef FORCE_CONTROL_H
+#define FORCE_CONTROL_H
+
+/* Closes the loop from the measured acceleration to the DA7280 drive level.
+ * Targets are the forces a healthy, well attached actuator produces at the
+ * levels of a pattern, given by the calibration curve. The controller keeps
+ * an estimate of how far the actual response is from that curve, the gain,
+ * and picks the level whose nominal force times the gain is the target.
+ * The gain is learned from the measured force once a level has settled and
+ * carries over to the next steps, which is how a loose attachment or an
+ * aged actuator is compensated. No bus access and no timing of its own:
+ * the caller feeds samples and writes the level, the same code runs on the
+ * Arduino and on a host.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FORCE_CURVE_MAX_POINTS      8
+#define FORCE_ENVELOPE_MAX_SAMPLES  64
+#define FORCE_PROFILE_MAX_STEPS     16
+
+// Force of the calibrated actuator at a level, as accelerometer.ino
+// measures it: ACTUATOR_M * half the peak to peak acceleration
+typedef struct
+{
+    uint8_t level;
+    float   forceN;
+} forcePoint;
+
+// One step of a profile, as controller.ino prints it: "100ms 50%"
+typedef struct
+{
+    uint16_t durationMs;
+    uint8_t  level;
+} forceStep;
+
+// Half the peak to peak acceleration over the last window samples
+typedef struct
+{
+    float   samples[FORCE_ENVELOPE_MAX_SAMPLES];
+    uint8_t window;
+    uint8_t next;
+    uint8_t count;
+} forceEnvelope;
+
+typedef struct
+{
+    const forcePoint *curve;        // rising levels and forces, from { 0, 0 }
+    uint8_t  numPoints;
+    float    actuatorMassKg;        // ACTUATOR_M
+    uint8_t  maxLevel;              // 0x7F, the highest positive TOP_CTL2 level either way
+    float    adaptRate;             // share of the observed gain error taken per update, 0..1
+    uint16_t settleMs;              // after a level change before the response is trusted
+    float    tolerance;             // relative force error a step counts as converged within
+    float    minGain;
+    float    maxGain;
+} forceControlConfig;
+
+typedef struct
+{
+    uint32_t targets;               // non-zero targets that ended
+    uint32_t converged;             // of them, within tolerance at the end
+    uint32_t meanConvergeMs;        // from the target change until it stayed within tolerance
+    uint32_t maxConvergeMs;
+    uint32_t adaptations;           // gain updates
+    uint32_t saturations;           // levels clamped at maxLevel
+} forceControlStats;
+
+typedef struct
+{
+    forceControlConfig config;
+    float    gain;                  // actual response over the curve, kept across targets
+    float    targetN;
+    float    lastErrorN;            // measured minus target at the last update
+    uint8_t  level;
+    uint32_t sinceLevelMs;
+    uint32_t sinceTargetMs;
+    uint32_t withinSinceMs;         // sinceTargetMs when the error entered the tolerance, 0 if outside
+    uint64_t convergeSumMs;
+    forceControlStats stats;
+} forceControl;
+
+void forcectl_envelopeInit(forceEnvelope *env, uint8_t window);
+void forcectl_envelopeAdd(forceEnvelope *env, float accel);
+bool forcectl_envelopeFull(const forceEnvelope *env);
+float forcectl_envelopeAmplitude(const forceEnvelope *env);
+
+// Starts with a gain of 1, the actuator as calibrated.
+void forcectl_init(forceControl *ctl, const forceControlConfig *config);
+
+// Force of the curve at level, extrapolated along the last segment above it.
+float forcectl_nominalForce(const forceControl *ctl, uint8_t level);
+
+// New target, the force of the curve at level; 0 ends the last one. Returns
+// the level to write, the feedforward from the current gain.
+uint8_t forcectl_setTarget(forceControl *ctl, uint8_t level);
+
+// Takes the amplitude measured elapsedMs after the last update, in m/s^2,
+// and returns the level to write; it is only changed once the current one
+// has settled.
+uint8_t forcectl_update(forceControl *ctl, float amplitude, uint32_t elapsedMs);
+
+void forcectl_getStats(const forceControl *ctl, forceControlStats *stats);
+// Clears the statistics, the gain is kept.
+void forcectl_resetStats(forceControl *ctl);
+
+// Parses "100ms 50%, 300ms 10%" into steps, returns their number, 0 if
+// the text is not a profile.
+size_t forcectl_parseProfile(const char *text, forceStep steps[], size_t maxSteps);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FORCE_CONTROL_H
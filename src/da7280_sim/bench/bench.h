@@ -0,0 +1,48 @@
+#ifndef DA7280_BENCH_H
+#define DA7280_BENCH_H
+
+/* Bus cost benchmark for the DA7280 drivers. Every public call is run once
+ * against a freshly reset simulated device; a suite per driver API. */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "i2c_transport.h"
+#include "da7280_sim.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct
+{
+    const char *name;
+    bool        needsBegin;         // run the suite's begin() before measuring
+    void      (*run)(void);
+    void      (*setup)(void);       // optional, runs after begin() and is not measured
+} bench_case_t;
+
+typedef struct
+{
+    const char         *api;
+    const bench_case_t *cases;
+    size_t              numCases;
+    void              (*attach)(const i2c_transport_t *transport);
+    bool              (*begin)(void);
+} bench_suite_t;
+
+// Simulated device of the running case, its nIRQ drives DA7280_NIRQ_PIN
+extern da7280sim_t *bench_device;
+
+// Set by a case whose device ends up in the wrong state, fails the run
+extern bool bench_checkFailed;
+
+extern const bench_suite_t bench_cSuite;
+extern const bench_suite_t bench_hapticDriverSuite;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // DA7280_BENCH_H
@@ -0,0 +1,318 @@
+#include "bench.h"
+#include "da7280_driver.h"
+#include "da7280_i2c_async.h"
+#include "da7280_nirq.h"
+#include "da7280_pwm.h"
+#include "em_timer.h"
+#include "sl_sleeptimer.h"
+#include "gatt_db.h"
+
+#include <stdio.h>
+
+static sl_i2cspm_t _port;
+static const hapticSettings _settings = { LRA_TYPE, 1.4f, 1.45f, 213.0f, 8.0f, 80.0f };
+// 32 steps of a rise and fall envelope, streamed at 400 Hz
+static const uint8_t _envelope[32] = {
+    0, 16, 32, 48, 64, 80, 96, 112, 127, 127, 127, 127, 127, 127, 127, 127,
+    127, 127, 127, 127, 127, 127, 127, 127, 112, 96, 80, 64, 48, 32, 16, 0
+};
+
+static void _attach(const i2c_transport_t *transport)
+{
+    _port.transport = transport;
+}
+
+static bool _begin(void)
+{
+    return da7280_begin(&_port);
+}
+
+static void _runBegin(void)                      { da7280_begin(&_port); }
+static void _runSetActuatorType(void)            { da7280_setActuatorType(LRA_TYPE); }
+static void _runSetMotorSettings(void)           { da7280_setMotorSettings(_settings); }
+static void _runGetMotorSettings(void)           { da7280_getMotorSettings(); }
+static void _runWriteFields(void)
+{
+    const regFieldValue updates[] = { { FREQ_TRACK_EN, true }, { ACCELERATION_EN, true }, { RAPID_STOP_EN, true } };
+    da7280_writeFields(updates, sizeof(updates) / sizeof(updates[0]));
+}
+static void _runSetOperationMode(void)           { da7280_setOperationMode(DRO_MODE); }
+static void _runGetOperationMode(void)           { da7280_getOperationMode(); }
+static void _runSetActuatorABSVolt(void)         { da7280_setActuatorABSVolt(_settings.absVolt); }
+static void _runGetActuatorABSVolt(void)         { da7280_getActuatorABSVolt(); }
+static void _runSetActuatorNOMVolt(void)         { da7280_setActuatorNOMVolt(_settings.nomVolt); }
+static void _runGetActuatorNOMVolt(void)         { da7280_getActuatorNOMVolt(); }
+static void _runSetActuatorIMAX(void)            { da7280_setActuatorIMAX(_settings.currMax); }
+static void _runGetActuatorIMAX(void)            { da7280_getActuatorIMAX(); }
+static void _runSetActuatorImpedance(void)       { da7280_setActuatorImpedance(_settings.impedance); }
+static void _runGetActuatorImpedance(void)       { da7280_getActuatorImpedance(); }
+static void _runReadImpAdjus(void)               { da7280_readImpAdjus(); }
+static void _runSetActuatorLRAfreq(void)         { da7280_setActuatorLRAfreq(_settings.lraFreq); }
+static void _runEnableCoinERM(void)              { da7280_enableCoinERM(); }
+static void _runEnableAcceleration(void)         { da7280_enableAcceleration(true); }
+static void _runEnableRapidStop(void)            { da7280_enableRapidStop(true); }
+static void _runEnableAmpPid(void)               { da7280_enableAmpPid(true); }
+static void _runEnableFreqTrack(void)            { da7280_enableFreqTrack(true); }
+static void _runSetBemfFaultLimit(void)          { da7280_setBemfFaultLimit(true); }
+static void _runEnableV2iFactorFreeze(void)      { da7280_enableV2iFactorFreeze(true); }
+static void _runCalibrateImpedanceDistance(void) { da7280_calibrateImpedanceDistance(true); }
+static void _runSetVibrate(void)                 { da7280_setVibrate(60); }
+static void _runStreamAmplitudes(void)           { da7280_streamAmplitudes(_envelope, sizeof(_envelope), 2500); }
+static void _runGetVibrate(void)                 { da7280_getVibrate(); }
+static void _runSetFullBrake(void)               { da7280_setFullBrake(3); }
+static void _runGetFullBrake(void)               { da7280_getFullBrake(); }
+static void _runSetMask(void)                    { da7280_setMask(0x00); }
+static void _runGetMask(void)                    { da7280_getMask(); }
+static void _runSetBemf(void)                    { da7280_setBemf(1); }
+static void _runGetBemf(void)                    { da7280_getBemf(); }
+static void _runClearIrq(void)                   { da7280_clearIrq(E_SEQ_DONE); }
+static void _runEraseWaveformMemory(void)        { da7280_eraseWaveformMemory(); }
+static void _runAddSnippet(void)                 { da7280_addSnippet(1, 2, 2); }
+
+static void _runAddSnippets(void)
+{
+    const uint8_t snippets[] = { 0x82, 0x24, 0x86 };
+    da7280_addSnippets(snippets, sizeof(snippets));
+}
+static void _runGetIrqEvent(void)                { da7280_getIrqEvent(); }
+static void _runGetEventDiag(void)               { da7280_getEventDiag(); }
+static void _runGetIrqStatus(void)               { da7280_getIrqStatus(); }
+static void _runGetIrqSnapshot(void)             { irqSnapshot irq; da7280_getIrqSnapshot(&irq); }
+static void _runPlayFromMemory(void)             { da7280_playFromMemory(true); }
+static void _runSetSeqControl(void)              { da7280_setSeqControl(1, 0); }
+static void _runAddFrame(void)                   { da7280_addFrame(0, 3, 1); }
+static void _runLoadPattern(void)                { wavememTiming timing; da7280_loadPattern(2, &timing); }
+static void _runPlayPattern(void)                { da7280_playPattern(2); }
+static void _runSwitchPattern(void)              { da7280_playPattern(3); }
+static void _loadPattern(void)                   { wavememTiming timing; da7280_loadPattern(2, &timing); }
+static void _runVerifyWaveformMemory(void)       { da7280_verifyWaveformMemory(NULL); }
+
+// Pattern 2 loaded, then three bytes of its frames flipped in the device
+static void _corruptPattern(void)
+{
+    _loadPattern();
+    for (int i = 0; i < 3; i++)
+    {
+        bench_device->regs[0x84 + 40 + 7 * i] ^= 0x01;
+    }
+}
+static void _runMapGpiSequence(void)             { da7280_mapGpiSequence(0, 1, GPI_FALLING_EDGE, GPI_SINGLE_PATTERN); }
+static void _runMapGpiPattern(void)              { da7280_mapGpiPattern(1, 2, GPI_RISING_EDGE); }
+
+// Pattern 2 on GPI1, armed in ETWM mode, with the nIRQ line serviced
+static void _armGpiPattern(void)
+{
+    da7280_mapGpiPattern(1, 2, GPI_RISING_EDGE);
+    da7280_setOperationMode(ETWM_MODE);
+    da7280_nirqInit();
+}
+
+// Ten pulses on GPI1, every rising edge starts the pattern from the IC
+// itself. The bus only carries the E_SEQ_DONE service after each sequence,
+// which has to leave ETWM mode armed for the next edge.
+#define GPI_PULSES      10
+#define GPI_MAX_WAIT_MS 5000
+
+static void _runGpiTrigger(void)
+{
+    for (int i = 0; i < GPI_PULSES; i++)
+    {
+        da7280sim_setGpi(bench_device, 1, true);
+        da7280sim_setGpi(bench_device, 1, false);
+        for (int ms = 0; ms < GPI_MAX_WAIT_MS && (bench_device->seqDone <= (uint32_t)i || da7280_nirqPending()); ms++)
+        {
+            da7280_nirqService();
+            sl_sleeptimer_delay_millisecond(1);
+        }
+    }
+    if (bench_device->gpiStarts != GPI_PULSES || bench_device->lastSequence.fault != 0 ||
+        (bench_device->regs[SIM_TOP_CTL1] & 0x07) != ETWM_MODE)
+    {
+        fprintf(stderr, "da7280: %u of %d GPI edges started the pattern, ETWM %s\n",
+                (unsigned)bench_device->gpiStarts, GPI_PULSES,
+                ((bench_device->regs[SIM_TOP_CTL1] & 0x07) == ETWM_MODE) ? "armed" : "lost");
+        bench_checkFailed = true;
+    }
+}
+
+// Queued write, completed by the simulated I2C interrupt
+static void _runSetVibrateAsync(void)
+{
+    da7280_enableAsyncTransfers(true);
+    da7280_setVibrate(60);
+    while (!da7280_asyncIsIdle())
+    {
+        da7280_asyncIrqHandler();
+    }
+    da7280_enableAsyncTransfers(false);
+}
+
+// One second of the bare-metal loop at one pass per millisecond with nothing
+// pending. Polling reads the IRQ registers on every pass, with the nIRQ line
+// the bus stays idle; the difference is the transactions per second saved.
+#define IDLE_LOOP_PASSES 1000
+
+static void _runIdlePolled(void)
+{
+    for (int i = 0; i < IDLE_LOOP_PASSES; i++)
+    {
+        irqSnapshot irq;
+        if (da7280_getIrqSnapshot(&irq) && irq.events != HAPTIC_SUCCESS)
+        {
+            da7280_clearIrq(irq.events);
+            da7280_setOperationMode(DRO_MODE);
+        }
+        sl_sleeptimer_delay_millisecond(1);
+    }
+}
+
+static void _runIdleNIrq(void)
+{
+    da7280_nirqInit();
+    for (int i = 0; i < IDLE_LOOP_PASSES; i++)
+    {
+        da7280_nirqService();
+        sl_sleeptimer_delay_millisecond(1);
+    }
+}
+
+// A sequence fault half way through the second, recovered from the nIRQ edge
+static void _runFaultNIrq(void)
+{
+    da7280_nirqInit();
+    for (int i = 0; i < IDLE_LOOP_PASSES; i++)
+    {
+        if (i == IDLE_LOOP_PASSES / 2)
+        {
+            da7280sim_raiseIrq(bench_device, E_SEQ_FAULT);
+        }
+        da7280_nirqService();
+        sl_sleeptimer_delay_millisecond(1);
+    }
+}
+
+// Pattern 0 (17 g) with a one second activity time, the super loop passing
+// once per millisecond until the session has ended
+static void _runPerformActivity(void)
+{
+    char msg[128];
+
+    da7280_setBootStatus(BOOT_COMPLETED);
+    da7280_processUserInput(17, gattdb_weight_value, msg, sizeof(msg));
+    da7280_processUserInput(0, gattdb_pattern_value, msg, sizeof(msg));
+    da7280_processUserInput(1, gattdb_activity_value, msg, sizeof(msg));
+    da7280_nirqInit();
+    while (da7280_isActivityTimeSet())
+    {
+        da7280_nirqService();
+        da7280_performActivity();
+        sl_sleeptimer_delay_millisecond(1);
+    }
+}
+
+// The same session with a 50 ms raised cosine opening every step, 1 kHz
+static void _runPerformActivityRamped(void)
+{
+    da7280_setStepRamp(RAMP_RAISED_COSINE, 50, RAMP_MAX_RATE_HZ);
+    _runPerformActivity();
+    da7280_setStepRamp(RAMP_STEP, 0, RAMP_MAX_RATE_HZ);
+}
+
+// The ramped session on the PWM backend, 20 kHz from a 38.4 MHz timer clock
+static void _runPerformActivityPwm(void)
+{
+    static TIMER_TypeDef timer;
+
+    simtimer_attach(&timer, 38400000, da7280_pwmIrqHandler);
+    da7280_pwmInit(&timer, 0, 38400000, 20000);
+    da7280_setPlaybackBackend(PLAYBACK_PWM);
+    _runPerformActivityRamped();
+    da7280_setPlaybackBackend(PLAYBACK_DRO);
+    simtimer_reset();
+}
+
+// Four patterns back to back and one after a gap, loaded up front
+static void _runPlaylist(void)
+{
+    da7280_setBootStatus(BOOT_COMPLETED);
+    da7280_queuePattern(0, 2, 0);
+    da7280_queuePattern(1, 1, 0);
+    da7280_queuePattern(2, 1, 100);
+    da7280_queuePattern(3, 1, 0);
+    da7280_startPlaylist();
+    da7280_nirqInit();
+    while (da7280_isActivityTimeSet())
+    {
+        da7280_nirqService();
+        da7280_performActivity();
+        sl_sleeptimer_delay_millisecond(1);
+    }
+}
+
+static const bench_case_t _cases[] = {
+    { "begin",                      false, _runBegin, NULL },
+    { "setActuatorType",            true,  _runSetActuatorType, NULL },
+    { "writeFields",                true,  _runWriteFields, NULL },
+    { "setMotorSettings",           true,  _runSetMotorSettings, NULL },
+    { "getMotorSettings",           true,  _runGetMotorSettings, NULL },
+    { "setOperationMode",           true,  _runSetOperationMode, NULL },
+    { "getOperationMode",           true,  _runGetOperationMode, NULL },
+    { "setActuatorABSVolt",         true,  _runSetActuatorABSVolt, NULL },
+    { "getActuatorABSVolt",         true,  _runGetActuatorABSVolt, NULL },
+    { "setActuatorNOMVolt",         true,  _runSetActuatorNOMVolt, NULL },
+    { "getActuatorNOMVolt",         true,  _runGetActuatorNOMVolt, NULL },
+    { "setActuatorIMAX",            true,  _runSetActuatorIMAX, NULL },
+    { "getActuatorIMAX",            true,  _runGetActuatorIMAX, NULL },
+    { "setActuatorImpedance",       true,  _runSetActuatorImpedance, NULL },
+    { "getActuatorImpedance",       true,  _runGetActuatorImpedance, NULL },
+    { "readImpAdjus",               true,  _runReadImpAdjus, NULL },
+    { "setActuatorLRAfreq",         true,  _runSetActuatorLRAfreq, NULL },
+    { "enableCoinERM",              true,  _runEnableCoinERM, NULL },
+    { "enableAcceleration",         true,  _runEnableAcceleration, NULL },
+    { "enableRapidStop",            true,  _runEnableRapidStop, NULL },
+    { "enableAmpPid",               true,  _runEnableAmpPid, NULL },
+    { "enableFreqTrack",            true,  _runEnableFreqTrack, NULL },
+    { "setBemfFaultLimit",          true,  _runSetBemfFaultLimit, NULL },
+    { "enableV2iFactorFreeze",      true,  _runEnableV2iFactorFreeze, NULL },
+    { "calibrateImpedanceDistance", true,  _runCalibrateImpedanceDistance, NULL },
+    { "setVibrate",                 true,  _runSetVibrate, NULL },
+    { "setVibrate (async)",         true,  _runSetVibrateAsync, NULL },
+    { "streamAmplitudes",           true,  _runStreamAmplitudes, NULL },
+    { "getVibrate",                 true,  _runGetVibrate, NULL },
+    { "setFullBrake",               true,  _runSetFullBrake, NULL },
+    { "getFullBrake",               true,  _runGetFullBrake, NULL },
+    { "setMask",                    true,  _runSetMask, NULL },
+    { "getMask",                    true,  _runGetMask, NULL },
+    { "setBemf",                    true,  _runSetBemf, NULL },
+    { "getBemf",                    true,  _runGetBemf, NULL },
+    { "clearIrq",                   true,  _runClearIrq, NULL },
+    { "eraseWaveformMemory",        true,  _runEraseWaveformMemory, NULL },
+    { "addSnippet",                 true,  _runAddSnippet, NULL },
+    { "addSnippets",                true,  _runAddSnippets, NULL },
+    { "getIrqEvent",                true,  _runGetIrqEvent, NULL },
+    { "getEventDiag",               true,  _runGetEventDiag, NULL },
+    { "getIrqStatus",               true,  _runGetIrqStatus, NULL },
+    { "getIrqSnapshot",             true,  _runGetIrqSnapshot, NULL },
+    { "idle 1 s (polled IRQ)",      true,  _runIdlePolled, NULL },
+    { "idle 1 s (nIRQ)",            true,  _runIdleNIrq, NULL },
+    { "fault in 1 s (nIRQ)",        true,  _runFaultNIrq, NULL },
+    { "playFromMemory",             true,  _runPlayFromMemory, NULL },
+    { "setSeqControl",              true,  _runSetSeqControl, NULL },
+    { "addFrame",                   true,  _runAddFrame, NULL },
+    { "loadPattern",                true,  _runLoadPattern, NULL },
+    { "playPattern (resident)",     true,  _runPlayPattern, _loadPattern },
+    { "playPattern (switch)",       true,  _runSwitchPattern, _loadPattern },
+    { "verifyWaveformMemory",       true,  _runVerifyWaveformMemory, _loadPattern },
+    { "verifyWaveformMemory (bad)", true,  _runVerifyWaveformMemory, _corruptPattern },
+    { "mapGpiSequence",             true,  _runMapGpiSequence, NULL },
+    { "mapGpiPattern",              true,  _runMapGpiPattern, NULL },
+    { "GPI trigger x10 (ETWM)",     true,  _runGpiTrigger, _armGpiPattern },
+    { "performActivity (1 s)",      true,  _runPerformActivity, NULL },
+    { "performActivity (1 s, ramps)", true, _runPerformActivityRamped, NULL },
+    { "performActivity (1 s, ramps, PWM)", true, _runPerformActivityPwm, NULL },
+    { "playlist (5 passes)",        true,  _runPlaylist, NULL },
+};
+
+const bench_suite_t bench_cSuite = {
+    "da7280", _cases, sizeof(_cases) / sizeof(_cases[0]), _attach, _begin
+};
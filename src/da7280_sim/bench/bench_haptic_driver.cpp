@@ -0,0 +1,247 @@
+#include "bench.h"
+#include "Haptic_Driver.h"
+
+#include <stdio.h>
+#include <string.h>
+
+static Haptic_Driver *_hapDrive = nullptr;
+static hapticSettings _settings = {LRA_TYPE, 1.4f, 1.45f, 213.0f, 8.0f, 80.0f};
+// 32 steps of a rise and fall envelope, streamed at 400 Hz
+static const uint8_t _envelope[32] = {0,   16,  32,  48,  64,  80,  96,  112, 127, 127, 127,
+                                      127, 127, 127, 127, 127, 127, 127, 127, 127, 127, 127,
+                                      127, 127, 112, 96,  80,  64,  48,  32,  16,  0};
+// Single-sequence waveform memory images: two step snippets played three
+// times, and a ramp down with a pause
+static const uint8_t _effectA[] = {2, 1, 0x89, 0x8A, 0x8E, 0x3F, 0x28, 0x09, 0x0A, 0x01, 0x98};
+static const uint8_t _effectB[] = {1, 1, 0x89, 0x8C, 0x7F, 0xF0, 0x11, 0x00, 0x11};
+
+static void _attach(const i2c_transport_t *transport)
+{
+    static Haptic_Driver hapDrive;
+
+    // A fresh driver per case, so no shadow or snippet state carries over
+    hapDrive = Haptic_Driver();
+    _hapDrive = &hapDrive;
+    Wire.setTransport(transport);
+}
+
+static bool _begin(void)
+{
+    return _hapDrive->begin(Wire);
+}
+
+static void _runBegin(void) { _hapDrive->begin(Wire); }
+static void _runSetActuatorType(void) { _hapDrive->setActuatorType(LRA_TYPE); }
+static void _runWriteFields(void) { _hapDrive->writeFields<FREQ_TRACK_EN, ACCELERATION_EN, RAPID_STOP_EN>(true, true, true); }
+static void _runSetOperationMode(void) { _hapDrive->setOperationMode(DRO_MODE); }
+static void _runGetOperationMode(void) { _hapDrive->getOperationMode(); }
+static void _runDefaultMotor(void) { _hapDrive->defaultMotor(); }
+static void _runSetMotor(void) { _hapDrive->setMotor(_settings); }
+static void _runGetSettings(void) { _hapDrive->getSettings(); }
+static void _runSetActuatorABSVolt(void) { _hapDrive->setActuatorABSVolt(_settings.absVolt); }
+static void _runGetActuatorABSVolt(void) { _hapDrive->getActuatorABSVolt(); }
+static void _runSetActuatorNOMVolt(void) { _hapDrive->setActuatorNOMVolt(_settings.nomVolt); }
+static void _runGetActuatorNOMVolt(void) { _hapDrive->getActuatorNOMVolt(); }
+static void _runSetActuatorIMAX(void) { _hapDrive->setActuatorIMAX(_settings.currMax); }
+static void _runGetActuatorIMAX(void) { _hapDrive->getActuatorIMAX(); }
+static void _runSetActuatorImpedance(void) { _hapDrive->setActuatorImpedance(_settings.impedance); }
+static void _runGetActuatorImpedance(void) { _hapDrive->getActuatorImpedance(); }
+static void _runReadImpAdjus(void) { _hapDrive->readImpAdjus(); }
+static void _runSetActuatorLRAfreq(void) { _hapDrive->setActuatorLRAfreq(_settings.lraFreq); }
+static void _runEnableCoinERM(void) { _hapDrive->enableCoinERM(); }
+static void _runEnableAcceleration(void) { _hapDrive->enableAcceleration(true); }
+static void _runEnableRapidStop(void) { _hapDrive->enableRapidStop(true); }
+static void _runEnableAmpPid(void) { _hapDrive->enableAmpPid(true); }
+static void _runEnableFreqTrack(void) { _hapDrive->enableFreqTrack(true); }
+static void _runSetBemfFaultLimit(void) { _hapDrive->setBemfFaultLimit(true); }
+static void _runEnableV2iFactorFreeze(void) { _hapDrive->enableV2iFactorFreeze(true); }
+static void _runCalibrateImpedanceDistance(void) { _hapDrive->calibrateImpedanceDistance(true); }
+static void _runSetVibrate(void) { _hapDrive->setVibrate(60); }
+static void _runStreamAmplitudes(void) { _hapDrive->streamAmplitudes(_envelope, sizeof(_envelope), 2500); }
+static void _runGetVibrate(void) { _hapDrive->getVibrate(); }
+static void _runGetFullBrake(void) { _hapDrive->getFullBrake(); }
+static void _runSetMask(void) { _hapDrive->setMask(0x00); }
+static void _runGetMask(void) { _hapDrive->getMask(); }
+static void _runSetFullBrake(void) { _hapDrive->setFullBrake(3); }
+static void _runSetBemf(void) { _hapDrive->setBemf(1); }
+static void _runGetBemf(void) { _hapDrive->getBemf(); }
+static void _runCreateHeader(void) { _hapDrive->createHeader(1, 1); }
+static void _runClearIrq(void) { _hapDrive->clearIrq(E_SEQ_DONE); }
+static void _runAddSnippet(void) { _hapDrive->addSnippet(); }
+static void _runAddSnippets(void)
+{
+    uint8_t snippets[] = {0x82, 0x24, 0x86};
+    _hapDrive->addSnippet(snippets, sizeof(snippets));
+}
+
+// All 15 snippets in one call, more than the Wire buffer takes in one write;
+// every sequence has to play its own snippet
+static const uint8_t _snippetTable[MAX_SNIPPETS] = {0x82, 0x24, 0x86, 0x18, 0x9A, 0x2C, 0x8E, 0x31,
+                                                    0x83, 0x25, 0x87, 0x19, 0x9B, 0x2D, 0x8F};
+
+static void _runAddSnippetTable(void)
+{
+    uint8_t snippets[MAX_SNIPPETS];
+    memcpy(snippets, _snippetTable, sizeof(snippets));
+    _hapDrive->addSnippet(snippets, MAX_SNIPPETS);
+
+    uint8_t intact = 0;
+    for (uint8_t k = 0; k < MAX_SNIPPETS; k++)
+    {
+        da7280sim_sequence_t seq;
+        if (da7280sim_decodeSequence(bench_device, k, &seq) && seq.numFrames == 1 &&
+            seq.frames[0].snippetId == k + 1 && seq.frames[0].pwlCount == 1 &&
+            bench_device->regs[NUM_SNIPPETS_REG + seq.frames[0].pwlFirst] == _snippetTable[k])
+            intact++;
+    }
+    if (intact != MAX_SNIPPETS)
+    {
+        fprintf(stderr, "Haptic_Driver: %u of %d snippets read back intact\n", (unsigned)intact, MAX_SNIPPETS);
+        bench_checkFailed = true;
+    }
+}
+static void _runEraseWaveformMemory(void) { _hapDrive->eraseWaveformMemory(0); }
+static void _runGetIrqEvent(void) { _hapDrive->getIrqEvent(); }
+static void _runGetEventDiag(void) { _hapDrive->getEventDiag(); }
+static void _runGetIrqStatus(void) { _hapDrive->getIrqStatus(); }
+static void _runGetIrqSnapshot(void)
+{
+    irqSnapshot irq;
+    _hapDrive->getIrqSnapshot(irq);
+}
+static void _runPlayFromMemory(void) { _hapDrive->playFromMemory(true); }
+static void _runSetSeqControl(void) { _hapDrive->setSeqControl(1, 0); }
+static void _runAddFrame(void) { _hapDrive->addFrame(0, 3, 1); }
+static void _runLoadSequence(void) { _hapDrive->loadSequence(_effectA); }
+
+// One snippet of 95 PWL bytes and a one frame sequence, the whole memory
+static uint8_t _fullImage[TOTAL_MEM_REGISTERS];
+
+static void _buildFullImage(void)
+{
+    _fullImage[0] = 1;
+    _fullImage[1] = 1;
+    _fullImage[2] = NUM_SNIPPETS_REG + TOTAL_MEM_REGISTERS - 2;
+    _fullImage[3] = NUM_SNIPPETS_REG + TOTAL_MEM_REGISTERS - 1;
+    for (uint8_t i = 4; i < TOTAL_MEM_REGISTERS - 1; i++)
+        _fullImage[i] = 0x10 | (i & 0x0F);
+    _fullImage[TOTAL_MEM_REGISTERS - 1] = 0x01;
+}
+
+// Every byte has to arrive, whatever the Wire buffer takes per write
+static void _runLoadFullImage(void)
+{
+    _hapDrive->loadSequence(_fullImage);
+    if (memcmp(&bench_device->regs[NUM_SNIPPETS_REG], _fullImage, TOTAL_MEM_REGISTERS) != 0)
+    {
+        fprintf(stderr, "Haptic_Driver: 100 byte image did not read back intact\n");
+        bench_checkFailed = true;
+    }
+}
+static void _runPlaySequence(void) { _hapDrive->playSequence(_effectA); }
+static void _runSwitchSequence(void) { _hapDrive->playSequence(_effectB); }
+static void _loadSequences(void)
+{
+    _hapDrive->playSequence(_effectB);
+    _hapDrive->playSequence(_effectA);
+}
+static void _runVerifyWaveformMemory(void) { _hapDrive->verifyWaveformMemory(); }
+
+// Both effects loaded, then one byte of each flipped in the device
+static void _corruptSequences(void)
+{
+    _loadSequences();
+    bench_device->regs[NUM_SNIPPETS_REG + 10] ^= 0x01;
+    bench_device->regs[NUM_SNIPPETS_REG + 16] ^= 0x01;
+}
+static void _runMapGpiSequence(void) { _hapDrive->mapGpiSequence(0, 1, GPI_FALLING_EDGE); }
+static void _runMapGpiImage(void) { _hapDrive->mapGpiImage(2, _effectA, GPI_BOTH_EDGES); }
+
+// _effectA on GPI2, armed in ETWM mode
+static void _armGpiImage(void)
+{
+    _hapDrive->mapGpiImage(2, _effectA, GPI_BOTH_EDGES);
+    _hapDrive->setOperationMode(ETWM_MODE);
+}
+
+// Ten pulses on GPI2, both edges start the effect from the IC itself;
+// nothing may go over the bus
+#define GPI_PULSES 10
+
+static void _runGpiTrigger(void)
+{
+    for (int i = 0; i < GPI_PULSES; i++)
+    {
+        da7280sim_setGpi(bench_device, 2, true);
+        da7280sim_setGpi(bench_device, 2, false);
+    }
+    if (bench_device->gpiStarts != 2 * GPI_PULSES || bench_device->lastSequence.fault != 0)
+    {
+        fprintf(stderr, "Haptic_Driver: %u of %d GPI edges started the effect\n",
+                (unsigned)bench_device->gpiStarts, 2 * GPI_PULSES);
+        bench_checkFailed = true;
+    }
+}
+
+static const bench_case_t _cases[] = {
+    {"begin", false, _runBegin, nullptr},
+    {"setActuatorType", true, _runSetActuatorType, nullptr},
+    {"writeFields", true, _runWriteFields, nullptr},
+    {"setOperationMode", true, _runSetOperationMode, nullptr},
+    {"getOperationMode", true, _runGetOperationMode, nullptr},
+    {"defaultMotor", true, _runDefaultMotor, nullptr},
+    {"setMotor", true, _runSetMotor, nullptr},
+    {"getSettings", true, _runGetSettings, nullptr},
+    {"setActuatorABSVolt", true, _runSetActuatorABSVolt, nullptr},
+    {"getActuatorABSVolt", true, _runGetActuatorABSVolt, nullptr},
+    {"setActuatorNOMVolt", true, _runSetActuatorNOMVolt, nullptr},
+    {"getActuatorNOMVolt", true, _runGetActuatorNOMVolt, nullptr},
+    {"setActuatorIMAX", true, _runSetActuatorIMAX, nullptr},
+    {"getActuatorIMAX", true, _runGetActuatorIMAX, nullptr},
+    {"setActuatorImpedance", true, _runSetActuatorImpedance, nullptr},
+    {"getActuatorImpedance", true, _runGetActuatorImpedance, nullptr},
+    {"readImpAdjus", true, _runReadImpAdjus, nullptr},
+    {"setActuatorLRAfreq", true, _runSetActuatorLRAfreq, nullptr},
+    {"enableCoinERM", true, _runEnableCoinERM, nullptr},
+    {"enableAcceleration", true, _runEnableAcceleration, nullptr},
+    {"enableRapidStop", true, _runEnableRapidStop, nullptr},
+    {"enableAmpPid", true, _runEnableAmpPid, nullptr},
+    {"enableFreqTrack", true, _runEnableFreqTrack, nullptr},
+    {"setBemfFaultLimit", true, _runSetBemfFaultLimit, nullptr},
+    {"enableV2iFactorFreeze", true, _runEnableV2iFactorFreeze, nullptr},
+    {"calibrateImpedanceDistance", true, _runCalibrateImpedanceDistance, nullptr},
+    {"setVibrate", true, _runSetVibrate, nullptr},
+    {"streamAmplitudes", true, _runStreamAmplitudes, nullptr},
+    {"getVibrate", true, _runGetVibrate, nullptr},
+    {"getFullBrake", true, _runGetFullBrake, nullptr},
+    {"setMask", true, _runSetMask, nullptr},
+    {"getMask", true, _runGetMask, nullptr},
+    {"setFullBrake", true, _runSetFullBrake, nullptr},
+    {"setBemf", true, _runSetBemf, nullptr},
+    {"getBemf", true, _runGetBemf, nullptr},
+    {"createHeader", true, _runCreateHeader, nullptr},
+    {"clearIrq", true, _runClearIrq, nullptr},
+    {"addSnippet", true, _runAddSnippet, nullptr},
+    {"addSnippet[]", true, _runAddSnippets, nullptr},
+    {"addSnippet[15]", true, _runAddSnippetTable, nullptr},
+    {"eraseWaveformMemory", true, _runEraseWaveformMemory, nullptr},
+    {"getIrqEvent", true, _runGetIrqEvent, nullptr},
+    {"getEventDiag", true, _runGetEventDiag, nullptr},
+    {"getIrqStatus", true, _runGetIrqStatus, nullptr},
+    {"getIrqSnapshot", true, _runGetIrqSnapshot, nullptr},
+    {"playFromMemory", true, _runPlayFromMemory, nullptr},
+    {"setSeqControl", true, _runSetSeqControl, nullptr},
+    {"addFrame", true, _runAddFrame, nullptr},
+    {"loadSequence", true, _runLoadSequence, nullptr},
+    {"loadSequence (100 bytes)", true, _runLoadFullImage, _buildFullImage},
+    {"playSequence (resident)", true, _runPlaySequence, _loadSequences},
+    {"playSequence (switch)", true, _runSwitchSequence, _loadSequences},
+    {"verifyWaveformMemory", true, _runVerifyWaveformMemory, _loadSequences},
+    {"verifyWaveformMemory (bad)", true, _runVerifyWaveformMemory, _corruptSequences},
+    {"mapGpiSequence", true, _runMapGpiSequence, nullptr},
+    {"mapGpiImage", true, _runMapGpiImage, nullptr},
+    {"GPI trigger x10 (ETWM)", true, _runGpiTrigger, _armGpiImage},
+};
+
+extern "C" const bench_suite_t bench_hapticDriverSuite = {
+    "Haptic_Driver", _cases, sizeof(_cases) / sizeof(_cases[0]), _attach, _begin};
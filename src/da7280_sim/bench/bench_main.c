@@ -0,0 +1,283 @@
+/* Runs every public call of both DA7280 driver APIs against the simulated
+ * bus and reports I2C transactions, bytes on the wire and bus time at
+ * 100 kHz, 400 kHz and 1 MHz.
+ *
+ *   da7280_bench                       table on stdout
+ *   da7280_bench --json                JSON, the format of bench_baseline.json
+ *   da7280_bench --baseline FILE       exits with 1 if any call needs more
+ *                                      transactions or bytes than in FILE
+ *
+ * Exits with 1 as well if a case leaves the device in the wrong state.
+ *
+ * See the Host Simulation section of the README for the build.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include "bench.h"
+#include "da7280_sim.h"
+#include "da7280_nirq_config.h"
+#include "em_gpio.h"
+
+#define NUM_CLOCKS      3
+#define MAX_NAME_LEN    64
+#define MAX_LINE_LEN    512
+
+typedef struct
+{
+    const char *api;
+    const char *call;
+    uint32_t    transactions;
+    uint32_t    bytes;
+    uint64_t    busTimeNs[NUM_CLOCKS];
+} bench_result_t;
+
+static const uint32_t _clocks[NUM_CLOCKS] = { 100000, 400000, 1000000 };
+static const bench_suite_t *_suites[] = { &bench_cSuite, &bench_hapticDriverSuite };
+
+da7280sim_t *bench_device = NULL;
+bool bench_checkFailed = false;
+
+static void _onNIrqChanged(void *ctx, bool asserted)
+{
+    (void)ctx;
+    simgpio_setInput(DA7280_NIRQ_PORT, DA7280_NIRQ_PIN, !asserted);
+}
+
+static bool _runCase(const bench_suite_t *suite, const bench_case_t *benchCase, bench_result_t *result)
+{
+    result->api  = suite->api;
+    result->call = benchCase->name;
+
+    for (size_t c = 0; c < NUM_CLOCKS; c++)
+    {
+        simbus_t bus;
+        da7280sim_t dev;
+
+        simclock_reset();
+        simbus_init(&bus, _clocks[c]);
+        da7280sim_init(&dev, 0x4A);
+        simbus_attach(&bus, &dev);
+        simgpio_reset();
+        dev.nIrqChanged = _onNIrqChanged;
+        bench_device = &dev;
+
+        suite->attach(simbus_transport(&bus));
+        if (benchCase->needsBegin && !suite->begin())
+        {
+            fprintf(stderr, "%s: begin() failed before %s\n", suite->api, benchCase->name);
+            return false;
+        }
+
+        if (benchCase->setup != NULL)
+        {
+            benchCase->setup();
+        }
+
+        simbus_resetStats(&bus);
+        benchCase->run();
+
+        // Transactions and bytes do not depend on the clock
+        result->transactions = bus.stats.transactions;
+        result->bytes        = bus.stats.bytes;
+        result->busTimeNs[c] = bus.stats.busTimeNs;
+    }
+    return true;
+}
+
+static void _printTable(const bench_result_t *results, size_t count)
+{
+    printf("%-14s %-28s %6s %7s %12s %12s %12s\n",
+           "api", "call", "trans", "bytes", "us@100kHz", "us@400kHz", "us@1MHz");
+    for (size_t i = 0; i < count; i++)
+    {
+        const bench_result_t *r = &results[i];
+        printf("%-14s %-28s %6u %7u %12.1f %12.1f %12.1f\n",
+               r->api, r->call, (unsigned)r->transactions, (unsigned)r->bytes,
+               r->busTimeNs[0] / 1000.0, r->busTimeNs[1] / 1000.0, r->busTimeNs[2] / 1000.0);
+    }
+}
+
+static void _printJson(const bench_result_t *results, size_t count)
+{
+    printf("[\n");
+    for (size_t i = 0; i < count; i++)
+    {
+        const bench_result_t *r = &results[i];
+        printf("  {\"api\": \"%s\", \"call\": \"%s\", \"transactions\": %u, \"bytes\": %u, "
+               "\"us_100k\": %.1f, \"us_400k\": %.1f, \"us_1m\": %.1f}%s\n",
+               r->api, r->call, (unsigned)r->transactions, (unsigned)r->bytes,
+               r->busTimeNs[0] / 1000.0, r->busTimeNs[1] / 1000.0, r->busTimeNs[2] / 1000.0,
+               (i + 1 < count) ? "," : "");
+    }
+    printf("]\n");
+}
+
+static bool _jsonString(const char *line, const char *key, char *out, size_t outLen)
+{
+    char pattern[MAX_NAME_LEN];
+    snprintf(pattern, sizeof(pattern), "\"%s\": \"", key);
+
+    const char *start = strstr(line, pattern);
+    if (start == NULL)
+    {
+        return false;
+    }
+    start += strlen(pattern);
+
+    const char *end = strchr(start, '"');
+    if (end == NULL || (size_t)(end - start) >= outLen)
+    {
+        return false;
+    }
+    memcpy(out, start, end - start);
+    out[end - start] = '\0';
+    return true;
+}
+
+static bool _jsonUint(const char *line, const char *key, uint32_t *out)
+{
+    char pattern[MAX_NAME_LEN];
+    snprintf(pattern, sizeof(pattern), "\"%s\": ", key);
+
+    const char *start = strstr(line, pattern);
+    if (start == NULL)
+    {
+        return false;
+    }
+    *out = (uint32_t)strtoul(start + strlen(pattern), NULL, 10);
+    return true;
+}
+
+// Baseline entries are one object per line, as written by --json
+static int _compareBaseline(const char *path, const bench_result_t *results, size_t count)
+{
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL)
+    {
+        fprintf(stderr, "cannot open baseline %s\n", path);
+        return 2;
+    }
+
+    bool *seen = calloc(count, sizeof(bool));
+    int regressions = 0;
+    char line[MAX_LINE_LEN];
+
+    while (fgets(line, sizeof(line), fp) != NULL)
+    {
+        char api[MAX_NAME_LEN];
+        char call[MAX_NAME_LEN];
+        uint32_t transactions;
+        uint32_t bytes;
+
+        if (!_jsonString(line, "api", api, sizeof(api)) || !_jsonString(line, "call", call, sizeof(call)) ||
+            !_jsonUint(line, "transactions", &transactions) || !_jsonUint(line, "bytes", &bytes))
+        {
+            continue;
+        }
+
+        for (size_t i = 0; i < count; i++)
+        {
+            const bench_result_t *r = &results[i];
+            if (strcmp(r->api, api) != 0 || strcmp(r->call, call) != 0)
+            {
+                continue;
+            }
+            seen[i] = true;
+
+            if (r->transactions > transactions || r->bytes > bytes)
+            {
+                printf("REGRESSION %s.%s: %u transactions / %u bytes, baseline %u / %u\n",
+                       api, call, (unsigned)r->transactions, (unsigned)r->bytes,
+                       (unsigned)transactions, (unsigned)bytes);
+                regressions++;
+            }
+            else if (r->transactions < transactions || r->bytes < bytes)
+            {
+                printf("improved   %s.%s: %u transactions / %u bytes, baseline %u / %u\n",
+                       api, call, (unsigned)r->transactions, (unsigned)r->bytes,
+                       (unsigned)transactions, (unsigned)bytes);
+            }
+        }
+    }
+    fclose(fp);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        if (!seen[i])
+        {
+            printf("new        %s.%s: %u transactions / %u bytes\n",
+                   results[i].api, results[i].call,
+                   (unsigned)results[i].transactions, (unsigned)results[i].bytes);
+        }
+    }
+    free(seen);
+
+    printf("%d regression(s) against %s\n", regressions, path);
+    return (regressions > 0) ? 1 : 0;
+}
+
+int main(int argc, char *argv[])
+{
+    bool json = false;
+    const char *baseline = NULL;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--json") == 0)
+        {
+            json = true;
+        }
+        else if (strcmp(argv[i], "--baseline") == 0 && i + 1 < argc)
+        {
+            baseline = argv[++i];
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s [--json] [--baseline FILE]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    size_t total = 0;
+    for (size_t s = 0; s < sizeof(_suites) / sizeof(_suites[0]); s++)
+    {
+        total += _suites[s]->numCases;
+    }
+
+    bench_result_t *results = calloc(total, sizeof(bench_result_t));
+    size_t count = 0;
+
+    for (size_t s = 0; s < sizeof(_suites) / sizeof(_suites[0]); s++)
+    {
+        const bench_suite_t *suite = _suites[s];
+        for (size_t i = 0; i < suite->numCases; i++)
+        {
+            if (!_runCase(suite, &suite->cases[i], &results[count]))
+            {
+                free(results);
+                return 2;
+            }
+            count++;
+        }
+    }
+
+    int ret = 0;
+    if (baseline != NULL)
+    {
+        ret = _compareBaseline(baseline, results, count);
+    }
+    else if (json)
+    {
+        _printJson(results, count);
+    }
+    else
+    {
+        _printTable(results, count);
+    }
+
+    free(results);
+    return bench_checkFailed ? 1 : ret;
+}
@@ -0,0 +1,673 @@
+#include "da7280_sim.h"
+
+#include <string.h>
+
+#define SIM_E_SEQ_DONE          0x04    // IRQ_EVENT1
+#define SIM_E_SEQ_FAULT         0x10
+#define SIM_E_MEM_FAULT         0x40    // IRQ_EVENT_SEQ_DIAG
+#define SIM_E_SEQ_ID_FAULT      0x80
+#define SIM_RTWM_MODE           0x03
+#define SIM_ETWM_MODE           0x04
+#define SIM_GPI_BOTH_EDGES      0x02
+
+static uint64_t _nowNs = 0;
+static void (*_advanceHook)(uint64_t fromNs, uint64_t toNs) = NULL;
+
+// Devices with a sequence playing, E_SEQ_DONE is latched as the clock passes its end
+#define MAX_PLAYING             16
+static da7280sim_t *_playing[MAX_PLAYING];
+static size_t       _numPlaying = 0;
+
+// Frame timebases for FREQ_WAVEFORM_TIMEBASE = 0 and 1
+static const uint32_t _timeBaseUs[2][4] = {
+    { 5440, 21760, 43520, 87040 },
+    { 1360, 5440, 21760, 43520 }
+};
+// GAIN 0 dB, -6 dB, -12 dB and -18 dB
+static const float _gain[4] = { 1.0f, 0.5012f, 0.2512f, 0.1259f };
+
+static void _stopPlaying(da7280sim_t *dev)
+{
+    for (size_t i = 0; i < _numPlaying; i++)
+    {
+        if (_playing[i] == dev)
+        {
+            _playing[i] = _playing[--_numPlaying];
+            return;
+        }
+    }
+}
+
+static void _startSequence(da7280sim_t *dev, uint8_t seqId, uint8_t plays)
+{
+    dev->lastStartNs = _nowNs;
+    _stopPlaying(dev);
+    if (!da7280sim_decodeSequence(dev, seqId, &dev->lastSequence))
+    {
+        dev->regs[SIM_IRQ_EVENT_SEQ_DIAG] |= dev->lastSequence.fault;
+        dev->regs[SIM_IRQ_EVENT1] |= SIM_E_SEQ_FAULT;
+        dev->regs[SIM_IRQ_STATUS1] |= SIM_E_SEQ_FAULT;
+        return;
+    }
+    dev->seqEndNs = _nowNs + (uint64_t)dev->lastSequence.durationUs * plays * 1000u;
+    if (_numPlaying < MAX_PLAYING)
+    {
+        _playing[_numPlaying++] = dev;
+    }
+}
+
+// Latches E_SEQ_DONE on every device whose sequence ended by the current time
+static void _finishSequences(void)
+{
+    for (size_t i = 0; i < _numPlaying; )
+    {
+        da7280sim_t *dev = _playing[i];
+        if (dev->seqEndNs > _nowNs)
+        {
+            i++;
+            continue;
+        }
+        _playing[i] = _playing[--_numPlaying];
+        dev->seqDone++;
+        da7280sim_raiseIrq(dev, SIM_E_SEQ_DONE);
+    }
+}
+
+static bool _isReadOnly(uint8_t reg)
+{
+    switch (reg)
+    {
+    case SIM_CHIP_REV_REG:
+    case SIM_IRQ_STATUS1:
+    case SIM_CALIB_IMP_H:
+    case SIM_CALIB_IMP_L:
+    case SIM_ADC_DATA_H1:
+    case SIM_ADC_DATA_L1:
+    case SIM_IRQ_STATUS2:
+        return true;
+    default:
+        // LRA_AVR_H..FRQ_PHASE_L are results of the frequency tracking loop
+        return (reg >= SIM_LRA_AVR_H && reg <= SIM_FRQ_PHASE_L);
+    }
+}
+
+static void _writeReg(da7280sim_t *dev, uint8_t reg, uint8_t value)
+{
+    if (_isReadOnly(reg))
+    {
+        return;
+    }
+
+    switch (reg)
+    {
+    case SIM_IRQ_EVENT1:
+    case SIM_IRQ_EVENT_WARN_DIAG:
+    case SIM_IRQ_EVENT_SEQ_DIAG:
+    case SIM_IRQ_EVENT_ACTUATOR_FAULT:
+        // Write 1 to clear
+        dev->regs[reg] &= ~value;
+        return;
+    case SIM_TOP_CTL1:
+        // SEQ_START triggers the selected sequence, PS_SEQ_LOOP + 1 times,
+        // in RTWM and ETWM mode and reads back as 0. Leaving those modes
+        // stops the sequence without E_SEQ_DONE.
+        if (value & 0x10)
+        {
+            dev->seqStarts++;
+        }
+        dev->regs[reg] = value & ~0x10;
+        if ((value & 0x07) != SIM_RTWM_MODE && (value & 0x07) != SIM_ETWM_MODE)
+        {
+            _stopPlaying(dev);
+        }
+        else if (value & 0x10)
+        {
+            _startSequence(dev, dev->regs[SIM_SEQ_CTL2] & 0x0F, (uint8_t)((dev->regs[SIM_SEQ_CTL2] >> 4) + 1));
+        }
+        return;
+    case SIM_TOP_CTL2:
+        dev->amplitudeWrites++;
+        dev->regs[reg] = value;
+        if (dev->amplitudeWritten != NULL)
+        {
+            dev->amplitudeWritten(dev->amplitudeCtx, value);
+        }
+        return;
+    default:
+        break;
+    }
+
+    if (reg >= DA7280SIM_MEM_FIRST && reg <= DA7280SIM_MEM_LAST &&
+        !(dev->regs[SIM_MEM_CTL2] & 0x80))
+    {
+        // WAV_MEM_LOCK
+        dev->droppedMemWrites++;
+        return;
+    }
+    dev->regs[reg] = value;
+}
+
+static void _notifyNIrq(da7280sim_t *dev, bool before)
+{
+    bool after = da7280sim_nIrqAsserted(dev);
+
+    if (after != before && dev->nIrqChanged != NULL)
+    {
+        dev->nIrqChanged(dev->nIrqCtx, after);
+    }
+}
+
+static void _write(da7280sim_t *dev, const uint8_t *data, size_t len)
+{
+    bool nIrqBefore = da7280sim_nIrqAsserted(dev);
+
+    if (len < 2)
+    {
+        // Address only, or just the register pointer
+        return;
+    }
+
+    if (dev->regs[SIM_CIF_I2C1] & 0x80)
+    {
+        // Non-consecutive: register/value pairs
+        for (size_t i = 0; i + 1 < len; i += 2)
+        {
+            _writeReg(dev, data[i], data[i + 1]);
+        }
+    }
+    else
+    {
+        // Consecutive: the register pointer increments after every byte
+        uint8_t reg = data[0];
+        for (size_t i = 1; i < len; i++)
+        {
+            _writeReg(dev, reg++, data[i]);
+        }
+    }
+    _notifyNIrq(dev, nIrqBefore);
+}
+
+static void _read(da7280sim_t *dev, uint8_t reg, uint8_t *data, size_t len)
+{
+    for (size_t i = 0; i < len; i++)
+    {
+        data[i] = dev->regs[(uint8_t)(reg + i)];
+    }
+}
+
+// Devices at addr that see the bus, those behind the mux on an enabled channel
+static size_t _findDevices(simbus_t *bus, uint8_t addr, da7280sim_t *found[])
+{
+    size_t n = 0;
+
+    for (size_t i = 0; i < bus->numDevices; i++)
+    {
+        bool visible = (bus->channels[i] == SIMBUS_NO_MUX_CHANNEL) || (bus->muxChannels & (1u << bus->channels[i]));
+        if (bus->devices[i]->address == addr && visible)
+        {
+            found[n++] = bus->devices[i];
+        }
+    }
+    return n;
+}
+
+static void _account(simbus_t *bus, size_t wlen, size_t rlen, bool withRead)
+{
+    uint64_t ns = simbus_transferTimeNs(bus->clockHz, wlen, rlen, withRead);
+
+    bus->stats.transactions++;
+    bus->stats.bytes += 1 + wlen + (withRead ? 1 + rlen : 0);
+    bus->stats.busTimeNs += ns;
+    simclock_advanceNs(ns);
+}
+
+static int _busWrite(void *ctx, uint8_t addr, const uint8_t *data, size_t len)
+{
+    simbus_t *bus = (simbus_t *)ctx;
+    da7280sim_t *found[SIMBUS_MAX_DEVICES];
+    size_t n = _findDevices(bus, addr, found);
+
+    if (bus->muxAddress != 0 && addr == bus->muxAddress)
+    {
+        _account(bus, len, 0, false);
+        if (len > 0)
+        {
+            bus->muxChannels = data[len - 1];
+        }
+        return 0;
+    }
+    if (n == 0)
+    {
+        // Address NACK, only the address byte went out
+        _account(bus, 0, 0, false);
+        bus->stats.nacks++;
+        return -1;
+    }
+
+    _account(bus, len, 0, false);
+    for (size_t i = 0; i < n; i++)
+    {
+        _write(found[i], data, len);
+    }
+    return 0;
+}
+
+static int _busWriteRead(void *ctx, uint8_t addr, const uint8_t *wdata, size_t wlen, uint8_t *rdata, size_t rlen)
+{
+    simbus_t *bus = (simbus_t *)ctx;
+    da7280sim_t *found[SIMBUS_MAX_DEVICES];
+    size_t n = _findDevices(bus, addr, found);
+    uint8_t reg = 0;
+
+    if (bus->muxAddress != 0 && addr == bus->muxAddress)
+    {
+        _account(bus, wlen, rlen, wlen > 0);
+        memset(rdata, bus->muxChannels, rlen);
+        return 0;
+    }
+    if (n == 0)
+    {
+        _account(bus, 0, 0, false);
+        bus->stats.nacks++;
+        return -1;
+    }
+
+    if (wlen == 0)
+    {
+        // Plain read continues from the current register pointer, which the
+        // model does not track; reads start at register 0
+        _account(bus, rlen, 0, false);
+    }
+    else
+    {
+        _account(bus, wlen, rlen, true);
+        reg = (uint8_t)(wdata[0] + wlen - 1);
+    }
+
+    memset(rdata, 0xFF, rlen);
+    for (size_t i = 0; i < n; i++)
+    {
+        uint8_t data[256];
+        if (wlen > 0)
+        {
+            _write(found[i], wdata, wlen);
+        }
+        _read(found[i], reg, data, rlen);
+        for (size_t j = 0; j < rlen; j++)
+        {
+            rdata[j] &= data[j];
+        }
+    }
+    return 0;
+}
+
+void da7280sim_init(da7280sim_t *dev, uint8_t address)
+{
+    _stopPlaying(dev);
+    memset(dev, 0, sizeof(*dev));
+    dev->address = address;
+
+    // Power-on values as documented next to the driver setters
+    dev->regs[SIM_CHIP_REV_REG] = 0xBA;
+    dev->regs[SIM_CIF_I2C1]     = 0x08;
+    dev->regs[0x0C]             = 0x5A;     // ACTUATOR1, 2.106 V
+    dev->regs[0x0D]             = 0x78;     // ACTUATOR2, 2.808 V
+    dev->regs[0x0E]             = 0x17;     // ACTUATOR3, 198 mA
+    dev->regs[0x0F]             = 0x01;     // CALIB_V2I_H
+    dev->regs[0x10]             = 0x0D;     // CALIB_V2I_L
+    dev->regs[0x13]             = 0x16;     // TOP_CFG1, acceleration, rapid stop, BEMF fault limit
+    dev->regs[0x16]             = 0x40;     // TOP_CFG4
+    dev->regs[0x17]             = 0x01;     // TOP_INT_CFG1, 4.9 mV
+    dev->regs[SIM_SEQ_CTL1]     = 0x08;
+    dev->regs[SIM_MEM_CTL1]     = DA7280SIM_MEM_FIRST;  // WAV_MEM_BASE_ADDR
+    dev->regs[SIM_MEM_CTL2]     = 0x80;     // WAV_MEM_LOCK, unlocked
+}
+
+void da7280sim_raiseIrq(da7280sim_t *dev, uint8_t events)
+{
+    bool nIrqBefore = da7280sim_nIrqAsserted(dev);
+
+    dev->regs[SIM_IRQ_EVENT1] |= events;
+    dev->regs[SIM_IRQ_STATUS1] |= events;
+    _notifyNIrq(dev, nIrqBefore);
+}
+
+bool da7280sim_nIrqAsserted(const da7280sim_t *dev)
+{
+    return (dev->regs[SIM_IRQ_EVENT1] & ~dev->regs[SIM_IRQ_MASK1]) != 0;
+}
+
+void da7280sim_setGpi(da7280sim_t *dev, uint8_t gpi, bool level)
+{
+    if (gpi >= DA7280SIM_NUM_GPI || dev->gpiLevel[gpi] == level)
+    {
+        return;
+    }
+    dev->gpiLevel[gpi] = level;
+
+    // GPIx_POLARITY: 0 rising, 1 falling, 2 both edges
+    uint8_t ctl = dev->regs[SIM_GPI_0_CTL + gpi];
+    uint8_t polarity = ctl & 0x03;
+    bool    matches = (polarity == SIM_GPI_BOTH_EDGES) || (polarity == (level ? 0 : 1));
+    if ((dev->regs[SIM_TOP_CTL1] & 0x07) != SIM_ETWM_MODE || !matches)
+    {
+        return;
+    }
+
+    bool nIrqBefore = da7280sim_nIrqAsserted(dev);
+    dev->gpiStarts++;
+    _startSequence(dev, (ctl >> 3) & 0x0F, 1);
+    _notifyNIrq(dev, nIrqBefore);
+}
+
+static bool _memFault(da7280sim_sequence_t *seq, uint8_t fault)
+{
+    seq->fault = fault;
+    return false;
+}
+
+static float _pwlLevel(uint8_t pwl, bool accelerated)
+{
+    int amp = pwl & 0x0F;
+
+    if (accelerated)
+    {
+        return amp / 15.0f;
+    }
+    // Two's complement, -8 is played as -7
+    amp = (amp & 0x08) ? amp - 16 : amp;
+    return ((amp < -7) ? -7 : amp) / 7.0f;
+}
+
+bool da7280sim_decodeSequence(const da7280sim_t *dev, uint8_t seqId, da7280sim_sequence_t *seq)
+{
+    uint8_t         base        = dev->regs[SIM_MEM_CTL1];
+    const uint8_t  *mem         = &dev->regs[base];
+    bool            accelerated = (dev->regs[SIM_TOP_CFG1] & 0x04) != 0;
+    const uint32_t *timeBaseUs  = _timeBaseUs[(dev->regs[SIM_SEQ_CTL1] >> 2) & 0x01];
+
+    memset(seq, 0, sizeof(*seq));
+    if (base < DA7280SIM_MEM_FIRST || base > DA7280SIM_MEM_LAST - 2)
+    {
+        return _memFault(seq, SIM_E_MEM_FAULT);
+    }
+
+    size_t  memLen       = DA7280SIM_MEM_LAST + 1 - base;
+    uint8_t numSnippets  = mem[0];
+    uint8_t numSequences = mem[1];
+    if (numSnippets > 15 || numSequences > 16 || 2u + numSnippets + numSequences > memLen)
+    {
+        return _memFault(seq, SIM_E_MEM_FAULT);
+    }
+    if (seqId >= numSequences)
+    {
+        return _memFault(seq, SIM_E_SEQ_ID_FAULT);
+    }
+
+    // Regions are snippets 1..n then sequences 0..m-1, each ending at its
+    // end pointer and starting right after the previous one
+    size_t regionEnd[15 + 16];
+    size_t dataStart = 2u + numSnippets + numSequences;
+    for (size_t r = 0; r < (size_t)numSnippets + numSequences; r++)
+    {
+        size_t start = (r == 0) ? dataStart : regionEnd[r - 1] + 1;
+        if (mem[2 + r] < base || (size_t)(mem[2 + r] - base) < start || (size_t)(mem[2 + r] - base) >= memLen)
+        {
+            return _memFault(seq, SIM_E_MEM_FAULT);
+        }
+        regionEnd[r] = mem[2 + r] - base;
+    }
+
+    size_t seqRegion = numSnippets + seqId;
+    size_t pos = (seqRegion == 0) ? dataStart : regionEnd[seqRegion - 1] + 1;
+    size_t end = regionEnd[seqRegion];
+
+    while (pos <= end)
+    {
+        uint8_t byte1 = mem[pos++];
+        uint8_t byte2 = 0;
+
+        // Byte 1 carries COMMAND_TYPE = 0, an optional byte 2 COMMAND_TYPE = 1
+        if ((byte1 & 0x80) || seq->numFrames == DA7280SIM_MAX_FRAMES)
+        {
+            return _memFault(seq, SIM_E_MEM_FAULT);
+        }
+        if (pos <= end && (mem[pos] & 0x80))
+        {
+            byte2 = mem[pos++];
+            if (byte2 & 0x04)
+            {
+                // FREQ_CMD, byte 3 holds FREQ[7:0]
+                if (pos > end)
+                {
+                    return _memFault(seq, SIM_E_MEM_FAULT);
+                }
+                pos++;
+            }
+        }
+
+        da7280sim_frame_t *frame = &seq->frames[seq->numFrames++];
+        frame->snippetId = (byte1 & 0x07) | ((byte2 & 0x01) << 3);
+        frame->gain      = (byte1 >> 5) & 0x03;
+        frame->timeBase  = (byte1 >> 3) & 0x03;
+        frame->loops     = ((byte2 >> 3) & 0x0F) + 1;
+        if (frame->snippetId > numSnippets)
+        {
+            return _memFault(seq, SIM_E_MEM_FAULT);
+        }
+
+        // Snippet 0 is two timebases of silence
+        uint32_t timeBases = 2;
+        float    level     = 0.0f;
+        if (frame->snippetId > 0)
+        {
+            size_t r = frame->snippetId - 1;
+            frame->pwlFirst = (uint8_t)((r == 0) ? dataStart : regionEnd[r - 1] + 1);
+            frame->pwlCount = (uint8_t)(regionEnd[r] + 1 - frame->pwlFirst);
+            timeBases = 0;
+            for (size_t p = frame->pwlFirst; p <= regionEnd[r]; p++)
+            {
+                timeBases += ((mem[p] >> 4) & 0x07) + 1;
+                level      = _pwlLevel(mem[p], accelerated);
+            }
+        }
+        frame->level      = level * _gain[frame->gain];
+        frame->durationUs = timeBases * timeBaseUs[frame->timeBase] * frame->loops;
+        seq->durationUs  += frame->durationUs;
+    }
+    return true;
+}
+
+void da7280sim_loadImage(da7280sim_t *dev, const uint8_t image[], size_t len)
+{
+    uint8_t base = dev->regs[SIM_MEM_CTL1];
+    size_t  memLen = (base >= DA7280SIM_MEM_FIRST && base <= DA7280SIM_MEM_LAST) ? DA7280SIM_MEM_LAST + 1u - base : 0;
+
+    memcpy(&dev->regs[base], image, (len < memLen) ? len : memLen);
+}
+
+static void _addPoint(da7280sim_tracePoint_t points[], size_t maxPoints, size_t *n, uint32_t timeUs, float level)
+{
+    if (*n < maxPoints)
+    {
+        points[*n].timeUs = timeUs;
+        points[*n].level  = level;
+    }
+    (*n)++;
+}
+
+size_t da7280sim_renderSequence(const da7280sim_t *dev, uint8_t seqId, da7280sim_sequence_t *seq,
+                                da7280sim_tracePoint_t points[], size_t maxPoints)
+{
+    if (!da7280sim_decodeSequence(dev, seqId, seq))
+    {
+        return 0;
+    }
+
+    const uint8_t  *mem         = &dev->regs[dev->regs[SIM_MEM_CTL1]];
+    bool            accelerated = (dev->regs[SIM_TOP_CFG1] & 0x04) != 0;
+    const uint32_t *timeBaseUs  = _timeBaseUs[(dev->regs[SIM_SEQ_CTL1] >> 2) & 0x01];
+    uint32_t        now   = 0;
+    float           level = 0.0f;
+    size_t          n     = 0;
+
+    _addPoint(points, maxPoints, &n, 0, 0.0f);
+    for (size_t f = 0; f < seq->numFrames; f++)
+    {
+        const da7280sim_frame_t *frame = &seq->frames[f];
+        uint32_t timeBase = timeBaseUs[frame->timeBase];
+
+        for (uint8_t loop = 0; loop < frame->loops; loop++)
+        {
+            if (frame->pwlCount == 0)
+            {
+                if (level != 0.0f)
+                {
+                    _addPoint(points, maxPoints, &n, now, 0.0f);
+                }
+                level = 0.0f;
+                now  += 2 * timeBase;
+                _addPoint(points, maxPoints, &n, now, level);
+                continue;
+            }
+
+            for (uint8_t p = 0; p < frame->pwlCount; p++)
+            {
+                uint8_t pwl    = mem[frame->pwlFirst + p];
+                float   target = _pwlLevel(pwl, accelerated) * _gain[frame->gain];
+
+                if (!(pwl & 0x80) && target != level)
+                {
+                    // Step, the level jumps before it is held
+                    _addPoint(points, maxPoints, &n, now, target);
+                }
+                level = target;
+                now  += (((pwl >> 4) & 0x07) + 1u) * timeBase;
+                _addPoint(points, maxPoints, &n, now, level);
+            }
+        }
+    }
+    return n;
+}
+
+float da7280sim_traceLevelAt(const da7280sim_tracePoint_t points[], size_t numPoints, uint32_t timeUs)
+{
+    if (numPoints == 0)
+    {
+        return 0.0f;
+    }
+
+    // Last point at or before timeUs, a step resolves to its new level
+    size_t i = 0;
+    while (i + 1 < numPoints && points[i + 1].timeUs <= timeUs)
+    {
+        i++;
+    }
+    if (i + 1 == numPoints)
+    {
+        return points[i].level;
+    }
+
+    const da7280sim_tracePoint_t *a = &points[i];
+    const da7280sim_tracePoint_t *b = &points[i + 1];
+    return a->level + (b->level - a->level) * (float)(timeUs - a->timeUs) / (float)(b->timeUs - a->timeUs);
+}
+
+void simbus_init(simbus_t *bus, uint32_t clockHz)
+{
+    memset(bus, 0, sizeof(*bus));
+    bus->clockHz = clockHz;
+    bus->transport.ctx = bus;
+    bus->transport.write = _busWrite;
+    bus->transport.writeRead = _busWriteRead;
+}
+
+bool simbus_attach(simbus_t *bus, da7280sim_t *dev)
+{
+    for (size_t i = 0; i < bus->numDevices; i++)
+    {
+        if (bus->devices[i]->address == dev->address && bus->channels[i] == SIMBUS_NO_MUX_CHANNEL)
+        {
+            return false;
+        }
+    }
+    return simbus_attachBehindMux(bus, dev, SIMBUS_NO_MUX_CHANNEL);
+}
+
+bool simbus_attachMux(simbus_t *bus, uint8_t address)
+{
+    if (bus->muxAddress != 0 || address == 0)
+    {
+        return false;
+    }
+    bus->muxAddress = address;
+    bus->muxChannels = 0;
+    return true;
+}
+
+bool simbus_attachBehindMux(simbus_t *bus, da7280sim_t *dev, uint8_t channel)
+{
+    if (bus->numDevices >= SIMBUS_MAX_DEVICES || (channel != SIMBUS_NO_MUX_CHANNEL && channel > 7))
+    {
+        return false;
+    }
+    for (size_t i = 0; i < bus->numDevices; i++)
+    {
+        if (bus->channels[i] == channel && channel != SIMBUS_NO_MUX_CHANNEL && bus->devices[i]->address == dev->address)
+        {
+            return false;
+        }
+    }
+    bus->channels[bus->numDevices] = channel;
+    bus->devices[bus->numDevices++] = dev;
+    return true;
+}
+
+const i2c_transport_t *simbus_transport(simbus_t *bus)
+{
+    return &bus->transport;
+}
+
+void simbus_resetStats(simbus_t *bus)
+{
+    memset(&bus->stats, 0, sizeof(bus->stats));
+}
+
+uint64_t simbus_transferTimeNs(uint32_t clockHz, size_t wlen, size_t rlen, bool withRead)
+{
+    uint64_t clocks = 1 + 9 * (1 + wlen) + 1;
+
+    if (withRead)
+    {
+        clocks += 1 + 9 * (1 + rlen);
+    }
+    return (clocks * 1000000000ull + clockHz - 1) / clockHz;
+}
+
+uint64_t simclock_nowNs(void)
+{
+    return _nowNs;
+}
+
+void simclock_advanceNs(uint64_t ns)
+{
+    uint64_t from = _nowNs;
+
+    _nowNs += ns;
+    _finishSequences();
+    if (_advanceHook != NULL)
+    {
+        _advanceHook(from, _nowNs);
+    }
+}
+
+void simclock_onAdvance(void (*hook)(uint64_t fromNs, uint64_t toNs))
+{
+    _advanceHook = hook;
+}
+
+void simclock_reset(void)
+{
+    _nowNs = 0;
+    _numPlaying = 0;
+}
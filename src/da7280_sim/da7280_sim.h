@@ -0,0 +1,197 @@
+#ifndef DA7280_SIM_H
+#define DA7280_SIM_H
+
+/* Register level model of the DA7280 and a simulated I2C bus, used to run
+ * Haptic_Driver and da7280_driver.c on a Linux host. The bus counts
+ * transactions, bytes on the wire and bus time at a configurable clock. */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "i2c_transport.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define DA7280SIM_NUM_REGS      256
+#define DA7280SIM_MEM_FIRST     0x84    // NUM_SNIPPETS_REG
+#define DA7280SIM_MEM_LAST      0xE7    // END_OF_MEM
+#define DA7280SIM_MAX_FRAMES    100     // one byte frames filling the memory
+#define SIMBUS_MAX_DEVICES      8
+#define SIMBUS_NO_MUX_CHANNEL   0xFF
+#define DA7280SIM_NUM_GPI       3
+
+// Registers the model gives a behaviour to
+typedef enum
+{
+    SIM_CHIP_REV_REG            = 0x00,
+    SIM_IRQ_EVENT1              = 0x03,
+    SIM_IRQ_EVENT_WARN_DIAG     = 0x04,
+    SIM_IRQ_EVENT_SEQ_DIAG      = 0x05,
+    SIM_IRQ_STATUS1             = 0x06,
+    SIM_IRQ_MASK1               = 0x07,
+    SIM_CIF_I2C1                = 0x08,
+    SIM_CALIB_IMP_H             = 0x11,
+    SIM_CALIB_IMP_L             = 0x12,
+    SIM_TOP_CFG1                = 0x13,
+    SIM_TOP_CTL1                = 0x22,
+    SIM_TOP_CTL2                = 0x23,
+    SIM_SEQ_CTL1                = 0x24,
+    SIM_SEQ_CTL2                = 0x28,
+    SIM_GPI_0_CTL               = 0x29,
+    SIM_MEM_CTL1                = 0x2C,
+    SIM_MEM_CTL2                = 0x2D,
+    SIM_ADC_DATA_H1             = 0x2E,
+    SIM_ADC_DATA_L1             = 0x2F,
+    SIM_LRA_AVR_H               = 0x44,
+    SIM_FRQ_PHASE_L             = 0x49,
+    SIM_IRQ_EVENT_ACTUATOR_FAULT = 0x81,
+    SIM_IRQ_STATUS2             = 0x82
+} SIM_REGISTERS;
+
+// One frame of a sequence as the IC plays it
+typedef struct
+{
+    uint8_t  snippetId;
+    uint8_t  gain;                          // GAIN[1:0]
+    uint8_t  timeBase;                      // TIMEBASE[1:0]
+    uint8_t  loops;
+    uint32_t durationUs;                    // all loops
+    float    level;                         // last PWL point after gain, -1..1 of full scale
+    uint8_t  pwlFirst;                      // PWL bytes of the snippet, offset from WAV_MEM_BASE_ADDR
+    uint8_t  pwlCount;                      // 0 for the silence snippet
+} da7280sim_frame_t;
+
+typedef struct
+{
+    uint8_t           fault;                // E_MEM_FAULT/E_SEQ_ID_FAULT bit of IRQ_EVENT_SEQ_DIAG, 0 if valid
+    uint8_t           numFrames;
+    uint32_t          durationUs;
+    da7280sim_frame_t frames[DA7280SIM_MAX_FRAMES];
+} da7280sim_sequence_t;
+
+// Corner of an amplitude trace, the level changes linearly up to the next
+// point. Two points with the same time are a step.
+typedef struct
+{
+    uint32_t timeUs;
+    float    level;                         // after gain, -1..1 of full scale
+} da7280sim_tracePoint_t;
+
+typedef struct
+{
+    uint8_t  address;                       // 7-bit
+    uint8_t  regs[DA7280SIM_NUM_REGS];
+
+    uint32_t seqStarts;                     // TOP_CTL1 SEQ_START writes
+    uint32_t amplitudeWrites;               // TOP_CTL2 writes
+    uint32_t droppedMemWrites;              // waveform memory writes while locked
+    uint32_t gpiStarts;                     // sequences started by a GPI edge in ETWM mode
+    bool     gpiLevel[DA7280SIM_NUM_GPI];
+    da7280sim_sequence_t lastSequence;      // decoded by the last SEQ_START in RTWM mode or GPI edge in ETWM mode
+    uint64_t lastStartNs;                   // simclock time of that start
+    uint64_t seqEndNs;                      // when it ends and E_SEQ_DONE is latched
+    uint32_t seqDone;                       // sequences played to the end
+
+    // Called when nIRQ changes level, e.g. to drive a simulated GPIO
+    void   (*nIrqChanged)(void *ctx, bool asserted);
+    void    *nIrqCtx;
+    // Called for every TOP_CTL2 write, at the end of its transaction
+    void   (*amplitudeWritten)(void *ctx, uint8_t level);
+    void    *amplitudeCtx;
+} da7280sim_t;
+
+typedef struct
+{
+    uint32_t transactions;
+    uint32_t bytes;                         // including the address bytes
+    uint64_t busTimeNs;
+    uint32_t nacks;
+} simbus_stats_t;
+
+typedef struct
+{
+    uint32_t        clockHz;
+    da7280sim_t    *devices[SIMBUS_MAX_DEVICES];
+    uint8_t         channels[SIMBUS_MAX_DEVICES];   // mux channel of each device, SIMBUS_NO_MUX_CHANNEL if direct
+    size_t          numDevices;
+    uint8_t         muxAddress;             // 0 without a mux
+    uint8_t         muxChannels;            // enabled, one bit per channel
+    simbus_stats_t  stats;
+    i2c_transport_t transport;
+} simbus_t;
+
+// Puts the device in its power-on state at the given 7-bit address.
+void da7280sim_init(da7280sim_t *dev, uint8_t address);
+
+// Latches events in IRQ_EVENT1 as the IC would on a fault or sequence event.
+void da7280sim_raiseIrq(da7280sim_t *dev, uint8_t events);
+
+// nIRQ is asserted while an unmasked event is pending in IRQ_EVENT1.
+bool da7280sim_nIrqAsserted(const da7280sim_t *dev);
+
+// Drives input gpi of the device. In ETWM mode an edge that matches
+// GPIx_POLARITY starts the sequence of GPIx_SEQUENCE_ID, as SEQ_START does
+// in RTWM mode; no bus is involved. The multi pattern selection of
+// GPIx_MODE is not modelled, every edge plays the sequence of its input.
+void da7280sim_setGpi(da7280sim_t *dev, uint8_t gpi, bool level);
+
+// Decodes sequence seqId from the waveform memory at WAV_MEM_BASE_ADDR,
+// following the format of datasheet section 5.8 independently of the
+// driver's compiler. Honours ACCELERATION_EN and FREQ_WAVEFORM_TIMEBASE.
+// Returns false and sets seq->fault for a corrupt memory or unknown sequence.
+bool da7280sim_decodeSequence(const da7280sim_t *dev, uint8_t seqId, da7280sim_sequence_t *seq);
+
+// Copies a waveform memory image (counts, end pointers, data) to
+// WAV_MEM_BASE_ADDR, WAV_MEM_LOCK aside, e.g. to render it without a driver.
+void da7280sim_loadImage(da7280sim_t *dev, const uint8_t image[], size_t len);
+
+// Renders sequence seqId into the amplitude envelope the IC plays, starting
+// at (0, 0). A step PWL byte jumps to its AMP and holds it for TIME + 1
+// timebases, a ramp reaches AMP after that time from the level before it;
+// the silence snippet holds 0 for two timebases. Every loop of a frame
+// repeats its snippet and ramps carry on from the end of the previous loop
+// or frame. Writes at most maxPoints points and returns how many the whole
+// trace has, 0 if the sequence does not decode; seq receives the frames.
+size_t da7280sim_renderSequence(const da7280sim_t *dev, uint8_t seqId, da7280sim_sequence_t *seq,
+                                da7280sim_tracePoint_t points[], size_t maxPoints);
+
+// Level of a trace at timeUs, the last level after its end.
+float da7280sim_traceLevelAt(const da7280sim_tracePoint_t points[], size_t numPoints, uint32_t timeUs);
+
+void simbus_init(simbus_t *bus, uint32_t clockHz);
+bool simbus_attach(simbus_t *bus, da7280sim_t *dev);
+
+// A TCA9548A style mux at address: a one byte write enables one channel per
+// bit, a read returns them. Devices behind it see the bus only while their
+// channel is enabled, so several can share an address. A write reaches all
+// devices it addresses; a read returns the AND of their registers, as open
+// drain lines would.
+bool simbus_attachMux(simbus_t *bus, uint8_t address);
+bool simbus_attachBehindMux(simbus_t *bus, da7280sim_t *dev, uint8_t channel);
+const i2c_transport_t *simbus_transport(simbus_t *bus);
+void simbus_resetStats(simbus_t *bus);
+
+// Time a transaction takes on the wire: START, 9 clocks per byte (address
+// bytes included), a repeated START for reads and the STOP condition.
+uint64_t simbus_transferTimeNs(uint32_t clockHz, size_t wlen, size_t rlen, bool withRead);
+
+// Virtual clock shared by the bus and the host sleeptimer/Arduino shims.
+// Sequences started by SEQ_START or a GPI edge latch E_SEQ_DONE, and assert
+// nIRQ unless it is masked, when the clock passes their end; a reset forgets
+// the sequences in progress.
+uint64_t simclock_nowNs(void);
+void simclock_advanceNs(uint64_t ns);
+void simclock_reset(void);
+
+// Called after every advance of the clock, for peripherals that run from it
+// such as the host TIMER model. One hook, NULL removes it.
+void simclock_onAdvance(void (*hook)(uint64_t fromNs, uint64_t toNs));
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // DA7280_SIM_H
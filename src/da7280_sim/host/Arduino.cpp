@@ -0,0 +1,22 @@
+#include "Arduino.h"
+#include "da7280_sim.h"
+
+void delay(unsigned long ms)
+{
+    simclock_advanceNs((uint64_t)ms * 1000000ull);
+}
+
+void delayMicroseconds(unsigned int us)
+{
+    simclock_advanceNs((uint64_t)us * 1000ull);
+}
+
+unsigned long millis(void)
+{
+    return (unsigned long)(simclock_nowNs() / 1000000ull);
+}
+
+unsigned long micros(void)
+{
+    return (unsigned long)(simclock_nowNs() / 1000ull);
+}
@@ -0,0 +1,17 @@
+#ifndef ARDUINO_H
+#define ARDUINO_H
+
+/* Host stand-in for the Arduino core, running on the simulator's virtual
+ * clock. Only what the DA7280 library uses is provided. */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <math.h>
+
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+unsigned long millis(void);
+unsigned long micros(void);
+
+#endif // ARDUINO_H
@@ -0,0 +1,67 @@
+#include "Wire.h"
+
+TwoWire Wire;
+
+void TwoWire::beginTransmission(uint8_t address)
+{
+    _txAddress = address;
+    _txLength = 0;
+    _txPending = false;
+}
+
+size_t TwoWire::write(uint8_t data)
+{
+    if (_txLength >= I2C_BUFFER_LENGTH)
+        return 0;
+
+    _txBuffer[_txLength++] = data;
+    return 1;
+}
+
+// Returns 0 on success and 2 on an address NACK, like the Arduino core.
+uint8_t TwoWire::endTransmission(bool sendStop)
+{
+    if (!sendStop)
+    {
+        _txPending = true;
+        return 0;
+    }
+
+    int ret = _transport->write(_transport->ctx, _txAddress, _txBuffer, _txLength);
+    _txLength = 0;
+    return (ret == 0) ? 0 : 2;
+}
+
+uint8_t TwoWire::requestFrom(uint8_t address, uint8_t quantity)
+{
+    if (quantity > I2C_BUFFER_LENGTH)
+        quantity = I2C_BUFFER_LENGTH;
+
+    const uint8_t *wdata = nullptr;
+    size_t wlen = 0;
+    if (_txPending && _txAddress == address)
+    {
+        wdata = _txBuffer;
+        wlen = _txLength;
+    }
+
+    int ret = _transport->writeRead(_transport->ctx, address, wdata, wlen, _rxBuffer, quantity);
+    _txPending = false;
+    _txLength = 0;
+    _rxIndex = 0;
+    _rxLength = (ret == 0) ? quantity : 0;
+    return static_cast<uint8_t>(_rxLength);
+}
+
+int TwoWire::available()
+{
+    return static_cast<int>(_rxLength - _rxIndex);
+}
+
+int TwoWire::read()
+{
+    if (_rxIndex >= _rxLength)
+        return -1;
+
+    return _rxBuffer[_rxIndex++];
+}
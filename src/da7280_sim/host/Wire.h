@@ -0,0 +1,46 @@
+#ifndef TWOWIRE_H
+#define TWOWIRE_H
+
+/* Host stand-in for the Arduino TwoWire class. Transactions are handed to an
+ * i2c_transport_t; endTransmission(false) followed by requestFrom() goes out
+ * as a single write/repeated START/read transaction, as it does on the wire. */
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "i2c_transport.h"
+
+// Same as the AVR core, writes past it are dropped without an error; the
+// ESP32 core buffers 128 bytes, build with -DI2C_BUFFER_LENGTH=128 for it
+#ifndef I2C_BUFFER_LENGTH
+#define I2C_BUFFER_LENGTH 32
+#endif
+
+class TwoWire
+{
+  public:
+    void begin() {}
+    void setClock(uint32_t) {}
+    void setTransport(const i2c_transport_t *transport) { _transport = transport; }
+
+    void beginTransmission(uint8_t address);
+    size_t write(uint8_t data);
+    uint8_t endTransmission(bool sendStop = true);
+    uint8_t requestFrom(uint8_t address, uint8_t quantity);
+    int available();
+    int read();
+
+  private:
+    const i2c_transport_t *_transport = nullptr;
+    uint8_t _txAddress = 0;
+    uint8_t _txBuffer[I2C_BUFFER_LENGTH]{};
+    size_t _txLength = 0;
+    bool _txPending = false; // Held back for a repeated START
+    uint8_t _rxBuffer[I2C_BUFFER_LENGTH]{};
+    size_t _rxLength = 0;
+    size_t _rxIndex = 0;
+};
+
+extern TwoWire Wire;
+
+#endif // TWOWIRE_H
@@ -0,0 +1,25 @@
+#include <stdint.h>
+
+#include "app.h"
+
+// The firmware's app_bm.c needs sl_core. The host is single threaded, the
+// requests are only counted so that a simulated loop can tell whether to sleep.
+static uint16_t _proceedRequests = 0;
+
+void app_proceed(void)
+{
+    if (_proceedRequests < UINT16_MAX)
+    {
+        _proceedRequests++;
+    }
+}
+
+bool app_is_process_required(void)
+{
+    if (_proceedRequests == 0)
+    {
+        return false;
+    }
+    _proceedRequests--;
+    return true;
+}
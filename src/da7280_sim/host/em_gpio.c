@@ -0,0 +1,97 @@
+#include "em_gpio.h"
+#include "gpiointerrupt.h"
+
+#include <string.h>
+
+typedef struct
+{
+    bool              enabled;
+    GPIO_Port_TypeDef port;
+    unsigned int      pin;
+    bool              risingEdge;
+    bool              fallingEdge;
+} simgpio_extInt_t;
+
+static bool _level[SIMGPIO_NUM_PORTS][SIMGPIO_NUM_PINS];
+static bool _levelInit = false;
+static simgpio_extInt_t _extInt[SIMGPIO_NUM_PINS];
+static GPIOINT_IrqCallbackPtr_t _callbacks[SIMGPIO_NUM_PINS];
+
+static void _initLevels(void)
+{
+    if (!_levelInit)
+    {
+        memset(_level, 1, sizeof(_level));
+        _levelInit = true;
+    }
+}
+
+void GPIO_PinModeSet(GPIO_Port_TypeDef port, unsigned int pin, GPIO_Mode_TypeDef mode, unsigned int out)
+{
+    // Inputs follow simgpio_setInput(), outputs are not modelled
+    (void)port;
+    (void)pin;
+    (void)mode;
+    (void)out;
+}
+
+void GPIO_ExtIntConfig(GPIO_Port_TypeDef port, unsigned int pin, unsigned int intNo,
+                       bool risingEdge, bool fallingEdge, bool enable)
+{
+    if (intNo >= SIMGPIO_NUM_PINS)
+    {
+        return;
+    }
+    _extInt[intNo].enabled     = enable;
+    _extInt[intNo].port        = port;
+    _extInt[intNo].pin         = pin;
+    _extInt[intNo].risingEdge  = risingEdge;
+    _extInt[intNo].fallingEdge = fallingEdge;
+}
+
+unsigned int GPIO_PinInGet(GPIO_Port_TypeDef port, unsigned int pin)
+{
+    _initLevels();
+    return _level[port][pin] ? 1 : 0;
+}
+
+void simgpio_setInput(GPIO_Port_TypeDef port, unsigned int pin, bool level)
+{
+    _initLevels();
+    if (_level[port][pin] == level)
+    {
+        return;
+    }
+    _level[port][pin] = level;
+
+    // The GPIO IRQ handler runs straight away, as it would preempt the main loop
+    for (unsigned int i = 0; i < SIMGPIO_NUM_PINS; i++)
+    {
+        const simgpio_extInt_t *ext = &_extInt[i];
+        if (ext->enabled && ext->port == port && ext->pin == pin &&
+            ((level && ext->risingEdge) || (!level && ext->fallingEdge)) && _callbacks[i] != NULL)
+        {
+            _callbacks[i]((uint8_t)i);
+        }
+    }
+}
+
+void simgpio_reset(void)
+{
+    memset(_level, 1, sizeof(_level));
+    _levelInit = true;
+    memset(_extInt, 0, sizeof(_extInt));
+    memset(_callbacks, 0, sizeof(_callbacks));
+}
+
+void GPIOINT_Init(void)
+{
+}
+
+void GPIOINT_CallbackRegister(uint8_t intNo, GPIOINT_IrqCallbackPtr_t callbackPtr)
+{
+    if (intNo < SIMGPIO_NUM_PINS)
+    {
+        _callbacks[intNo] = callbackPtr;
+    }
+}
@@ -0,0 +1,49 @@
+#ifndef EM_GPIO_H
+#define EM_GPIO_H
+
+/* Host stand-in for the emlib GPIO calls used by the firmware. Input levels
+ * are set by the simulation with simgpio_setInput(), which raises the
+ * configured external interrupts on their edges. */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SIMGPIO_NUM_PORTS   4
+#define SIMGPIO_NUM_PINS    16
+
+typedef enum
+{
+    gpioPortA = 0,
+    gpioPortB = 1,
+    gpioPortC = 2,
+    gpioPortD = 3
+} GPIO_Port_TypeDef;
+
+typedef enum
+{
+    gpioModeDisabled,
+    gpioModeInput,
+    gpioModeInputPull,
+    gpioModePushPull
+} GPIO_Mode_TypeDef;
+
+void GPIO_PinModeSet(GPIO_Port_TypeDef port, unsigned int pin, GPIO_Mode_TypeDef mode, unsigned int out);
+void GPIO_ExtIntConfig(GPIO_Port_TypeDef port, unsigned int pin, unsigned int intNo,
+                       bool risingEdge, bool fallingEdge, bool enable);
+unsigned int GPIO_PinInGet(GPIO_Port_TypeDef port, unsigned int pin);
+
+// Drives an input as an external device would. Every pin idles high.
+void simgpio_setInput(GPIO_Port_TypeDef port, unsigned int pin, bool level);
+
+// Returns every pin to its idle level and drops interrupt configuration and callbacks.
+void simgpio_reset(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // EM_GPIO_H
@@ -0,0 +1,63 @@
+#include "em_i2c.h"
+
+#include <string.h>
+
+#define WRITE_WRITE_MAX_LEN 256
+
+I2C_TransferReturn_TypeDef I2C_TransferInit(I2C_TypeDef *i2c, I2C_TransferSeq_TypeDef *seq)
+{
+    if (i2c->pending != NULL)
+    {
+        return i2cTransferUsageFault;
+    }
+    i2c->pending = seq;
+    return i2cTransferInProgress;
+}
+
+I2C_TransferReturn_TypeDef I2C_Transfer(I2C_TypeDef *i2c)
+{
+    const i2c_transport_t *t = i2c->transport;
+    I2C_TransferSeq_TypeDef *seq = i2c->pending;
+    int ret;
+
+    if (seq == NULL)
+    {
+        return i2cTransferUsageFault;
+    }
+    i2c->pending = NULL;
+
+    uint8_t addr = (uint8_t)(seq->addr >> 1);
+
+    switch (seq->flags)
+    {
+    case I2C_FLAG_WRITE:
+        ret = t->write(t->ctx, addr, seq->buf[0].data, seq->buf[0].len);
+        break;
+    case I2C_FLAG_READ:
+        ret = t->writeRead(t->ctx, addr, NULL, 0, seq->buf[0].data, seq->buf[0].len);
+        break;
+    case I2C_FLAG_WRITE_READ:
+        ret = t->writeRead(t->ctx, addr, seq->buf[0].data, seq->buf[0].len,
+                           seq->buf[1].data, seq->buf[1].len);
+        break;
+    case I2C_FLAG_WRITE_WRITE:
+    {
+        // Both buffers go out back to back in a single write
+        uint8_t buf[WRITE_WRITE_MAX_LEN];
+        size_t len = (size_t)seq->buf[0].len + seq->buf[1].len;
+
+        if (len > sizeof(buf))
+        {
+            return i2cTransferUsageFault;
+        }
+        memcpy(buf, seq->buf[0].data, seq->buf[0].len);
+        memcpy(buf + seq->buf[0].len, seq->buf[1].data, seq->buf[1].len);
+        ret = t->write(t->ctx, addr, buf, len);
+        break;
+    }
+    default:
+        return i2cTransferUsageFault;
+    }
+
+    return (ret == 0) ? i2cTransferDone : i2cTransferNack;
+}
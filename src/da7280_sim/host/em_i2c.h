@@ -0,0 +1,60 @@
+#ifndef EM_I2C_H
+#define EM_I2C_H
+
+/* Host stand-in for the emlib I2C types used by the firmware. Only what the
+ * DA7280 drivers need is declared here. */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "i2c_transport.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define I2C_FLAG_WRITE          0x0001
+#define I2C_FLAG_READ           0x0002
+#define I2C_FLAG_WRITE_READ     0x0004
+#define I2C_FLAG_WRITE_WRITE    0x0008
+
+typedef enum
+{
+    i2cTransferInProgress = 1,
+    i2cTransferDone       = 0,
+    i2cTransferNack       = -1,
+    i2cTransferBusErr     = -2,
+    i2cTransferArbLost    = -3,
+    i2cTransferUsageFault = -4,
+    i2cTransferSwFault    = -5
+} I2C_TransferReturn_TypeDef;
+
+typedef struct
+{
+    uint16_t addr;                  // 7-bit address shifted left by one
+    uint16_t flags;
+    struct
+    {
+        uint8_t  *data;
+        uint16_t len;
+    } buf[2];
+} I2C_TransferSeq_TypeDef;
+
+// The peripheral is a transport plus the transfer started by
+// I2C_TransferInit(), which the next I2C_Transfer() call (normally from the
+// simulated IRQ handler) completes in one go.
+typedef struct
+{
+    const i2c_transport_t   *transport;
+    I2C_TransferSeq_TypeDef *pending;
+} I2C_TypeDef;
+
+I2C_TransferReturn_TypeDef I2C_TransferInit(I2C_TypeDef *i2c, I2C_TransferSeq_TypeDef *seq);
+I2C_TransferReturn_TypeDef I2C_Transfer(I2C_TypeDef *i2c);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // EM_I2C_H
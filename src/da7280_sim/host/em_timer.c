@@ -0,0 +1,171 @@
+#include "em_timer.h"
+#include "da7280_sim.h"
+
+#include <stddef.h>
+
+static TIMER_TypeDef *_timers[SIMTIMER_MAX_TIMERS];
+static bool _inAdvance = false;
+
+// Time of overflow number overflows + 1 of the current period length,
+// exact in the long run however the period divides into nanoseconds
+static uint64_t _nextOverflowNs(const TIMER_TypeDef *timer)
+{
+    uint64_t counts = (timer->overflows + 1) * ((uint64_t)timer->TOP + 1);
+
+    return timer->periodStartNs + (counts * 1000000000ull) / timer->clockHz;
+}
+
+static void _overflow(TIMER_TypeDef *timer, uint64_t atNs)
+{
+    for (unsigned int ch = 0; ch < TIMER_NUM_CC; ch++)
+    {
+        if (timer->CC[ch].mode == timerCCModePWM && timer->CC[ch].OC != timer->CC[ch].OCB)
+        {
+            timer->CC[ch].OC = timer->CC[ch].OCB;
+            if (timer->ocChanged != NULL)
+            {
+                timer->ocChanged(timer->ocCtx, ch, timer->CC[ch].OC, atNs);
+            }
+        }
+    }
+    timer->overflows++;
+    timer->IF |= TIMER_IF_OF;
+    if ((timer->IEN & timer->IF) && timer->irqHandler != NULL)
+    {
+        timer->irqHandler();
+    }
+}
+
+static void _onAdvance(uint64_t fromNs, uint64_t toNs)
+{
+    (void)fromNs;
+
+    // A handler that waits would advance the clock from inside the loop
+    if (_inAdvance)
+    {
+        return;
+    }
+    _inAdvance = true;
+    for (size_t i = 0; i < SIMTIMER_MAX_TIMERS; i++)
+    {
+        TIMER_TypeDef *timer = _timers[i];
+
+        while (timer != NULL && timer->running && timer->clockHz > 0)
+        {
+            uint64_t at = _nextOverflowNs(timer);
+            if (at > toNs)
+            {
+                break;
+            }
+            _overflow(timer, at);
+        }
+    }
+    _inAdvance = false;
+}
+
+// Periods are counted from now on
+static void _restart(TIMER_TypeDef *timer)
+{
+    timer->periodStartNs = simclock_nowNs();
+    timer->overflows = 0;
+}
+
+void TIMER_Init(TIMER_TypeDef *timer, const TIMER_Init_TypeDef *init)
+{
+    TIMER_Enable(timer, init->enable);
+}
+
+void TIMER_InitCC(TIMER_TypeDef *timer, unsigned int ch, const TIMER_InitCC_TypeDef *init)
+{
+    if (ch < TIMER_NUM_CC)
+    {
+        timer->CC[ch].mode = init->mode;
+    }
+}
+
+void TIMER_Enable(TIMER_TypeDef *timer, bool enable)
+{
+    if (enable && !timer->running)
+    {
+        _restart(timer);
+    }
+    timer->running = enable;
+}
+
+void TIMER_TopSet(TIMER_TypeDef *timer, uint32_t val)
+{
+    // Unlike the peripheral, a new TOP also restarts the current period
+    timer->TOP = val;
+    _restart(timer);
+}
+
+uint32_t TIMER_TopGet(TIMER_TypeDef *timer)
+{
+    return timer->TOP;
+}
+
+void TIMER_CompareSet(TIMER_TypeDef *timer, unsigned int ch, uint32_t val)
+{
+    if (ch < TIMER_NUM_CC)
+    {
+        timer->CC[ch].OC = val;
+        timer->CC[ch].OCB = val;
+        if (timer->ocChanged != NULL)
+        {
+            timer->ocChanged(timer->ocCtx, ch, val, simclock_nowNs());
+        }
+    }
+}
+
+void TIMER_CompareBufSet(TIMER_TypeDef *timer, unsigned int ch, uint32_t val)
+{
+    if (ch < TIMER_NUM_CC)
+    {
+        timer->CC[ch].OCB = val;
+    }
+}
+
+void TIMER_IntEnable(TIMER_TypeDef *timer, uint32_t flags)
+{
+    timer->IEN |= flags;
+}
+
+void TIMER_IntDisable(TIMER_TypeDef *timer, uint32_t flags)
+{
+    timer->IEN &= ~flags;
+}
+
+void TIMER_IntClear(TIMER_TypeDef *timer, uint32_t flags)
+{
+    timer->IF &= ~flags;
+}
+
+uint32_t TIMER_IntGet(TIMER_TypeDef *timer)
+{
+    return timer->IF;
+}
+
+bool simtimer_attach(TIMER_TypeDef *timer, uint32_t clockHz, void (*irqHandler)(void))
+{
+    for (size_t i = 0; i < SIMTIMER_MAX_TIMERS; i++)
+    {
+        if (_timers[i] == NULL || _timers[i] == timer)
+        {
+            _timers[i] = timer;
+            timer->clockHz = clockHz;
+            timer->irqHandler = irqHandler;
+            simclock_onAdvance(_onAdvance);
+            return true;
+        }
+    }
+    return false;
+}
+
+void simtimer_reset(void)
+{
+    for (size_t i = 0; i < SIMTIMER_MAX_TIMERS; i++)
+    {
+        _timers[i] = NULL;
+    }
+    simclock_onAdvance(NULL);
+}
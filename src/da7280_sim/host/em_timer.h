@@ -0,0 +1,91 @@
+#ifndef EM_TIMER_H
+#define EM_TIMER_H
+
+/* Host stand-in for the emlib TIMER calls used by the firmware, running on
+ * the simulator's virtual clock. A timer attached with simtimer_attach()
+ * counts up to TOP at its clock; at every overflow the buffered compare
+ * values are taken over, as the peripheral does in PWM mode, and the
+ * overflow interrupt calls the attached IRQ handler when it is enabled.
+ * Overflows happen while the clock advances, bus transfers included. */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TIMER_NUM_CC        3
+#define TIMER_IF_OF         0x0001
+#define TIMER_IEN_OF        TIMER_IF_OF
+
+typedef enum
+{
+    timerCCModeOff,
+    timerCCModeCapture,
+    timerCCModeCompare,
+    timerCCModePWM
+} TIMER_CCMode_TypeDef;
+
+typedef struct
+{
+    bool enable;
+} TIMER_Init_TypeDef;
+
+typedef struct
+{
+    TIMER_CCMode_TypeDef mode;
+} TIMER_InitCC_TypeDef;
+
+#define TIMER_INIT_DEFAULT      { true }
+#define TIMER_INITCC_DEFAULT    { timerCCModeOff }
+
+typedef struct
+{
+    uint32_t TOP;
+    uint32_t IF;
+    uint32_t IEN;
+    struct
+    {
+        TIMER_CCMode_TypeDef mode;
+        uint32_t OC;                        // compare value in use
+        uint32_t OCB;                       // taken over at the next overflow
+    } CC[TIMER_NUM_CC];
+
+    // Model
+    bool     running;
+    uint32_t clockHz;
+    uint64_t periodStartNs;                 // of the period counting now
+    uint64_t overflows;
+    void   (*irqHandler)(void);
+    // Called when an overflow changes OC of a PWM channel, e.g. to trace
+    // the duty cycle a device sees
+    void   (*ocChanged)(void *ctx, unsigned int ch, uint32_t oc, uint64_t atNs);
+    void    *ocCtx;
+} TIMER_TypeDef;
+
+void TIMER_Init(TIMER_TypeDef *timer, const TIMER_Init_TypeDef *init);
+void TIMER_InitCC(TIMER_TypeDef *timer, unsigned int ch, const TIMER_InitCC_TypeDef *init);
+void TIMER_Enable(TIMER_TypeDef *timer, bool enable);
+void TIMER_TopSet(TIMER_TypeDef *timer, uint32_t val);
+uint32_t TIMER_TopGet(TIMER_TypeDef *timer);
+void TIMER_CompareSet(TIMER_TypeDef *timer, unsigned int ch, uint32_t val);
+void TIMER_CompareBufSet(TIMER_TypeDef *timer, unsigned int ch, uint32_t val);
+void TIMER_IntEnable(TIMER_TypeDef *timer, uint32_t flags);
+void TIMER_IntDisable(TIMER_TypeDef *timer, uint32_t flags);
+void TIMER_IntClear(TIMER_TypeDef *timer, uint32_t flags);
+uint32_t TIMER_IntGet(TIMER_TypeDef *timer);
+
+// Clocks timer at clockHz from the virtual clock and routes its interrupt
+// to irqHandler, may be NULL. Up to SIMTIMER_MAX_TIMERS timers.
+#define SIMTIMER_MAX_TIMERS 2
+bool simtimer_attach(TIMER_TypeDef *timer, uint32_t clockHz, void (*irqHandler)(void));
+
+// Detaches every timer.
+void simtimer_reset(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // EM_TIMER_H
@@ -0,0 +1,12 @@
+#ifndef GATT_DB_H
+#define GATT_DB_H
+
+/* Host stand-in for the GATT database generated by Simplicity Studio. The
+ * handle values are arbitrary, only their identity matters to the driver. */
+
+#define gattdb_weight_value      0x20
+#define gattdb_pattern_value     0x22
+#define gattdb_activity_value    0x24
+#define gattdb_message_response  0x26
+
+#endif // GATT_DB_H
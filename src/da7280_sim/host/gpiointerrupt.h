@@ -0,0 +1,21 @@
+#ifndef GPIOINTERRUPT_H
+#define GPIOINTERRUPT_H
+
+/* Host stand-in for the GPIOINT dispatcher, fed by the em_gpio stand-in. */
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef void (*GPIOINT_IrqCallbackPtr_t)(uint8_t intNo);
+
+void GPIOINT_Init(void);
+void GPIOINT_CallbackRegister(uint8_t intNo, GPIOINT_IrqCallbackPtr_t callbackPtr);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // GPIOINTERRUPT_H
@@ -0,0 +1,7 @@
+#ifndef SL_COMPONENT_CATALOG_H
+#define SL_COMPONENT_CATALOG_H
+
+/* Host stand-in for the generated component catalog: no kernel, no power
+ * manager. */
+
+#endif // SL_COMPONENT_CATALOG_H
@@ -0,0 +1,13 @@
+#ifndef SL_CORE_H
+#define SL_CORE_H
+
+/* Host stand-in for sl_core. The host is single threaded and the simulated
+ * IRQ handlers are called explicitly, so critical sections are empty. */
+
+#define CORE_DECLARE_IRQ_STATE
+#define CORE_ENTER_CRITICAL()
+#define CORE_EXIT_CRITICAL()
+#define CORE_ENTER_ATOMIC()
+#define CORE_EXIT_ATOMIC()
+
+#endif // SL_CORE_H
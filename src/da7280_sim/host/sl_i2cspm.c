@@ -0,0 +1,13 @@
+#include "sl_i2cspm.h"
+
+// Same as the SDK: start the transfer and poll it to completion
+I2C_TransferReturn_TypeDef I2CSPM_Transfer(sl_i2cspm_t *i2cspm, I2C_TransferSeq_TypeDef *seq)
+{
+    I2C_TransferReturn_TypeDef ret = I2C_TransferInit(i2cspm, seq);
+
+    while (ret == i2cTransferInProgress)
+    {
+        ret = I2C_Transfer(i2cspm);
+    }
+    return ret;
+}
@@ -0,0 +1,21 @@
+#ifndef SL_I2CSPM_H
+#define SL_I2CSPM_H
+
+/* Host stand-in for the I2C simple polled master. As on the target, the port
+ * is the I2C peripheral itself. */
+
+#include "em_i2c.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef I2C_TypeDef sl_i2cspm_t;
+
+I2C_TransferReturn_TypeDef I2CSPM_Transfer(sl_i2cspm_t *i2cspm, I2C_TransferSeq_TypeDef *seq);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SL_I2CSPM_H
@@ -0,0 +1,158 @@
+#include <stddef.h>
+
+#include "sl_sleeptimer.h"
+#include "da7280_sim.h"
+
+// Frequency of the LFXO/LFRCO the sleeptimer usually runs from
+#define SIM_SLEEPTIMER_HZ   32768u
+
+// Running timers, in no particular order
+static sl_sleeptimer_timer_handle_t *_timers = NULL;
+
+static void _unlink(sl_sleeptimer_timer_handle_t *handle)
+{
+    for (sl_sleeptimer_timer_handle_t **link = &_timers; *link != NULL; link = &(*link)->next)
+    {
+        if (*link == handle)
+        {
+            *link = handle->next;
+            break;
+        }
+    }
+    handle->running = false;
+    handle->next = NULL;
+}
+
+// Earliest running timer that expires at or before ns, NULL if there is none
+static sl_sleeptimer_timer_handle_t *_nextExpired(uint64_t ns)
+{
+    sl_sleeptimer_timer_handle_t *first = NULL;
+
+    for (sl_sleeptimer_timer_handle_t *t = _timers; t != NULL; t = t->next)
+    {
+        if (t->expiry_ns <= ns && (first == NULL || t->expiry_ns < first->expiry_ns))
+        {
+            first = t;
+        }
+    }
+    return first;
+}
+
+void sl_sleeptimer_delay_millisecond(uint16_t time_ms)
+{
+    uint64_t end = simclock_nowNs() + (uint64_t)time_ms * 1000000ull;
+    sl_sleeptimer_timer_handle_t *t;
+
+    // A callback may start a timer that expires before the delay ends
+    while ((t = _nextExpired(end)) != NULL)
+    {
+        if (t->expiry_ns > simclock_nowNs())
+        {
+            simclock_advanceNs(t->expiry_ns - simclock_nowNs());
+        }
+        _unlink(t);
+        t->callback(t, t->callback_data);
+    }
+    if (end > simclock_nowNs())
+    {
+        simclock_advanceNs(end - simclock_nowNs());
+    }
+}
+
+bool simsleeptimer_sleepUntil(uint64_t untilNs)
+{
+    sl_sleeptimer_timer_handle_t *t = _nextExpired(UINT64_MAX);
+
+    if (t == NULL || t->expiry_ns > untilNs)
+    {
+        if (untilNs > simclock_nowNs())
+        {
+            simclock_advanceNs(untilNs - simclock_nowNs());
+        }
+        return false;
+    }
+    if (t->expiry_ns > simclock_nowNs())
+    {
+        simclock_advanceNs(t->expiry_ns - simclock_nowNs());
+    }
+    _unlink(t);
+    t->callback(t, t->callback_data);
+    return true;
+}
+
+uint32_t sl_sleeptimer_get_timer_frequency(void)
+{
+    return SIM_SLEEPTIMER_HZ;
+}
+
+uint64_t sl_sleeptimer_get_tick_count64(void)
+{
+    return (simclock_nowNs() * SIM_SLEEPTIMER_HZ) / 1000000000ull;
+}
+
+static sl_status_t _start(sl_sleeptimer_timer_handle_t *handle, uint64_t expiry_ns,
+                          sl_sleeptimer_timer_callback_t callback, void *callback_data)
+{
+    if (handle == NULL || callback == NULL)
+    {
+        return SL_STATUS_NULL_POINTER;
+    }
+    if (handle->running)
+    {
+        return SL_STATUS_NOT_READY;
+    }
+    handle->callback      = callback;
+    handle->callback_data = callback_data;
+    handle->expiry_ns     = expiry_ns;
+    handle->running       = true;
+    handle->next          = _timers;
+    _timers = handle;
+    return SL_STATUS_OK;
+}
+
+sl_status_t sl_sleeptimer_start_timer(sl_sleeptimer_timer_handle_t *handle, uint32_t timeout,
+                                      sl_sleeptimer_timer_callback_t callback, void *callback_data,
+                                      uint8_t priority, uint16_t option_flags)
+{
+    (void)priority;
+    (void)option_flags;
+
+    // First nanosecond of the tick the timer expires on
+    uint64_t tick = sl_sleeptimer_get_tick_count64() + timeout;
+    uint64_t expiry_ns = (tick * 1000000000ull + SIM_SLEEPTIMER_HZ - 1) / SIM_SLEEPTIMER_HZ;
+    return _start(handle, expiry_ns, callback, callback_data);
+}
+
+sl_status_t sl_sleeptimer_start_timer_ms(sl_sleeptimer_timer_handle_t *handle, uint32_t timeout_ms,
+                                         sl_sleeptimer_timer_callback_t callback, void *callback_data,
+                                         uint8_t priority, uint16_t option_flags)
+{
+    (void)priority;
+    (void)option_flags;
+
+    return _start(handle, simclock_nowNs() + (uint64_t)timeout_ms * 1000000ull, callback, callback_data);
+}
+
+sl_status_t sl_sleeptimer_stop_timer(sl_sleeptimer_timer_handle_t *handle)
+{
+    if (handle == NULL)
+    {
+        return SL_STATUS_NULL_POINTER;
+    }
+    if (!handle->running)
+    {
+        return SL_STATUS_INVALID_STATE;
+    }
+    _unlink(handle);
+    return SL_STATUS_OK;
+}
+
+sl_status_t sl_sleeptimer_is_timer_running(sl_sleeptimer_timer_handle_t *handle, bool *running)
+{
+    if (handle == NULL || running == NULL)
+    {
+        return SL_STATUS_NULL_POINTER;
+    }
+    *running = handle->running;
+    return SL_STATUS_OK;
+}
@@ -0,0 +1,54 @@
+#ifndef SL_SLEEPTIMER_H
+#define SL_SLEEPTIMER_H
+
+/* Host stand-in for the sleeptimer, running on the simulator's virtual clock.
+ * Timer callbacks run from sl_sleeptimer_delay_millisecond(), with the clock
+ * set to their expiry, as the sleeptimer interrupt would preempt the delay. A
+ * timer that expires while the bus advances the clock fires on the next delay. */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "sl_status.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct sl_sleeptimer_timer_handle sl_sleeptimer_timer_handle_t;
+
+typedef void (*sl_sleeptimer_timer_callback_t)(sl_sleeptimer_timer_handle_t *handle, void *data);
+
+struct sl_sleeptimer_timer_handle
+{
+    void                            *callback_data;
+    sl_sleeptimer_timer_callback_t   callback;
+    uint64_t                         expiry_ns;
+    bool                             running;
+    sl_sleeptimer_timer_handle_t    *next;
+};
+
+void sl_sleeptimer_delay_millisecond(uint16_t time_ms);
+uint32_t sl_sleeptimer_get_timer_frequency(void);
+uint64_t sl_sleeptimer_get_tick_count64(void);
+
+// priority and option_flags are accepted and ignored. A timeout in ticks
+// counts from the current tick, as the RTC compare does.
+sl_status_t sl_sleeptimer_start_timer(sl_sleeptimer_timer_handle_t *handle, uint32_t timeout,
+                                      sl_sleeptimer_timer_callback_t callback, void *callback_data,
+                                      uint8_t priority, uint16_t option_flags);
+sl_status_t sl_sleeptimer_start_timer_ms(sl_sleeptimer_timer_handle_t *handle, uint32_t timeout_ms,
+                                         sl_sleeptimer_timer_callback_t callback, void *callback_data,
+                                         uint8_t priority, uint16_t option_flags);
+sl_status_t sl_sleeptimer_stop_timer(sl_sleeptimer_timer_handle_t *handle);
+sl_status_t sl_sleeptimer_is_timer_running(sl_sleeptimer_timer_handle_t *handle, bool *running);
+
+// Sleeps as the CPU would until the next sleeptimer interrupt, at the
+// latest until the virtual clock reads untilNs, and runs the callback of
+// the timer that woke it. False if no timer expired.
+bool simsleeptimer_sleepUntil(uint64_t untilNs);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SL_SLEEPTIMER_H
@@ -0,0 +1,15 @@
+#ifndef SL_STATUS_H
+#define SL_STATUS_H
+
+/* Host stand-in for sl_status, the codes the shims return. */
+
+#include <stdint.h>
+
+typedef uint32_t sl_status_t;
+
+#define SL_STATUS_OK                0x0000
+#define SL_STATUS_INVALID_STATE     0x0002
+#define SL_STATUS_NOT_READY         0x0003
+#define SL_STATUS_NULL_POINTER      0x0022
+
+#endif // SL_STATUS_H
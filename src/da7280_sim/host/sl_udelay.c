@@ -0,0 +1,7 @@
+#include "sl_udelay.h"
+#include "da7280_sim.h"
+
+void sl_udelay_wait(unsigned us)
+{
+    simclock_advanceNs((uint64_t)us * 1000ull);
+}
@@ -0,0 +1,16 @@
+#ifndef SL_UDELAY_H
+#define SL_UDELAY_H
+
+/* Host stand-in for the udelay service, running on the simulator's virtual clock. */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void sl_udelay_wait(unsigned us);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SL_UDELAY_H
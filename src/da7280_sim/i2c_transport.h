@@ -0,0 +1,33 @@
+#ifndef I2C_TRANSPORT_H
+#define I2C_TRANSPORT_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Host side I2C transport. The host versions of I2CSPM_Transfer() and
+// TwoWire route every bus transaction through one of these, so the drivers
+// can run against the simulator (or anything else) on Linux.
+//
+// Addresses are 7-bit. Both calls return 0 on success and a negative value
+// if the address or a data byte was not acknowledged.
+typedef struct i2c_transport
+{
+    void *ctx;
+
+    // START, addr+W, data[0..len-1], STOP
+    int (*write)(void *ctx, uint8_t addr, const uint8_t *data, size_t len);
+
+    // START, addr+W, wdata[], repeated START, addr+R, rdata[], STOP.
+    // With wlen == 0 this is a plain read.
+    int (*writeRead)(void *ctx, uint8_t addr, const uint8_t *wdata, size_t wlen, uint8_t *rdata, size_t rlen);
+} i2c_transport_t;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // I2C_TRANSPORT_H
@@ -0,0 +1,215 @@
+/* Plays the same stream of levels at a range of update rates through both
+ * amplitude backends of the driver and reports, per rate, the rate at which
+ * the levels reached the device, their worst lateness against the
+ * deadlines, the bus time and the CPU wake-ups they took:
+ *
+ *   DRO   TOP_CTL2 writes over I2C, da7280_streamAmplitudes()
+ *   PWM   the duty cycle of GPI0/PWM, da7280_pwmStream(), from the host
+ *         TIMER model fed from a sleeptimer timer once per level, or by
+ *         the overflow interrupt for levels shorter than 244 us
+ *
+ *   backend_rates                      400 kHz bus, 20 kHz PWM
+ *   backend_rates -c HZ                bus clock
+ *   backend_rates -w HZ                PWM frequency, 10000..250000
+ *
+ * A DRO level arrives at the end of its write, a PWM level with the first
+ * period of its duty cycle. Exits with 1 if the PWM backend takes the bus
+ * or misses a deadline by more than one PWM period at a rate up to the PWM
+ * frequency. See the Host Simulation section of the README for the build.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "da7280_sim.h"
+#include "da7280_driver.h"
+#include "da7280_pwm.h"
+#include "em_timer.h"
+#include "sl_sleeptimer.h"
+
+#define TIMER_CLOCK_HZ      38400000    // HFXO of the BGM220P
+#define NUM_LEVELS          200
+
+static const uint32_t _ratesHz[] = { 100, 250, 500, 1000, 2000, 5000, 10000, 20000 };
+
+static TIMER_TypeDef _timer;
+static uint64_t _arrivalNs[NUM_LEVELS];
+static size_t   _numArrivals = 0;
+
+static void _record(uint64_t atNs)
+{
+    if (_numArrivals < NUM_LEVELS)
+    {
+        _arrivalNs[_numArrivals] = atNs;
+    }
+    _numArrivals++;
+}
+
+static void _onAmplitudeWritten(void *ctx, uint8_t level)
+{
+    (void)ctx;
+    (void)level;
+    _record(simclock_nowNs());
+}
+
+static void _onDutyChanged(void *ctx, unsigned int ch, uint32_t oc, uint64_t atNs)
+{
+    (void)ctx;
+    (void)ch;
+    (void)oc;
+    _record(atNs);
+}
+
+typedef struct
+{
+    double   achievedHz;
+    uint32_t maxLateUs;
+    uint32_t transactions;
+    uint64_t busTimeNs;
+    uint64_t elapsedNs;
+    uint32_t wakeups;
+} runResult;
+
+static void _evaluate(runResult *result, uint64_t startNs, uint32_t periodUs)
+{
+    uint64_t worst = 0;
+    size_t   n = (_numArrivals < NUM_LEVELS) ? _numArrivals : NUM_LEVELS;
+
+    for (size_t i = 0; i < n; i++)
+    {
+        uint64_t deadline = startNs + (uint64_t)i * periodUs * 1000u;
+        uint64_t late = (_arrivalNs[i] > deadline) ? _arrivalNs[i] - deadline : 0;
+        worst = (late > worst) ? late : worst;
+    }
+    result->maxLateUs = (uint32_t)(worst / 1000u);
+    result->achievedHz = (n > 1 && _arrivalNs[n - 1] > _arrivalNs[0])
+                         ? (n - 1) * 1e9 / (double)(_arrivalNs[n - 1] - _arrivalNs[0]) : 0.0;
+}
+
+static void _print(const char *backend, uint32_t rateHz, const runResult *result)
+{
+    printf("%-4s %7u %11.1f %10.3f %6u %9.3f %6.1f %8u%s\n", backend, (unsigned)rateHz, result->achievedHz,
+           result->maxLateUs / 1000.0, (unsigned)result->transactions, result->busTimeNs / 1e6,
+           (result->elapsedNs > 0) ? 100.0 * result->busTimeNs / result->elapsedNs : 0.0,
+           (unsigned)result->wakeups, (_numArrivals != NUM_LEVELS) ? "  LEVELS LOST" : "");
+}
+
+int main(int argc, char *argv[])
+{
+    long clockHz = 400000;
+    long pwmHz = 20000;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-c") == 0 && i + 1 < argc)
+        {
+            clockHz = strtol(argv[++i], NULL, 10);
+        }
+        else if (strcmp(argv[i], "-w") == 0 && i + 1 < argc)
+        {
+            pwmHz = strtol(argv[++i], NULL, 10);
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s [-c HZ] [-w HZ]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (clockHz < 1000)
+    {
+        fprintf(stderr, "a bus clock of 1 kHz or more\n");
+        return 2;
+    }
+
+    simbus_t    bus;
+    da7280sim_t dev;
+    sl_i2cspm_t port = { 0 };
+
+    simclock_reset();
+    simbus_init(&bus, (uint32_t)clockHz);
+    da7280sim_init(&dev, DEF_ADDR);
+    simbus_attach(&bus, &dev);
+    port.transport = simbus_transport(&bus);
+    if (!da7280_begin(&port) || !da7280_enableAcceleration(true))
+    {
+        fprintf(stderr, "begin() failed\n");
+        return 2;
+    }
+    simtimer_attach(&_timer, TIMER_CLOCK_HZ, da7280_pwmIrqHandler);
+    if (pwmHz < DA7280_PWM_MIN_HZ || pwmHz > DA7280_PWM_MAX_HZ ||
+        !da7280_pwmInit(&_timer, 0, TIMER_CLOCK_HZ, (uint32_t)pwmHz))
+    {
+        fprintf(stderr, "no PWM of %ld Hz from a %u Hz timer clock\n", pwmHz, (unsigned)TIMER_CLOCK_HZ);
+        return 2;
+    }
+    da7280_pwmSetAcceleration(true);
+    dev.amplitudeWritten = _onAmplitudeWritten;
+    _timer.ocChanged = _onDutyChanged;
+
+    // A triangle from 1, every level differs from the one before
+    uint8_t levels[NUM_LEVELS];
+    for (size_t i = 0; i < NUM_LEVELS; i++)
+    {
+        size_t v = i % 252;
+        levels[i] = (uint8_t)(1 + ((v < 126) ? v : 252 - v));
+    }
+
+    printf("%u levels, %ld Hz bus, %ld Hz PWM\n", (unsigned)NUM_LEVELS, clockHz, pwmHz);
+    printf("%-4s %7s %11s %10s %6s %9s %6s %8s\n", "", "rate Hz", "achieved Hz", "late ms",
+           "I2C", "bus ms", "bus %", "wake-ups");
+
+    int failures = 0;
+    for (size_t r = 0; r < sizeof(_ratesHz) / sizeof(_ratesHz[0]); r++)
+    {
+        uint32_t  rateHz = _ratesHz[r];
+        uint32_t  periodUs = 1000000u / rateHz;
+        runResult dro = { 0 };
+        runResult pwm = { 0 };
+
+        // DRO: one write and one deadline wait per level
+        da7280_setOperationMode(DRO_MODE);
+        da7280_setVibrate(0);
+        _numArrivals = 0;
+        simbus_resetStats(&bus);
+        uint64_t start = simclock_nowNs();
+        da7280_streamAmplitudes(levels, NUM_LEVELS, (uint16_t)periodUs);
+        dro.elapsedNs = simclock_nowNs() - start;
+        dro.transactions = bus.stats.transactions;
+        dro.busTimeNs = bus.stats.busTimeNs;
+        dro.wakeups = NUM_LEVELS;
+        _evaluate(&dro, start, periodUs);
+        _print("DRO", rateHz, &dro);
+
+        // PWM: the mode is set once, outside the stream
+        da7280_setOperationMode(PWM_MODE);
+        da7280_pwmSetLevel(0);
+        simclock_advanceNs(2000000000ull / (uint64_t)pwmHz);
+        _numArrivals = 0;
+        simbus_resetStats(&bus);
+        uint32_t irqs = da7280_pwmIrqCount();
+        start = simclock_nowNs();
+        da7280_pwmStream(levels, NUM_LEVELS, periodUs);
+        while (da7280_pwmIsStreaming())
+        {
+            // Until the next sleeptimer interrupt, overflows included
+            simsleeptimer_sleepUntil(simclock_nowNs() + 1000000000ull / (uint64_t)pwmHz);
+        }
+        pwm.elapsedNs = simclock_nowNs() - start;
+        pwm.transactions = bus.stats.transactions;
+        pwm.busTimeNs = bus.stats.busTimeNs;
+        pwm.wakeups = da7280_pwmIrqCount() - irqs;
+        _evaluate(&pwm, start, periodUs);
+        _print("PWM", rateHz, &pwm);
+
+        if (rateHz <= (uint32_t)pwmHz &&
+            (_numArrivals != NUM_LEVELS || pwm.transactions > 0 || pwm.maxLateUs > 1000000u / (uint32_t)pwmHz))
+        {
+            printf("     PWM backend missed its deadlines at %u Hz\n", (unsigned)rateHz);
+            failures++;
+        }
+    }
+    da7280_setOperationMode(DRO_MODE);
+
+    return (failures > 0) ? 1 : 0;
+}
@@ -0,0 +1,378 @@
+/* Runs the closed force loop of src/closed_loop against a simulated
+ * actuator: the levels go through da7280_setVibrate() and the simulated
+ * bus, the actuator follows the TOP_CTL2 the simulator holds and the
+ * accelerometer samples it at 800 Hz, as closed_loop.ino does with the
+ * LSM9DS0, the cost of each read included.
+ *
+ *   force_loop                         response at 0.7 of the calibration
+ *   force_loop -g GAIN                 actual response over the calibration
+ *   force_loop -t MS                   time constant of the actuator
+ *   force_loop -d PCT                  response change per pass, aging
+ *   force_loop -m GRAMS                mass on the actuator, 17
+ *   force_loop -p PROFILE              "100ms 50%, 300ms 10%", pattern 0
+ *   force_loop -n PASSES               5
+ *   force_loop -c HZ                   bus clock, 400000
+ *   force_loop -o                      open loop, the levels as written
+ *   force_loop -i FILE                 gain and time constant fitted from a
+ *                                      recording, "ms,level,m/s^2" lines
+ *   force_loop -w FILE                 writes such a recording
+ *   force_loop -v                      every level update
+ *
+ * Reports per pass how many steps converged and how fast, the gain
+ * estimate against the actual one and the force error at the end of the
+ * steps, and the loop latency: half the envelope window, the update period
+ * and the time from the sample to the end of the TOP_CTL2 write. Exits with
+ * 1 if a step of the last pass does not converge in closed loop. See the
+ * Host Simulation section of the README for the build.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "da7280_sim.h"
+#include "da7280_driver.h"
+#include "force_control.h"
+
+#define SAMPLE_RATE         800
+#define ENVELOPE_WINDOW     24
+#define CONTROL_EVERY       8
+#define LRA_HZ              81.4        // resonance of the calibration runs
+#define ACCEL_LSB           (0.000061 * 9.80665)    // LSM9DS0 at +-2 g
+#define ACCEL_NOISE         0.03        // m/s^2 rms
+#define MAX_RECORDS         8192
+
+static const forcePoint _calibration[] = {
+    { 0, 0.0f }, { 10, 0.0612f }, { 50, 0.0885f }, { 100, 0.2465f }
+};
+
+typedef struct
+{
+    uint32_t ms;
+    uint8_t  level;
+    float    amplitude;
+} record;
+
+static record _records[MAX_RECORDS];
+static size_t _numRecords = 0;
+
+typedef struct
+{
+    double   gain;                  // actual force over the calibration
+    double   tauMs;
+    double   massKg;
+    double   envelope;              // m/s^2
+    uint32_t seed;
+} actuator;
+
+static double _noise(actuator *act)
+{
+    // Box-Muller from a fixed LCG, the same run every time
+    double u[2];
+    for (int i = 0; i < 2; i++)
+    {
+        act->seed = act->seed * 1664525u + 1013904223u;
+        u[i] = ((act->seed >> 8) + 1.0) / 16777217.0;
+    }
+    return sqrt(-2.0 * log(u[0])) * cos(2.0 * M_PI * u[1]);
+}
+
+// Acceleration at timeNs after dt of the actuator following forceN
+static double _sample(actuator *act, double forceN, uint64_t timeNs, double dtMs)
+{
+    act->envelope += (forceN / act->massKg - act->envelope) * (1.0 - exp(-dtMs / act->tauMs));
+    double a = act->envelope * sin(2.0 * M_PI * LRA_HZ * timeNs / 1e9) + ACCEL_NOISE * _noise(act);
+    return round(a / ACCEL_LSB) * ACCEL_LSB;
+}
+
+static bool _loadRecording(const char *path)
+{
+    FILE *f = fopen(path, "r");
+    if (f == NULL)
+    {
+        return false;
+    }
+    char line[128];
+    while (fgets(line, sizeof(line), f) != NULL && _numRecords < MAX_RECORDS)
+    {
+        unsigned ms, level;
+        float    amplitude;
+        if (sscanf(line, "%u,%u,%f", &ms, &level, &amplitude) == 3)
+        {
+            _records[_numRecords++] = (record){ ms, (uint8_t)level, amplitude };
+        }
+    }
+    fclose(f);
+    return _numRecords > 0;
+}
+
+// Fits the response from the open loop recording: the gain from the second
+// half of every step at a level, the time constant from the 63 % point of
+// every change, less the half window the envelope lags by
+static bool _fitRecording(const forceControl *ctl, double massKg, double *gain, double *tauMs, unsigned *steps)
+{
+    double gainSum = 0, tauSum = 0;
+    unsigned gains = 0, taus = 0;
+    size_t start = 0;
+    double before = 0;
+
+    for (size_t i = 1; i <= _numRecords; i++)
+    {
+        if (i < _numRecords && _records[i].level == _records[start].level)
+        {
+            continue;
+        }
+        size_t n = i - start;
+        double steady = 0;
+        for (size_t k = start + n / 2; k < i; k++)
+        {
+            steady += _records[k].amplitude;
+        }
+        steady /= (double)(n - n / 2);
+        double nominal = forcectl_nominalForce(ctl, _records[start].level);
+        if (n >= 4 && nominal > 0)
+        {
+            gainSum += steady * massKg / nominal;
+            gains++;
+        }
+        double mark = before + 0.63 * (steady - before);
+        for (size_t k = start; n >= 4 && fabs(steady - before) > 0.5 && k < i; k++)
+        {
+            if ((steady > before) == (_records[k].amplitude >= mark))
+            {
+                // The first record of the step already took CONTROL_EVERY samples
+                double ms = _records[k].ms - _records[start].ms + 1000.0 * CONTROL_EVERY / SAMPLE_RATE
+                            - 500.0 * ENVELOPE_WINDOW / SAMPLE_RATE;
+                tauSum += (ms > 1.0) ? ms : 1.0;
+                taus++;
+                break;
+            }
+        }
+        before = steady;
+        start = i;
+    }
+    *gain = (gains > 0) ? gainSum / gains : 0;
+    *tauMs = (taus > 0) ? tauSum / taus : 0;
+    *steps = gains;
+    return gains > 0 && taus > 0;
+}
+
+int main(int argc, char *argv[])
+{
+    double      gain = 0.7, tauMs = 15.0, driftPct = 0, grams = 17;
+    const char *profile = "100ms 50%, 300ms 10%";
+    const char *input = NULL;
+    const char *output = NULL;
+    long        passes = 5, clockHz = 400000;
+    bool        openLoop = false, verbose = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-g") == 0 && i + 1 < argc)
+        {
+            gain = strtod(argv[++i], NULL);
+        }
+        else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc)
+        {
+            tauMs = strtod(argv[++i], NULL);
+        }
+        else if (strcmp(argv[i], "-d") == 0 && i + 1 < argc)
+        {
+            driftPct = strtod(argv[++i], NULL);
+        }
+        else if (strcmp(argv[i], "-m") == 0 && i + 1 < argc)
+        {
+            grams = strtod(argv[++i], NULL);
+        }
+        else if (strcmp(argv[i], "-p") == 0 && i + 1 < argc)
+        {
+            profile = argv[++i];
+        }
+        else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+        {
+            passes = strtol(argv[++i], NULL, 10);
+        }
+        else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc)
+        {
+            clockHz = strtol(argv[++i], NULL, 10);
+        }
+        else if (strcmp(argv[i], "-i") == 0 && i + 1 < argc)
+        {
+            input = argv[++i];
+        }
+        else if (strcmp(argv[i], "-w") == 0 && i + 1 < argc)
+        {
+            output = argv[++i];
+        }
+        else if (strcmp(argv[i], "-o") == 0)
+        {
+            openLoop = true;
+        }
+        else if (strcmp(argv[i], "-v") == 0)
+        {
+            verbose = true;
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s [-g GAIN] [-t MS] [-d PCT] [-m GRAMS] [-p PROFILE] [-n PASSES] "
+                    "[-c HZ] [-o] [-i FILE] [-w FILE] [-v]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    forceStep steps[FORCE_PROFILE_MAX_STEPS];
+    size_t    numSteps = forcectl_parseProfile(profile, steps, FORCE_PROFILE_MAX_STEPS);
+    if (numSteps == 0 || passes < 1 || clockHz < 1000 || gain <= 0 || tauMs <= 0 || grams <= 0)
+    {
+        fprintf(stderr, "a profile like \"100ms 50%%, 300ms 10%%\", a pass, a bus clock of 1 kHz or more "
+                "and positive gain, time constant and mass\n");
+        return 2;
+    }
+
+    forceControlConfig config = {
+        .curve = _calibration,
+        .numPoints = sizeof(_calibration) / sizeof(_calibration[0]),
+        .actuatorMassKg = (float)(grams / 1000.0),
+        .maxLevel = 0x7F,
+        .adaptRate = openLoop ? 0.0f : 0.5f,
+        .settleMs = 60,
+        .tolerance = 0.05f,
+        .minGain = 0.25f,
+        .maxGain = 4.0f,
+    };
+    forceControl ctl;
+    forcectl_init(&ctl, &config);
+
+    if (input != NULL)
+    {
+        unsigned fitted;
+        if (!_loadRecording(input) || !_fitRecording(&ctl, config.actuatorMassKg, &gain, &tauMs, &fitted))
+        {
+            fprintf(stderr, "no steps to fit in %s\n", input);
+            return 2;
+        }
+        printf("%s: gain %.3f, time constant %.1f ms from %u steps\n", input, gain, tauMs, fitted);
+    }
+    FILE *out = NULL;
+    if (output != NULL && (out = fopen(output, "w")) == NULL)
+    {
+        fprintf(stderr, "cannot write %s\n", output);
+        return 2;
+    }
+
+    simbus_t    bus;
+    da7280sim_t dev;
+    sl_i2cspm_t port = { 0 };
+
+    simclock_reset();
+    simbus_init(&bus, (uint32_t)clockHz);
+    da7280sim_init(&dev, DEF_ADDR);
+    simbus_attach(&bus, &dev);
+    port.transport = simbus_transport(&bus);
+    if (!da7280_begin(&port) || !da7280_enableAcceleration(false) || !da7280_setOperationMode(DRO_MODE))
+    {
+        fprintf(stderr, "begin() failed\n");
+        return 2;
+    }
+
+    actuator act = { gain, tauMs, config.actuatorMassKg, 0.0, 1 };
+    forceEnvelope env;
+    forcectl_envelopeInit(&env, ENVELOPE_WINDOW);
+
+    // The LSM9DS0 is not on the simulated bus, its reads only take the time:
+    // the register address, a repeated START and six bytes
+    const uint64_t readNs = simbus_transferTimeNs((uint32_t)clockHz, 1, 6, true);
+    const uint64_t periodNs = 1000000000ull / SAMPLE_RATE;
+    const uint32_t updateMs = CONTROL_EVERY * 1000u / SAMPLE_RATE;
+    uint64_t latencySumNs = 0, latencyMaxNs = 0, writes = 0;
+    uint64_t startNs = simclock_nowNs();
+    uint64_t next = startNs;
+    bool     lastConverged = true;
+
+    printf("%s, %zu steps, %s loop, response %.3f of the calibration, %.1f ms, %.0f g, %ld Hz bus\n",
+           profile, numSteps, openLoop ? "open" : "closed", act.gain, act.tauMs, grams, clockHz);
+    printf("%4s %9s %10s %10s %10s %10s %10s\n", "pass", "converged", "mean ms", "max ms",
+           "gain est", "gain", "end err %");
+
+    for (long pass = 0; pass < passes; pass++)
+    {
+        double errSum = 0;
+        unsigned errSteps = 0;
+
+        forcectl_resetStats(&ctl);
+        for (size_t s = 0; s < numSteps; s++)
+        {
+            uint8_t level = forcectl_setTarget(&ctl, steps[s].level);
+            uint32_t sample = 0;
+            uint64_t endNs = simclock_nowNs() + steps[s].durationMs * 1000000ull;
+
+            da7280_setVibrate(level);
+            while (next < endNs)
+            {
+                if (simclock_nowNs() < next)
+                {
+                    simclock_advanceNs(next - simclock_nowNs());
+                }
+                next += periodNs;
+                simclock_advanceNs(readNs);
+
+                uint64_t sampleNs = simclock_nowNs();
+                double force = act.gain * forcectl_nominalForce(&ctl, dev.regs[TOP_CTL2]);
+                forcectl_envelopeAdd(&env, (float)_sample(&act, force, sampleNs, 1000.0 / SAMPLE_RATE));
+                if (++sample % CONTROL_EVERY != 0 || !forcectl_envelopeFull(&env))
+                {
+                    continue;
+                }
+                float amplitude = forcectl_envelopeAmplitude(&env);
+                if (out != NULL)
+                {
+                    fprintf(out, "%u,%u,%.4f\n", (unsigned)((sampleNs - startNs) / 1000000u),
+                            (unsigned)dev.regs[TOP_CTL2], amplitude);
+                }
+                uint8_t updated = forcectl_update(&ctl, amplitude, updateMs);
+                if (updated == level)
+                {
+                    continue;
+                }
+                level = updated;
+                da7280_setVibrate(level);
+                uint64_t latencyNs = simclock_nowNs() - sampleNs;
+                latencySumNs += latencyNs;
+                latencyMaxNs = (latencyNs > latencyMaxNs) ? latencyNs : latencyMaxNs;
+                writes++;
+                if (verbose)
+                {
+                    printf("     %8.1f ms  %3u%%  measured %.4f N  target %.4f N  gain %.3f -> level %u\n",
+                           (sampleNs - startNs) / 1e6, (unsigned)steps[s].level, ctl.targetN + ctl.lastErrorN,
+                           ctl.targetN, ctl.gain, (unsigned)level);
+                }
+            }
+            if (ctl.targetN > 0)
+            {
+                errSum += fabs(act.envelope * act.massKg - ctl.targetN) / ctl.targetN;
+                errSteps++;
+            }
+        }
+        forcectl_setTarget(&ctl, 0);
+
+        forceControlStats stats;
+        forcectl_getStats(&ctl, &stats);
+        printf("%4ld %5u/%-3u %10u %10u %10.3f %10.3f %10.1f\n", pass + 1, (unsigned)stats.converged,
+               (unsigned)stats.targets, (unsigned)stats.meanConvergeMs, (unsigned)stats.maxConvergeMs, ctl.gain,
+               act.gain, (errSteps > 0) ? 100.0 * errSum / errSteps : 0.0);
+        lastConverged = (stats.converged == stats.targets);
+        act.gain *= 1.0 + driftPct / 100.0;
+    }
+    da7280_setVibrate(0);
+    if (out != NULL)
+    {
+        fclose(out);
+    }
+
+    printf("latency: window %.1f ms, update every %u ms, sample to TOP_CTL2 written %.1f us mean, "
+           "%.1f us max over %llu writes\n", 500.0 * ENVELOPE_WINDOW / SAMPLE_RATE, (unsigned)updateMs,
+           (writes > 0) ? latencySumNs / 1e3 / writes : 0.0, latencyMaxNs / 1e3, (unsigned long long)writes);
+
+    return (!openLoop && !lastConverged) ? 1 : 0;
+}
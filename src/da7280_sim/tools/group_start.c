@@ -0,0 +1,155 @@
+/* Starts patterns on several simulated DA7280s with da7280_startGroup() and
+ * reports the skew between the first and the last sequence start, with the
+ * transactions and bus time of the start, once with the patterns still to
+ * load and once with them resident.
+ *
+ *   group_start                        4 DA7280s behind a mux at 0x70
+ *   group_start -n N                   N of them, 2..DA7280_MAX_DEVICES - 1
+ *   group_start -a                     at 0x4A, 0x4B, ... on the bus directly
+ *                                      instead, started one after the other
+ *   group_start -p P,P,...             pattern of each device (0, 1, ...)
+ *   group_start -c HZ                  bus clock (400000)
+ *
+ * Exits with 1 if a device did not start or the skew exceeds
+ * SKEW_LIMIT_US. See the Host Simulation section of the README for the
+ * build.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "da7280_sim.h"
+#include "da7280_driver.h"
+
+#define MUX_ADDRESS         0x70
+#define SKEW_LIMIT_US       1000
+#define MAX_GROUP           (DA7280_MAX_DEVICES - 1)    // _devices[0] is da7280_begin()'s
+
+static simbus_t     _bus;
+static da7280sim_t  _sims[MAX_GROUP];
+static size_t       _numDevices = 4;
+
+// Starts the group and prints what it took; false if a device did not start
+static bool _start(const char *label, da7280Device *const devs[], const uint8_t patterns[], uint32_t *skewUs)
+{
+    uint32_t starts[MAX_GROUP];
+    uint32_t transactions = _bus.stats.transactions;
+    uint64_t busTimeNs = _bus.stats.busTimeNs;
+    bool     ok;
+
+    for (size_t i = 0; i < _numDevices; i++)
+    {
+        starts[i] = _sims[i].seqStarts;
+    }
+    ok = da7280_startGroup(devs, patterns, _numDevices);
+
+    uint64_t first = UINT64_MAX;
+    uint64_t last = 0;
+    for (size_t i = 0; i < _numDevices; i++)
+    {
+        if (_sims[i].seqStarts != starts[i] + 1 || _sims[i].lastSequence.fault != 0)
+        {
+            printf("  device %u did not start pattern %u\n", (unsigned)i, (unsigned)patterns[i]);
+            ok = false;
+            continue;
+        }
+        first = (_sims[i].lastStartNs < first) ? _sims[i].lastStartNs : first;
+        last = (_sims[i].lastStartNs > last) ? _sims[i].lastStartNs : last;
+    }
+    *skewUs = ok ? (uint32_t)((last - first) / 1000u) : UINT32_MAX;
+
+    printf("%-8s %4u transactions %9.3f ms bus  skew %8.3f ms\n", label,
+           (unsigned)(_bus.stats.transactions - transactions), (_bus.stats.busTimeNs - busTimeNs) / 1e6,
+           ok ? (last - first) / 1e6 : -1.0);
+    return ok;
+}
+
+int main(int argc, char *argv[])
+{
+    bool     direct = false;
+    long     clockHz = 400000;
+    uint8_t  patterns[MAX_GROUP];
+    const char *patternList = NULL;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-a") == 0)
+        {
+            direct = true;
+        }
+        else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+        {
+            _numDevices = (size_t)strtol(argv[++i], NULL, 10);
+        }
+        else if (strcmp(argv[i], "-p") == 0 && i + 1 < argc)
+        {
+            patternList = argv[++i];
+        }
+        else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc)
+        {
+            clockHz = strtol(argv[++i], NULL, 10);
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s [-a] [-n N] [-p P,P,...] [-c HZ]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (_numDevices < 2 || _numDevices > MAX_GROUP || clockHz < 1000)
+    {
+        fprintf(stderr, "2..%u devices, a bus clock of 1 kHz or more\n", (unsigned)MAX_GROUP);
+        return 2;
+    }
+    for (size_t i = 0; i < _numDevices; i++)
+    {
+        patterns[i] = (uint8_t)i;
+    }
+    for (size_t i = 0; patternList != NULL && i < _numDevices; i++)
+    {
+        char *end;
+        patterns[i] = (uint8_t)strtol(patternList, &end, 10);
+        patternList = (*end == ',') ? end + 1 : NULL;
+    }
+
+    simclock_reset();
+    simbus_init(&_bus, (uint32_t)clockHz);
+    if (!direct)
+    {
+        simbus_attachMux(&_bus, MUX_ADDRESS);
+        da7280_setMux(MUX_ADDRESS);
+    }
+
+    da7280Device *devs[MAX_GROUP];
+    sl_i2cspm_t   port = { 0 };
+    port.transport = simbus_transport(&_bus);
+    for (size_t i = 0; i < _numDevices; i++)
+    {
+        uint8_t address = direct ? (uint8_t)(DEF_ADDR + i) : DEF_ADDR;
+
+        da7280sim_init(&_sims[i], address);
+        if (direct)
+        {
+            simbus_attach(&_bus, &_sims[i]);
+        }
+        else
+        {
+            simbus_attachBehindMux(&_bus, &_sims[i], (uint8_t)i);
+        }
+        devs[i] = da7280_addDevice(&port, address, direct ? DA7280_NO_MUX_CHANNEL : (uint8_t)i);
+        if (devs[i] == NULL)
+        {
+            fprintf(stderr, "device %u did not come up\n", (unsigned)i);
+            return 2;
+        }
+    }
+
+    printf("%u DA7280s %s at %ld Hz\n", (unsigned)_numDevices,
+           direct ? "at their own addresses" : "behind a mux", clockHz);
+
+    uint32_t coldUs, warmUs;
+    bool ok = _start("cold", devs, patterns, &coldUs);
+    ok = _start("resident", devs, patterns, &warmUs) && ok;
+
+    return (!ok || coldUs > SKEW_LIMIT_US || warmUs > SKEW_LIMIT_US) ? 1 : 0;
+}
@@ -0,0 +1,310 @@
+/* Compiles every pattern_map entry of da7280_patterns.h with the driver's
+ * waveform memory compiler, plays the image on the simulated DA7280 and
+ * reports the timing error against the original step durations.
+ *
+ *   pattern_compiler                   one line per pattern
+ *   pattern_compiler -v                and one line per step
+ *   pattern_compiler --no-accel        ACCELERATION_EN = 0, signed AMP
+ *   pattern_compiler --trace N         CSV of pattern N as played against
+ *                                      its step table, one row per ms
+ *
+ * The envelope column renders each image with da7280sim_renderSequence()
+ * and gives the mean |played - target| level over the pattern, sampled
+ * every millisecond, in percent of full scale.
+ *
+ * After the single pattern images, the patterns of each mass and then all
+ * of them are packed into one image with shared snippets and the memory
+ * usage is reported, the way da7280_loadPattern() fills the memory.
+ *
+ * Exits with 1 if the emulator does not play a compiled image the way the
+ * compiler describes it. See the Host Simulation section of the README.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "da7280_sim.h"
+#include "da7280_wavemem.h"
+#include "da7280_patterns.h"
+
+#define LEVEL_TOLERANCE     0.5f    // of one AMP step
+#define TRACE_MAX_POINTS    4096
+#define TRACE_SAMPLE_US     1000
+
+static bool _verbose = false;
+
+static size_t _toSteps(const PatternMapEntry *entry, const wavememFormat *format, wavememStep steps[], size_t maxSteps)
+{
+    if (entry->count > maxSteps)
+    {
+        return 0;
+    }
+    for (size_t i = 0; i < entry->count; i++)
+    {
+        // Levels as da7280_setVibrate() writes them
+        steps[i].duration_ms = entry->steps[i].duration_ms;
+        steps[i].level = (entry->steps[i].force_pct > format->fullScale) ? format->fullScale
+                                                                          : entry->steps[i].force_pct;
+    }
+    return entry->count;
+}
+
+typedef struct
+{
+    const wavememFormat *format;
+    const uint8_t       *patterns;
+} packContext;
+
+static size_t _packSteps(size_t candidate, wavememStep steps[], size_t maxSteps, void *ctx)
+{
+    const packContext *pack = (const packContext *)ctx;
+    return _toSteps(&pattern_map[pack->patterns[candidate]], pack->format, steps, maxSteps);
+}
+
+// Level the step table asks for at timeUs, 0 after its end
+static float _targetLevel(const wavememStep steps[], size_t count, const wavememFormat *format, uint32_t timeUs)
+{
+    uint32_t start = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        start += steps[i].duration_ms * 1000u;
+        if (timeUs < start)
+        {
+            return (float)steps[i].level / format->fullScale;
+        }
+    }
+    return 0.0f;
+}
+
+// Mean |played - target| of the rendered sequence over the longer of the
+// two, -1 if the trace does not fit TRACE_MAX_POINTS. With csv the samples
+// are printed instead.
+static float _envelopeError(const da7280sim_t *dev, uint8_t seqId, const wavememStep steps[], size_t count,
+                            const wavememFormat *format, const wavememTiming *timing, bool csv)
+{
+    static da7280sim_tracePoint_t points[TRACE_MAX_POINTS];
+    da7280sim_sequence_t seq;
+    size_t n = da7280sim_renderSequence(dev, seqId, &seq, points, TRACE_MAX_POINTS);
+    if (n == 0 || n > TRACE_MAX_POINTS)
+    {
+        return -1.0f;
+    }
+
+    uint32_t length = (seq.durationUs > timing->targetUs) ? seq.durationUs : timing->targetUs;
+    double   sum = 0.0;
+    size_t   samples = 0;
+    if (csv)
+    {
+        printf("time_ms,played,target\n");
+    }
+    for (uint32_t t = 0; t < length; t += TRACE_SAMPLE_US)
+    {
+        float played = da7280sim_traceLevelAt(points, n, t);
+        float target = _targetLevel(steps, count, format, t);
+        if (csv)
+        {
+            printf("%u,%.4f,%.4f\n", (unsigned)(t / 1000), played, target);
+        }
+        sum += fabsf(played - target);
+        samples++;
+    }
+    return (samples > 0) ? (float)(100.0 * sum / samples) : 0.0f;
+}
+
+// Checks the decoded sequence frame by frame against the pattern it was compiled from
+static bool _verify(const PatternMapEntry *entry, const wavememStep steps[], const wavememFormat *format,
+                    const wavememTiming *timing, const da7280sim_sequence_t *seq)
+{
+    float ampStep = 1.0f / (format->accelerated ? 15 : 7);
+    bool  ok      = (seq->numFrames == entry->count && seq->durationUs == timing->playedUs);
+
+    for (size_t i = 0; i < seq->numFrames && i < entry->count; i++)
+    {
+        const da7280sim_frame_t *frame = &seq->frames[i];
+        float target   = (float)steps[i].level / format->fullScale;
+        long  errorUs  = (long)frame->durationUs - (long)steps[i].duration_ms * 1000;
+        bool  levelOk  = fabsf(frame->level - target) <= LEVEL_TOLERANCE * ampStep;
+
+        ok = ok && levelOk && (unsigned long)labs(errorUs) <= timing->worstErrorUs;
+        if (_verbose)
+        {
+            printf("    step %2u  %5u ms -> %8.2f ms  %+7.2f ms  level %.3f -> %.3f  snippet %u x%u%s\n",
+                   (unsigned)i, (unsigned)steps[i].duration_ms, frame->durationUs / 1000.0, errorUs / 1000.0,
+                   target, frame->level, (unsigned)frame->snippetId, (unsigned)frame->loops,
+                   levelOk ? "" : "  LEVEL MISMATCH");
+        }
+    }
+    return ok;
+}
+
+int main(int argc, char *argv[])
+{
+    wavememFormat format = { 0xFF, true, DA7280SIM_MEM_FIRST };
+    int failures = 0;
+    long tracePattern = -1;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-v") == 0)
+        {
+            _verbose = true;
+        }
+        else if (strcmp(argv[i], "--no-accel") == 0)
+        {
+            format.fullScale   = 0x7F;
+            format.accelerated = false;
+        }
+        else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc)
+        {
+            tracePattern = strtol(argv[++i], NULL, 10);
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s [-v] [--no-accel] [--trace N]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    if (tracePattern >= 0)
+    {
+        wavememStep   steps[WAVEMEM_MAX_STEPS];
+        wavememImage  image;
+        wavememTiming timing;
+        da7280sim_t   dev;
+
+        if (tracePattern >= (long)PATTERN_MAP_SIZE ||
+            !da7280_wavememCompile(steps, _toSteps(&pattern_map[tracePattern], &format, steps, WAVEMEM_MAX_STEPS),
+                                   &format, &image, &timing))
+        {
+            fprintf(stderr, "pattern %ld does not compile\n", tracePattern);
+            return 2;
+        }
+        da7280sim_init(&dev, 0x4A);
+        dev.regs[SIM_TOP_CFG1] = format.accelerated ? (dev.regs[SIM_TOP_CFG1] | 0x04) : (dev.regs[SIM_TOP_CFG1] & ~0x04);
+        da7280sim_loadImage(&dev, image.bytes, image.used);
+        return (_envelopeError(&dev, 0, steps, pattern_map[tracePattern].count, &format, &timing, true) < 0) ? 1 : 0;
+    }
+
+    printf("%-8s %5s %5s %5s %10s %10s %9s %10s %9s  %s\n",
+           "pattern", "mass", "steps", "bytes", "target ms", "played ms", "error %", "worst ms", "envelope", "emulator");
+
+    for (size_t p = 0; p < PATTERN_MAP_SIZE; p++)
+    {
+        const PatternMapEntry *entry = &pattern_map[p];
+        wavememStep   steps[WAVEMEM_MAX_STEPS];
+        wavememImage  image;
+        wavememTiming timing;
+
+        if (entry->count > WAVEMEM_MAX_STEPS)
+        {
+            printf("%-8u %5u %5u  too many steps\n", (unsigned)p, (unsigned)entry->mass_g, (unsigned)entry->count);
+            continue;
+        }
+        _toSteps(entry, &format, steps, WAVEMEM_MAX_STEPS);
+
+        if (!da7280_wavememCompile(steps, entry->count, &format, &image, &timing))
+        {
+            printf("%-8u %5u %5u  does not fit the waveform memory\n",
+                   (unsigned)p, (unsigned)entry->mass_g, (unsigned)entry->count);
+            continue;
+        }
+
+        da7280sim_t dev;
+        da7280sim_sequence_t seq;
+        da7280sim_init(&dev, 0x4A);
+        dev.regs[SIM_TOP_CFG1] = format.accelerated ? (dev.regs[SIM_TOP_CFG1] | 0x04) : (dev.regs[SIM_TOP_CFG1] & ~0x04);
+        da7280sim_loadImage(&dev, image.bytes, image.used);
+
+        bool decoded = da7280sim_decodeSequence(&dev, 0, &seq);
+        float envelope = _envelopeError(&dev, 0, steps, entry->count, &format, &timing, false);
+        printf("%-8u %5u %5u %5u %10.2f %10.2f %+9.2f %10.2f %8.2f%%  ",
+               (unsigned)p, (unsigned)entry->mass_g, (unsigned)entry->count, (unsigned)image.used,
+               timing.targetUs / 1000.0, timing.playedUs / 1000.0,
+               100.0 * ((double)timing.playedUs - timing.targetUs) / timing.targetUs, timing.worstErrorUs / 1000.0,
+               envelope);
+        if (!decoded)
+        {
+            printf("fault 0x%02X\n", (unsigned)seq.fault);
+            failures++;
+            continue;
+        }
+        printf("%s\n", (seq.durationUs == timing.playedUs) ? "ok" : "MISMATCH");
+        if (!_verify(entry, steps, &format, &timing, &seq))
+        {
+            printf("    emulator disagrees with the compiler\n");
+            failures++;
+        }
+    }
+
+    printf("\n%-8s %9s %5s %7s %8s %6s %6s %5s %7s\n",
+           "mass", "resident", "seqs", "header", "snippets", "frames", "free", "used", "shared");
+
+    // Every mass group, then every pattern; 0 stands for all
+    for (size_t g = 0; g <= PATTERN_MAP_SIZE; g++)
+    {
+        uint16_t mass = (g < PATTERN_MAP_SIZE) ? pattern_map[g].mass_g : 0;
+        uint8_t  patterns[PATTERN_MAP_SIZE];
+        uint8_t  seqIds[PATTERN_MAP_SIZE];
+        size_t   n = 0;
+        bool     firstOfMass = true;
+
+        for (size_t p = 0; p < PATTERN_MAP_SIZE; p++)
+        {
+            firstOfMass = firstOfMass && !(p < g && pattern_map[p].mass_g == mass);
+            if (mass == 0 || pattern_map[p].mass_g == mass)
+            {
+                patterns[n++] = (uint8_t)p;
+            }
+        }
+        if (!firstOfMass)
+        {
+            continue;
+        }
+
+        packContext     ctx = { &format, patterns };
+        wavememBuilder  builder;
+        wavememImage    image;
+        wavememUsage    usage;
+        da7280_wavememInit(&builder, &format);
+        size_t packed = da7280_wavememPack(&builder, n, 0, _packSteps, &ctx, seqIds);
+        da7280_wavememBuild(&builder, &image);
+        da7280_wavememGetUsage(&builder, &usage);
+
+        char group[16];
+        snprintf(group, sizeof(group), (mass == 0) ? "all" : "%u g", (unsigned)mass);
+        printf("%-8s %4u / %-2u %5u %7u %8u %6u %6u %4u%% %5u B\n",
+               group, (unsigned)packed, (unsigned)n, (unsigned)usage.numSequences, (unsigned)usage.headerBytes,
+               (unsigned)usage.snippetBytes, (unsigned)usage.frameBytes, (unsigned)usage.freeBytes,
+               (unsigned)(WAVEMEM_SIZE - usage.freeBytes), (unsigned)usage.sharedBytes);
+
+        // Every resident pattern has to play from the packed image as it does on its own
+        da7280sim_t dev;
+        da7280sim_init(&dev, 0x4A);
+        dev.regs[SIM_TOP_CFG1] = format.accelerated ? (dev.regs[SIM_TOP_CFG1] | 0x04) : (dev.regs[SIM_TOP_CFG1] & ~0x04);
+        da7280sim_loadImage(&dev, image.bytes, image.used);
+
+        for (size_t i = 0; i < n; i++)
+        {
+            wavememStep          steps[WAVEMEM_MAX_STEPS];
+            wavememTiming        timing;
+            da7280sim_sequence_t seq;
+
+            if (seqIds[i] == WAVEMEM_NOT_PACKED)
+            {
+                continue;
+            }
+            size_t count = _toSteps(&pattern_map[patterns[i]], &format, steps, WAVEMEM_MAX_STEPS);
+            da7280_wavememCompile(steps, count, &format, &image, &timing);
+            if (!da7280sim_decodeSequence(&dev, seqIds[i], &seq) || !_verify(&pattern_map[patterns[i]], steps, &format, &timing, &seq))
+            {
+                printf("    pattern %u does not play from sequence %u\n", (unsigned)patterns[i], (unsigned)seqIds[i]);
+                failures++;
+            }
+        }
+    }
+
+    printf("%d pattern(s) failed verification\n", failures);
+    return (failures > 0) ? 1 : 0;
+}
@@ -0,0 +1,160 @@
+/* Measures the CPU cost of rendering step ramps with da7280_ramp.c against
+ * the same curves computed per sample in float, and the largest difference
+ * between the two in TOP_CTL2 levels.
+ *
+ *   ramp_bench                         full scale ramps of 1000 samples
+ *   ramp_bench -n N                    of N samples
+ *
+ * Cycles are read from the time stamp counter on x86 and estimated from
+ * the monotonic clock at CPU_HZ elsewhere, so compare the two columns with
+ * each other rather than with a Cortex-M. Exits with 1 if a table ramp is
+ * more than MAX_ERROR_LEVELS off the float curve. See the Host Simulation
+ * section of the README for the build.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "da7280_ramp.h"
+
+#define CPU_HZ              3.0e9   // for hosts without a time stamp counter
+#define DEFAULT_SAMPLES     1000
+#define REPEATS             2000
+#define MAX_ERROR_LEVELS    1
+#define FULL_SCALE          255
+
+static const char *_names[RAMP_NUM_SHAPES] = { "step", "linear", "exponential", "raised-cosine" };
+
+// Keeps the compiler from dropping the rendered samples
+static volatile uint32_t _sink;
+
+static uint64_t _cycles(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)((ts.tv_sec * 1e9 + ts.tv_nsec) * CPU_HZ / 1e9);
+#endif
+}
+
+// The curve of da7280_ramp.c, x = 0..1 of the way from the lower level
+static float _curve(rampShape shape, float x)
+{
+    switch (shape)
+    {
+        case RAMP_LINEAR:           return x;
+        case RAMP_EXPONENTIAL:      return (expf(x * logf(16.0f)) - 1.0f) / 15.0f;
+        case RAMP_RAISED_COSINE:    return (1.0f - cosf((float)M_PI * x)) / 2.0f;
+        default:                    return 1.0f;
+    }
+}
+
+static uint8_t _floatSample(rampShape shape, uint8_t from, uint8_t to, uint16_t sample, uint16_t numSamples)
+{
+    float x = (float)sample / numSamples;
+
+    if (to < from)
+    {
+        return (uint8_t)lrintf(to + (from - to) * _curve(shape, 1.0f - x));
+    }
+    return (uint8_t)lrintf(from + (to - from) * _curve(shape, x));
+}
+
+static double _tableCycles(rampShape shape, uint8_t from, uint8_t to, uint16_t numSamples)
+{
+    rampState ramp;
+    uint32_t  sum = 0;
+    uint64_t  start = _cycles();
+
+    for (int r = 0; r < REPEATS; r++)
+    {
+        da7280_rampInit(&ramp, shape, from, to, numSamples);
+        while (!da7280_rampDone(&ramp))
+        {
+            sum += da7280_rampNext(&ramp);
+        }
+    }
+    _sink = sum;
+    return (double)(_cycles() - start) / ((double)REPEATS * numSamples);
+}
+
+static double _floatCycles(rampShape shape, uint8_t from, uint8_t to, uint16_t numSamples)
+{
+    uint32_t sum = 0;
+    uint64_t start = _cycles();
+
+    for (int r = 0; r < REPEATS; r++)
+    {
+        for (uint16_t i = 1; i <= numSamples; i++)
+        {
+            sum += _floatSample(shape, from, to, i, numSamples);
+        }
+    }
+    _sink = sum;
+    return (double)(_cycles() - start) / ((double)REPEATS * numSamples);
+}
+
+// Largest |table - float| of one ramp, in levels
+static int _maxError(rampShape shape, uint8_t from, uint8_t to, uint16_t numSamples)
+{
+    rampState ramp;
+    int worst = 0;
+
+    da7280_rampInit(&ramp, shape, from, to, numSamples);
+    for (uint16_t i = 1; !da7280_rampDone(&ramp); i++)
+    {
+        int error = abs((int)da7280_rampNext(&ramp) - (int)_floatSample(shape, from, to, i, numSamples));
+        worst = (error > worst) ? error : worst;
+    }
+    return worst;
+}
+
+int main(int argc, char *argv[])
+{
+    long numSamples = DEFAULT_SAMPLES;
+    int  failures = 0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+        {
+            numSamples = strtol(argv[++i], NULL, 10);
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s [-n N]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (numSamples < 1 || numSamples > UINT16_MAX)
+    {
+        fprintf(stderr, "1..%u samples\n", (unsigned)UINT16_MAX);
+        return 2;
+    }
+
+    printf("%-14s %12s %12s %10s\n", "shape", "table cyc", "float cyc", "max error");
+    for (int shape = RAMP_LINEAR; shape < RAMP_NUM_SHAPES; shape++)
+    {
+        double table = (_tableCycles(shape, 0, FULL_SCALE, numSamples) +
+                        _tableCycles(shape, FULL_SCALE, 0, numSamples)) / 2;
+        double fl    = (_floatCycles(shape, 0, FULL_SCALE, numSamples) +
+                        _floatCycles(shape, FULL_SCALE, 0, numSamples)) / 2;
+        int    up    = _maxError(shape, 0, FULL_SCALE, numSamples);
+        int    down  = _maxError(shape, FULL_SCALE, 0, numSamples);
+        int    error = (up > down) ? up : down;
+
+        printf("%-14s %12.1f %12.1f %10d%s\n", _names[shape], table, fl, error,
+               (error > MAX_ERROR_LEVELS) ? "  TOO FAR OFF" : "");
+        failures += (error > MAX_ERROR_LEVELS);
+    }
+    return (failures > 0) ? 1 : 0;
+}
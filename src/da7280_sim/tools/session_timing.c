@@ -0,0 +1,343 @@
+/* Runs a stimulation session of da7280_driver.c through the bare-metal super
+ * loop of main.c on the simulator's virtual clock, with BLE writes arriving
+ * while the pattern plays, and reports
+ *
+ *   - the effect latency: activity write to the first step on the bus or
+ *     on the PWM output
+ *   - the command latency: arrival of each later write to its
+ *     da7280_processUserInput() call, i.e. to the notification answering it
+ *   - da7280_getPlaybackTimingStats(): lateness of every step against its
+ *     deadline, the jitter between them and the drift of the session end
+ *   - for a playlist, the silence between two passes played from waveform
+ *     memory beyond the gap of the entry, the simulator's sequence length
+ *     taken for the end of a pass
+ *
+ *   session_timing                     pattern 0 of 17 g for 5 s
+ *   session_timing -m G -p N -t S      pattern N of G grams for S seconds
+ *   session_timing -r SHAPE [-R MS] [-f HZ]
+ *                                      steps opened by rampShape SHAPE
+ *                                      ramps of MS (50) sampled at HZ (1000)
+ *   session_timing -q P,R,G [-q ...]   a playlist, R passes of pattern P
+ *                                      followed by G ms each, instead
+ *   session_timing -P                  passes written step by step played
+ *                                      on the PWM backend, the duty cycle
+ *                                      of the host TIMER model
+ *   session_timing -v                  and one line per write
+ *
+ * Between passes the loop sleeps until the next sleeptimer interrupt or
+ * BLE write unless app_proceed() asked for another pass, as the power
+ * manager does. Exits with 1 if a latency, the lateness of a step or the
+ * drift or the silence between passes exceeds LATENCY_LIMIT_US. See the Host Simulation section of the
+ * README for the build.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "da7280_sim.h"
+#include "da7280_driver.h"
+#include "da7280_pwm.h"
+#include "em_timer.h"
+#include "sl_sleeptimer.h"
+#include "gatt_db.h"
+#include "app.h"
+
+#define BUS_CLOCK_HZ        400000
+#define WRITE_PERIOD_US     137300  // not a multiple of any step, writes land anywhere in a pass
+#define LATENCY_LIMIT_US    10000
+#define MSG_MAX_LEN         128     // as app.c
+#define MAX_PASSES          (PLAYLIST_MAX_ENTRIES * UINT8_MAX)
+#define TIMER_CLOCK_HZ      38400000    // HFXO of the BGM220P
+#define PWM_HZ              20000
+
+static bool _verbose = false;
+static TIMER_TypeDef _timer;
+static uint32_t _dutyChanges = 0;
+static uint64_t _firstDutyNs = 0;   // of the first change of the session
+
+static void _onDutyChanged(void *ctx, unsigned int ch, uint32_t oc, uint64_t atNs)
+{
+    (void)ctx;
+    (void)ch;
+    (void)oc;
+    if (_dutyChanges++ == 0)
+    {
+        _firstDutyNs = atNs;
+    }
+}
+
+static uint32_t _nowUs(void)
+{
+    return (uint32_t)(simclock_nowNs() / 1000u);
+}
+
+int main(int argc, char *argv[])
+{
+    long mass = 17;
+    long pattern = 0;
+    long seconds = 5;
+    long shape = RAMP_STEP;
+    long rampMs = 50;
+    long rateHz = RAMP_MAX_RATE_HZ;
+    bool pwm = false;
+    playlistEntry playlist[PLAYLIST_MAX_ENTRIES];
+    size_t numEntries = 0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-v") == 0)
+        {
+            _verbose = true;
+        }
+        else if (strcmp(argv[i], "-P") == 0)
+        {
+            pwm = true;
+        }
+        else if (strcmp(argv[i], "-m") == 0 && i + 1 < argc)
+        {
+            mass = strtol(argv[++i], NULL, 10);
+        }
+        else if (strcmp(argv[i], "-p") == 0 && i + 1 < argc)
+        {
+            pattern = strtol(argv[++i], NULL, 10);
+        }
+        else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc)
+        {
+            seconds = strtol(argv[++i], NULL, 10);
+        }
+        else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc)
+        {
+            shape = strtol(argv[++i], NULL, 10);
+        }
+        else if (strcmp(argv[i], "-R") == 0 && i + 1 < argc)
+        {
+            rampMs = strtol(argv[++i], NULL, 10);
+        }
+        else if (strcmp(argv[i], "-f") == 0 && i + 1 < argc)
+        {
+            rateHz = strtol(argv[++i], NULL, 10);
+        }
+        else if (strcmp(argv[i], "-q") == 0 && i + 1 < argc && numEntries < PLAYLIST_MAX_ENTRIES)
+        {
+            long p, r, g;
+            if (sscanf(argv[++i], "%ld,%ld,%ld", &p, &r, &g) != 3 || p < 0 || p > UINT8_MAX ||
+                r < 1 || r > UINT8_MAX || g < 0 || g > UINT16_MAX)
+            {
+                fprintf(stderr, "-q takes pattern,repetitions,gap ms\n");
+                return 2;
+            }
+            playlist[numEntries++] = (playlistEntry){ (uint8_t)p, (uint8_t)r, (uint16_t)g };
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s [-v] [-P] [-m G] [-p N] [-t S] [-r SHAPE [-R MS] [-f HZ]] [-q P,R,G ...]\n",
+                    argv[0]);
+            return 2;
+        }
+    }
+    if (mass < 0 || mass > UINT8_MAX || pattern < 0 || pattern > UINT8_MAX || seconds < 1 || seconds > UINT8_MAX)
+    {
+        fprintf(stderr, "mass, pattern and seconds take 0..%u\n", (unsigned)UINT8_MAX);
+        return 2;
+    }
+
+    simbus_t    bus;
+    da7280sim_t dev;
+    sl_i2cspm_t port = { 0 };
+    char        msg[MSG_MAX_LEN];
+
+    simclock_reset();
+    simbus_init(&bus, BUS_CLOCK_HZ);
+    da7280sim_init(&dev, 0x4A);
+    simbus_attach(&bus, &dev);
+    port.transport = simbus_transport(&bus);
+    if (!da7280_begin(&port))
+    {
+        fprintf(stderr, "begin() failed\n");
+        return 2;
+    }
+    if (rampMs < 0 || rampMs > UINT16_MAX || shape < 0 || !da7280_setStepRamp((rampShape)shape, (uint16_t)rampMs, (uint16_t)rateHz))
+    {
+        fprintf(stderr, "shape 0..%u, 1..%u Hz\n", (unsigned)RAMP_NUM_SHAPES - 1, (unsigned)RAMP_MAX_RATE_HZ);
+        return 2;
+    }
+    if (pwm)
+    {
+        simtimer_attach(&_timer, TIMER_CLOCK_HZ, da7280_pwmIrqHandler);
+        if (!da7280_pwmInit(&_timer, 0, TIMER_CLOCK_HZ, PWM_HZ) || !da7280_setPlaybackBackend(PLAYBACK_PWM))
+        {
+            fprintf(stderr, "PWM backend did not come up\n");
+            return 2;
+        }
+        _timer.ocChanged = _onDutyChanged;
+    }
+    da7280_setBootStatus(BOOT_COMPLETED);
+
+    // Gap after every pass, in playing order
+    static uint16_t passGapMs[MAX_PASSES];
+    static bool     entryEnds[MAX_PASSES];
+    size_t numPasses = 0;
+    for (size_t e = 0; e < numEntries; e++)
+    {
+        if (!da7280_queuePattern(playlist[e].patternIdx, playlist[e].repetitions, playlist[e].gapMs))
+        {
+            fprintf(stderr, "pattern %u cannot be queued\n", (unsigned)playlist[e].patternIdx);
+            return 2;
+        }
+        for (uint8_t r = 0; r < playlist[e].repetitions; r++)
+        {
+            passGapMs[numPasses] = playlist[e].gapMs;
+            entryEnds[numPasses++] = (r + 1 == playlist[e].repetitions);
+        }
+    }
+    if (numEntries == 0)
+    {
+        da7280_processUserInput((uint32_t)mass, gattdb_weight_value, msg, sizeof(msg));
+        da7280_processUserInput((uint32_t)pattern, gattdb_pattern_value, msg, sizeof(msg));
+        if (strncmp(msg, "Pattern ", 8) != 0)
+        {
+            fprintf(stderr, "pattern %ld of %ld g: %s\n", pattern, mass, msg);
+            return 2;
+        }
+    }
+
+    uint32_t start = _nowUs();
+    uint32_t busActivity = dev.seqStarts + dev.amplitudeWrites;
+    uint32_t effectUs = UINT32_MAX;
+    uint32_t nextWriteUs = start + WRITE_PERIOD_US;
+    uint32_t writes = 0;
+    uint32_t worstUs = 0;
+    uint64_t sumUs = 0;
+    uint32_t seqStarts = dev.seqStarts;
+    uint32_t seqEndUs = 0;
+    size_t   seqPasses = 0;
+    int32_t  worstSilenceUs = 0;        // beyond the gap, negative if a pass was cut short
+    int32_t  worstEntrySilenceUs = 0;   // of the passes that start a new entry
+
+    if (numEntries > 0)
+    {
+        // The session starts once the patterns are loaded
+        da7280_resetPatternCacheStats();
+        if (!da7280_startPlaylist())
+        {
+            fprintf(stderr, "playlist did not start\n");
+            return 2;
+        }
+        printf("playlist of %u entries, %u passes, loaded in %.3f ms\n",
+               (unsigned)numEntries, (unsigned)numPasses, (_nowUs() - start) / 1000.0);
+        start = _nowUs();
+        nextWriteUs = start + WRITE_PERIOD_US;
+    }
+    else
+    {
+        da7280_processUserInput((uint32_t)seconds, gattdb_activity_value, msg, sizeof(msg));
+        printf("pattern %ld of %ld g for %ld s: %s\n", pattern, mass, seconds, msg);
+    }
+
+    while (!da7280_getActivityDone())
+    {
+        if (da7280_isActivityTimeSet())
+        {
+            da7280_performActivity();
+        }
+        if (effectUs == UINT32_MAX && _dutyChanges > 0)
+        {
+            // The duty cycle changes while the loop sleeps
+            effectUs = (uint32_t)(_firstDutyNs / 1000u) - start;
+        }
+        if (effectUs == UINT32_MAX && dev.seqStarts + dev.amplitudeWrites != busActivity)
+        {
+            effectUs = _nowUs() - start;
+        }
+        if (dev.seqStarts != seqStarts)
+        {
+            // A pass from waveform memory started, the last one ended at seqEndUs
+            if (seqPasses > 0 && seqPasses <= numPasses)
+            {
+                int32_t silenceUs = (int32_t)(_nowUs() - seqEndUs) - passGapMs[seqPasses - 1] * 1000;
+                bool    newEntry = entryEnds[seqPasses - 1];
+
+                if (_verbose)
+                {
+                    printf("  pass %3u at %9.3f ms  %7.3f ms %s\n", (unsigned)seqPasses, _nowUs() / 1000.0,
+                           silenceUs / 1000.0, newEntry ? "after the gap, new entry" : "after the gap");
+                }
+                if (abs(silenceUs) > abs(worstSilenceUs))
+                {
+                    worstSilenceUs = silenceUs;
+                }
+                if (newEntry && abs(silenceUs) > abs(worstEntrySilenceUs))
+                {
+                    worstEntrySilenceUs = silenceUs;
+                }
+            }
+            seqStarts = dev.seqStarts;
+            seqEndUs = _nowUs() + dev.lastSequence.durationUs;
+            seqPasses++;
+        }
+
+        // sl_main_process_action(): the BLE stack hands over the writes that arrived
+        while (nextWriteUs <= _nowUs() && !da7280_getActivityDone())
+        {
+            uint32_t latencyUs = _nowUs() - nextWriteUs;
+
+            da7280_processUserInput((uint32_t)mass, gattdb_weight_value, msg, sizeof(msg));
+            if (_verbose)
+            {
+                printf("  write at %9.3f ms  handled after %7.3f ms\n", nextWriteUs / 1000.0, latencyUs / 1000.0);
+            }
+            worstUs = (latencyUs > worstUs) ? latencyUs : worstUs;
+            sumUs += latencyUs;
+            writes++;
+            nextWriteUs += WRITE_PERIOD_US;
+        }
+        // sl_power_manager_sleep(): unless a pass was requested, the CPU
+        // sleeps until the next sleeptimer interrupt or BLE write
+        if (!app_is_process_required())
+        {
+            simsleeptimer_sleepUntil((uint64_t)nextWriteUs * 1000u);
+        }
+    }
+
+    printf("session ended after %.3f ms, %u I2C transactions\n",
+           (_nowUs() - start) / 1000.0, (unsigned)bus.stats.transactions);
+    if (pwm)
+    {
+        printf("PWM backend      %u duty cycle changes, %u timer interrupts\n",
+               (unsigned)_dutyChanges, (unsigned)da7280_pwmIrqCount());
+    }
+    printf("effect latency   %8.3f ms\n", effectUs / 1000.0);
+    printf("command latency  %8.3f ms worst, %.3f ms mean over %u writes\n",
+           worstUs / 1000.0, (writes > 0) ? (double)sumUs / writes / 1000.0 : 0.0, (unsigned)writes);
+
+    playbackTimingStats timing;
+    da7280_getPlaybackTimingStats(&timing);
+    printf("step lateness    %8.3f ms worst, %.3f ms mean over %u deadlines, jitter %.3f ms\n",
+           timing.maxLatenessUs / 1000.0, timing.meanLatenessUs / 1000.0, (unsigned)timing.deadlines,
+           timing.meanJitterUs / 1000.0);
+    printf("drift            %8.3f ms\n", timing.driftUs / 1000.0);
+
+    if (numEntries > 0)
+    {
+        patternCacheStats cache;
+        da7280_getPatternCacheStats(&cache);
+        printf("pattern cache    %u hits, %u misses, %u evictions\n",
+               (unsigned)cache.hits, (unsigned)cache.misses, (unsigned)cache.evictions);
+        if (seqPasses != numPasses)
+        {
+            // Passes written step by step are covered by the step lateness
+            printf("transitions      not measured, %u of %u passes played from waveform memory\n",
+                   (unsigned)seqPasses, (unsigned)numPasses);
+        }
+        else
+        {
+            printf("transitions      %8.3f ms worst silence beyond the gap, %.3f ms between entries\n",
+                   worstSilenceUs / 1000.0, worstEntrySilenceUs / 1000.0);
+        }
+    }
+
+    return (effectUs > LATENCY_LIMIT_US || worstUs > LATENCY_LIMIT_US || timing.maxLatenessUs > LATENCY_LIMIT_US ||
+            timing.driftUs > LATENCY_LIMIT_US || timing.driftUs < -LATENCY_LIMIT_US ||
+            abs(worstSilenceUs) > LATENCY_LIMIT_US) ? 1 : 0;
+}